@@ -285,9 +285,9 @@ void stb_c_lexer_get_location(const stb_lexer *lexer, const char *where, stb_lex
    char *p = lexer->input_stream;
    int line_number = 1;
    int char_offset = 0;
-   while (*p && p < where) {
+   while (p != lexer->eof && *p && p < where) {
       if (*p == '\n' || *p == '\r') {
-         p += (p[0]+p[1] == '\r'+'\n' ? 2 : 1); // skip newline
+         p += (p+1 != lexer->eof && p[0]+p[1] == '\r'+'\n' ? 2 : 1); // skip newline
          line_number += 1;
          char_offset = 0;
       } else {
@@ -321,6 +321,44 @@ static int stb__clex_iswhite(int x)
    return x == ' ' || x == '\t' || x == '\r' || x == '\n' || x == '\f';
 }
 
+#ifdef STB__CLEX_use_stdlib
+// strtol/strtod scan until the first non-number character, which may lie
+// past 'eof' when the input isn't 0-terminated, so they get a bounded copy
+#define STB__CLEX_NUMBER_MAX 128
+
+static void stb__clex_number_copy(stb_lexer *lexer, char *p, char *buf)
+{
+   int n = 0;
+   while (n < STB__CLEX_NUMBER_MAX-1 && p+n != lexer->eof
+          && ((p[n] >= '0' && p[n] <= '9') || (p[n] >= 'a' && p[n] <= 'z')
+           || (p[n] >= 'A' && p[n] <= 'Z') || p[n] == '.' || p[n] == '+' || p[n] == '-')) {
+      buf[n] = p[n];
+      ++n;
+   }
+   buf[n] = 0;
+}
+
+static long stb__clex_strtol(stb_lexer *lexer, char *p, char **q, int base)
+{
+   char buf[STB__CLEX_NUMBER_MAX], *end;
+   long value;
+   stb__clex_number_copy(lexer, p, buf);
+   value = strtol(buf, &end, base);
+   *q = p + (end - buf);
+   return value;
+}
+
+static double stb__clex_strtod(stb_lexer *lexer, char *p, char **q)
+{
+   char buf[STB__CLEX_NUMBER_MAX], *end;
+   double value;
+   stb__clex_number_copy(lexer, p, buf);
+   value = strtod(buf, &end);
+   *q = p + (end - buf);
+   return value;
+}
+#endif
+
 static const char *stb__strchr(const char *str, int ch)
 {
    for (; *str; ++str)
@@ -472,10 +510,12 @@ static int stb__clex_parse_string(stb_lexer *lexer, char *p, int type)
    char delim = *p++; // grab the " or ' for later matching
    char *out = lexer->string_storage;
    char *outend = lexer->string_storage + lexer->string_storage_len;
-   while (*p != delim) {
+   while (p != lexer->eof && *p != delim) {
       int n;
       if (*p == '\\') {
          char *q;
+         if (p+1 == lexer->eof)
+            return stb__clex_token(lexer, CLEX_parse_error, start, p);
          n = stb__clex_parse_char(p, &q);
          if (n < 0)
             return stb__clex_token(lexer, CLEX_parse_error, start, q);
@@ -489,6 +529,8 @@ static int stb__clex_parse_string(stb_lexer *lexer, char *p, int type)
       // @TODO expand unicode escapes to UTF8
       *out++ = (char) n;
    }
+   if (p == lexer->eof)
+      return stb__clex_token(lexer, CLEX_parse_error, start, p-1);
    *out = 0;
    lexer->string = lexer->string_storage;
    lexer->string_len = (int) (out - lexer->string_storage);
@@ -524,10 +566,10 @@ int stb_c_lexer_get_token(stb_lexer *lexer)
       )
 
       STB_C_LEX_C_COMMENTS(
-         if (p != lexer->eof && p[0] == '#' && p[1] == '*') {
+         if (p != lexer->eof && p+1 != lexer->eof && p[0] == '#' && p[1] == '*') {
             char *start = p;
             p += 2;
-            while (p != lexer->eof && (p[0] != '*' || p[1] != '#'))
+            while (p != lexer->eof && (p+1 == lexer->eof || p[0] != '*' || p[1] != '#'))
                ++p;
             if (p == lexer->eof)
                return stb__clex_token(lexer, CLEX_parse_error, start, p-1);
@@ -568,13 +610,13 @@ int stb_c_lexer_get_token(stb_lexer *lexer)
                   return stb__clex_token(lexer, CLEX_parse_error, p, p+n);
                lexer->string[n] = p[n];
                ++n;
-            } while (
+            } while (p+n != lexer->eof && (
                   (p[n] >= 'a' && p[n] <= 'z')
                || (p[n] >= 'A' && p[n] <= 'Z')
                || (p[n] >= '0' && p[n] <= '9') // allow digits in middle of identifier
                || p[n] == '_' || (unsigned char) p[n] >= 128
                 STB_C_LEX_DOLLAR_IDENTIFIER( || p[n] == '$' )
-            );
+            ));
             lexer->string[n] = 0;
             lexer->string_len = n;
             return stb__clex_token(lexer, CLEX_id, p, p+n-1);
@@ -667,6 +709,8 @@ int stb_c_lexer_get_token(stb_lexer *lexer)
          STB_C_LEX_C_CHARS(
          {
             char *start = p;
+            if (p+2 >= lexer->eof)
+               return stb__clex_token(lexer, CLEX_parse_error, start,start);
             lexer->int_number = stb__clex_parse_char(p+1, &p);
             if (lexer->int_number < 0)
                return stb__clex_token(lexer, CLEX_parse_error, start,start);
@@ -689,7 +733,7 @@ int stb_c_lexer_get_token(stb_lexer *lexer)
                   if (q != lexer->eof) {
                      if (*q == '.' STB_C_LEX_FLOAT_NO_DECIMAL(|| *q == 'p' || *q == 'P')) {
                         #ifdef STB__CLEX_use_stdlib
-                        lexer->real_number = strtod((char *) p, (char**) &q);
+                        lexer->real_number = stb__clex_strtod(lexer, p, &q);
                         #else
                         lexer->real_number = stb__clex_parse_float(p, &q);
                         #endif
@@ -704,7 +748,7 @@ int stb_c_lexer_get_token(stb_lexer *lexer)
 
                   #ifdef STB__clex_hex_ints
                   #ifdef STB__CLEX_use_stdlib
-                  lexer->int_number = strtol((char *) p, (char **) &q, 16);
+                  lexer->int_number = stb__clex_strtol(lexer, p, &q, 16);
                   #else
                   {
                      stb__clex_int n=0;
@@ -742,7 +786,7 @@ int stb_c_lexer_get_token(stb_lexer *lexer)
             if (q != lexer->eof) {
                if (*q == '.' STB_C_LEX_FLOAT_NO_DECIMAL(|| *q == 'e' || *q == 'E')) {
                   #ifdef STB__CLEX_use_stdlib
-                  lexer->real_number = strtod((char *) p, (char**) &q);
+                  lexer->real_number = stb__clex_strtod(lexer, p, &q);
                   #else
                   lexer->real_number = stb__clex_parse_float(p, &q);
                   #endif
@@ -758,7 +802,7 @@ int stb_c_lexer_get_token(stb_lexer *lexer)
          if (p[0] == '0') {
             char *q = p;
             #ifdef STB__CLEX_use_stdlib
-            lexer->int_number = strtol((char *) p, (char **) &q, 8);
+            lexer->int_number = stb__clex_strtol(lexer, p, &q, 8);
             #else
             stb__clex_int n=0;
             while (q != lexer->eof) {
@@ -780,7 +824,7 @@ int stb_c_lexer_get_token(stb_lexer *lexer)
          {
             char *q = p;
             #ifdef STB__CLEX_use_stdlib
-            lexer->int_number = strtol((char *) p, (char **) &q, 10);
+            lexer->int_number = stb__clex_strtol(lexer, p, &q, 10);
             #else
             stb__clex_int n=0;
             while (q != lexer->eof) {
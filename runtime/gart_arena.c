@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gart_rt.h"
+
+#define BLOCK_SIZE  0x10000
+// Blocks a thread keeps from freed arenas, so that a function called in
+// a loop doesn't go back to malloc for its arena every time.
+#define SPARE_BLOCKS 8
+
+struct gart_block {
+    struct gart_block *prev;
+    size_t             size;
+    _Alignas(64) char  data[];
+};
+
+_Thread_local struct gart_arena gart_heap;
+
+static _Thread_local struct gart_block *spare;
+static _Thread_local int spare_count;
+
+static struct gart_block *new_block(size_t size) {
+    if (size == BLOCK_SIZE && spare) {
+        struct gart_block *block = spare;
+        spare = block->prev;
+        spare_count--;
+        return block;
+    }
+    struct gart_block *block = malloc(sizeof(struct gart_block) + size);
+    if (!block) {
+        fprintf(stderr, "out of memory for %zu bytes\n", size);
+        exit(1);
+    }
+    block->size = size;
+    return block;
+}
+
+void *gart_arena_grow(struct gart_arena *arena, size_t size, size_t align) {
+    // the block's data is 64-aligned, more takes room to align within it
+    size_t need = size + (align > 64 ? align - 1 : 0);
+    size_t block_size = need > BLOCK_SIZE / 4 ? need : BLOCK_SIZE;
+    struct gart_block *block = new_block(block_size);
+    char *at = (char *)(((uintptr_t)block->data + align - 1) & ~(uintptr_t)(align - 1));
+
+    if (block_size == BLOCK_SIZE || !arena->block) {
+        block->prev = arena->block;
+        arena->block = block;
+        arena->ptr = at + size;
+        arena->end = block->data + block_size;
+    } else {
+        // oversized request: keep bumping in the current block
+        block->prev = arena->block->prev;
+        arena->block->prev = block;
+    }
+    return memset(at, 0, size);
+}
+
+void gart_arena_free(struct gart_arena *arena) {
+    struct gart_block *block = arena->block;
+    while (block) {
+        struct gart_block *prev = block->prev;
+        if (block->size == BLOCK_SIZE && spare_count < SPARE_BLOCKS) {
+            block->prev = spare;
+            spare = block;
+            spare_count++;
+        } else {
+            free(block);
+        }
+        block = prev;
+    }
+    arena->block = NULL;
+    arena->ptr = NULL;
+    arena->end = NULL;
+}
+
+void *gart_arena_resize(struct gart_arena *arena, void *old, size_t size, size_t new_size, size_t align) {
+    if (new_size <= size) return old;
+    size_t more = new_size - size;
+    if (old && (char *)old + size == arena->ptr && more <= (size_t)(arena->end - arena->ptr)) {
+        memset(arena->ptr, 0, more);
+        arena->ptr += more;
+        return old;
+    }
+    void *moved = gart_arena_alloc(arena, new_size, align);
+    if (size) memcpy(moved, old, size);
+    return moved;
+}
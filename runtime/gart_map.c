@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gart_rt.h"
+
+const int8_t gart_empty_group[GART_GROUP] = {
+    GART_EMPTY, GART_EMPTY, GART_EMPTY, GART_EMPTY, GART_EMPTY, GART_EMPTY, GART_EMPTY, GART_EMPTY,
+    GART_EMPTY, GART_EMPTY, GART_EMPTY, GART_EMPTY, GART_EMPTY, GART_EMPTY, GART_EMPTY, GART_EMPTY,
+};
+
+static uint64_t read64(const char *s) {
+    uint64_t word;
+    memcpy(&word, s, sizeof(word));
+    return word;
+}
+
+// Eight bytes at a time, each word folded in with a multiply, and the
+// tail read as one word padded with zeros.
+uint64_t gart_hash_bytes(const char *s, size_t len) {
+    uint64_t hash = 0x9e3779b97f4a7c15ULL ^ len;
+    for (; len >= 8; s += 8, len -= 8) {
+        hash = (hash ^ read64(s)) * 0xbf58476d1ce4e5b9ULL;
+        hash ^= hash >> 31;
+    }
+    if (len) {
+        uint64_t tail = 0;
+        memcpy(&tail, s, len);
+        hash = (hash ^ tail) * 0xbf58476d1ce4e5b9ULL;
+    }
+    return gart_hash_int(hash);
+}
+
+static int64_t fill_of(int64_t slots, float load) {
+    return (int64_t)((double)slots * load);
+}
+
+void gart_table_rebuild(struct gart_table *t, int64_t len) {
+    int64_t slots = t->fill ? t->mask + 1 : GART_GROUP;
+    int64_t need = len + 1;
+    if (!t->fill && t->reserve > need) need = t->reserve;
+    if (t->fill && len * 2 > t->fill) slots *= 2;
+    while (fill_of(slots, t->load) < need) {
+        if (slots > (int64_t)UINT32_MAX) {
+            fprintf(stderr, "out of memory for a map of %lld entries\n", (long long)need);
+            exit(1);
+        }
+        slots *= 2;
+    }
+
+    struct gart_arena *arena = gart_arena_of(t->arena);
+    t->ctrl = gart_arena_alloc(arena, slots + GART_GROUP, GART_GROUP);
+    memset(t->ctrl, GART_EMPTY, slots + GART_GROUP);
+    t->slots = gart_arena_alloc(arena, slots * sizeof(uint32_t), sizeof(uint32_t));
+    t->mask = slots - 1;
+    t->fill = fill_of(slots, t->load);
+    t->room = t->fill;
+}
+
+void gart_table_move(struct gart_table *t, uint64_t hash, int64_t from, int64_t to) {
+    int64_t pos = GART_H1(hash) & t->mask;
+    for (int64_t step = GART_GROUP;; step += GART_GROUP) {
+        for (uint32_t match = gart_group_match(t->ctrl + pos, GART_H2(hash)); match; match &= match - 1) {
+            int64_t slot = (pos + gart_ctz(match)) & t->mask;
+            if (t->slots[slot] == (uint32_t)from) {
+                t->slots[slot] = (uint32_t)to;
+                return;
+            }
+        }
+        pos = (pos + step) & t->mask;
+    }
+}
+
+void *gart_vec_grow(struct gart_arena *arena, void *ptr, int64_t *cap, int64_t reserve, float grow,
+                    size_t size, size_t align) {
+    int64_t old = *cap;
+    int64_t new_cap = old ? (int64_t)(old * grow) : reserve > 4 ? reserve : 4;
+    if (new_cap <= old) new_cap = old + 1;
+    ptr = gart_arena_resize(gart_arena_of(arena), ptr, old * size, gart_span(new_cap, size, 1), align);
+    *cap = new_cap;
+    return ptr;
+}
+
+// Instantiated once here, where the runtime's warnings check them.
+GART_VEC(int64_t, gart_vec_int64, gart_slice_int64)
+GART_MAP(gart_str, int64_t, gart_map_str_int64, gart_slice_str, gart_slice_int64, gart_hash_str, gart_str_eq)
@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "gart_rt.h"
+
+static const char digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+void gart_line_flush(struct gart_line *line) {
+    fwrite(line->buf, 1, line->len, stdout);
+    line->len = 0;
+}
+
+void gart_line_write(struct gart_line *line, const char *s, size_t len) {
+    gart_line_flush(line);
+    if (len > sizeof(line->buf)) {
+        fwrite(s, 1, len, stdout);
+    } else {
+        memcpy(line->buf, s, len);
+        line->len = len;
+    }
+}
+
+// Writes the digits of `value` to end at `end`, returning where they start.
+static char *decimal(char *end, uint64_t value) {
+    while (value >= 100) {
+        end -= 2;
+        memcpy(end, digit_pairs + value % 100 * 2, 2);
+        value /= 100;
+    }
+    if (value >= 10) {
+        end -= 2;
+        memcpy(end, digit_pairs + value * 2, 2);
+    } else {
+        *--end = (char)('0' + value);
+    }
+    return end;
+}
+
+void gart_line_uint(struct gart_line *line, uint64_t value) {
+    char buf[24];
+    char *start = decimal(buf + sizeof(buf), value);
+    gart_line_str(line, start, buf + sizeof(buf) - start);
+}
+
+void gart_line_int(struct gart_line *line, int64_t value) {
+    char buf[24];
+    uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+    char *start = decimal(buf + sizeof(buf), magnitude);
+    if (value < 0) *--start = '-';
+    gart_line_str(line, start, buf + sizeof(buf) - start);
+}
+
+void gart_line_hex(struct gart_line *line, uint64_t value, int upper) {
+    const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char buf[16];
+    char *start = buf + sizeof(buf);
+    do {
+        *--start = digits[value & 15];
+        value >>= 4;
+    } while (value);
+    gart_line_str(line, start, buf + sizeof(buf) - start);
+}
+
+void gart_line_format(struct gart_line *line, const char *spec, ...) {
+    va_list args;
+    va_start(args, spec);
+    size_t room = sizeof(line->buf) - line->len;
+    int len = vsnprintf(line->buf + line->len, room, spec, args);
+    va_end(args);
+    if (len < 0) return;
+    if ((size_t)len < room) {
+        line->len += len;
+        return;
+    }
+    // didn't fit: again, into memory of its own
+    char *text = malloc((size_t)len + 1);
+    if (!text) {
+        fprintf(stderr, "out of memory for %d bytes\n", len + 1);
+        exit(1);
+    }
+    va_start(args, spec);
+    vsnprintf(text, (size_t)len + 1, spec, args);
+    va_end(args);
+    gart_line_str(line, text, len);
+    free(text);
+}
+
+static const double powers_of_ten[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+
+// '%.Nf' as printf writes it. Scaled by 10^N, a value below 2^40 is off by
+// less than 0.001 from its exact decimal expansion, so it rounds the same
+// unless its fraction is that close to a half: those, big values, long
+// precisions, infinities and NaN go through snprintf.
+void gart_line_double(struct gart_line *line, double value, int precision) {
+    if (precision > 9 || value != value || !(value < 1e12 && value > -1e12)) {
+        gart_line_format(line, "%.*f", precision, value);
+        return;
+    }
+    int negative = value < 0 || (value == 0 && 1 / value < 0);
+    double magnitude = negative ? -value : value;
+    double scaled = magnitude * powers_of_ten[precision];
+    if (scaled >= (double)(1LL << 40)) {
+        gart_line_format(line, "%.*f", precision, value);
+        return;
+    }
+    uint64_t whole = (uint64_t)scaled;
+    double fraction = scaled - (double)whole;
+    if (fraction > 0.499 && fraction < 0.501) {
+        gart_line_format(line, "%.*f", precision, value);
+        return;
+    }
+    if (fraction > 0.5) whole++;
+
+    char buf[48];
+    char *end = buf + sizeof(buf);
+    char *start = end;
+    uint64_t unit = (uint64_t)powers_of_ten[precision];
+    if (precision > 0) {
+        uint64_t decimals = whole % unit;
+        for (int i = 0; i < precision; i++) {
+            *--start = (char)('0' + decimals % 10);
+            decimals /= 10;
+        }
+        *--start = '.';
+    }
+    start = decimal(start, whole / unit);
+    if (negative) *--start = '-';
+    gart_line_str(line, start, end - start);
+}
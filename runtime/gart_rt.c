@@ -0,0 +1,292 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "gart_rt.h"
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <unistd.h>
+#endif
+
+// Tasks one deque holds; a spawn that finds its deque full runs the task
+// right away instead.
+#define DEQUE_SIZE  4096
+#define MAX_WORKERS 256
+// Failed attempts at finding work before an idle worker goes to sleep.
+#define IDLE_SPINS  64
+
+struct Task {
+    void             (*fn)(void *args);
+    struct gart_frame *frame;
+    _Alignas(max_align_t) unsigned char args[];
+};
+
+// Chase-Lev deque, fixed size: the owner pushes and pops at the bottom,
+// thieves take from the top, and only the last task is contended.
+struct Deque {
+    _Alignas(64) _Atomic int64_t top;
+    _Alignas(64) _Atomic int64_t bottom;
+    _Atomic(struct Task *) tasks[DEQUE_SIZE];
+};
+
+static pthread_once_t  started = PTHREAD_ONCE_INIT;
+static struct Deque   *deques;
+static int             worker_count;
+static _Thread_local int self = -1;    // this thread's worker, -1 for others
+
+static pthread_mutex_t sleep_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  wake = PTHREAD_COND_INITIALIZER;
+static _Atomic int     sleepers;
+
+static pthread_mutex_t reduce_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static bool deque_push(struct Deque *d, struct Task *task) {
+    int64_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    int64_t t = atomic_load_explicit(&d->top, memory_order_acquire);
+    if (b - t >= DEQUE_SIZE) return false;
+    atomic_store_explicit(&d->tasks[b % DEQUE_SIZE], task, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    return true;
+}
+
+static struct Task *deque_pop(struct Deque *d) {
+    int64_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t t = atomic_load_explicit(&d->top, memory_order_relaxed);
+    if (t > b) {
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        return NULL;
+    }
+    struct Task *task = atomic_load_explicit(&d->tasks[b % DEQUE_SIZE], memory_order_relaxed);
+    if (t == b) {
+        // the last task: whoever moves the top first gets it
+        if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst,
+                                                     memory_order_relaxed)) {
+            task = NULL;
+        }
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+static struct Task *deque_steal(struct Deque *d) {
+    int64_t t = atomic_load_explicit(&d->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+    if (t >= b) return NULL;
+    struct Task *task = atomic_load_explicit(&d->tasks[t % DEQUE_SIZE], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed)) {
+        return NULL;
+    }
+    return task;
+}
+
+static void run_task(struct Task *task) {
+    struct gart_frame *frame = task->frame;
+    task->fn(task->args);
+    free(task);
+    atomic_fetch_sub_explicit(&frame->pending, 1, memory_order_release);
+}
+
+// The newest task of our own deque, else the oldest of someone else's,
+// starting at a random victim.
+static struct Task *find_task(unsigned *seed) {
+    struct Task *task = deque_pop(&deques[self]);
+    if (task) return task;
+    *seed = *seed * 1103515245u + 12345u;
+    int first = (int)((*seed >> 16) % (unsigned)worker_count);
+    for (int i = 0; i < worker_count; i++) {
+        int victim = (first + i) % worker_count;
+        if (victim == self) continue;
+        task = deque_steal(&deques[victim]);
+        if (task) return task;
+    }
+    return NULL;
+}
+
+static bool work_visible(void) {
+    for (int i = 0; i < worker_count; i++) {
+        if (atomic_load(&deques[i].bottom) > atomic_load(&deques[i].top)) return true;
+    }
+    return false;
+}
+
+// Sleeps until a spawn signals, or for a while: the timeout covers a
+// signal sent just before this worker counted itself as sleeping.
+static void sleep_idle(void) {
+    pthread_mutex_lock(&sleep_lock);
+    atomic_fetch_add(&sleepers, 1);
+    if (!work_visible()) {
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_nsec += 10 * 1000 * 1000;
+        if (until.tv_nsec >= 1000000000L) {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&wake, &sleep_lock, &until);
+    }
+    atomic_fetch_sub(&sleepers, 1);
+    pthread_mutex_unlock(&sleep_lock);
+}
+
+static void *worker_main(void *arg) {
+    self = (int)(intptr_t)arg;
+    unsigned seed = (unsigned)self * 2654435761u;
+    int misses = 0;
+    for (;;) {
+        struct Task *task = find_task(&seed);
+        if (task) {
+            run_task(task);
+            misses = 0;
+        } else if (++misses < IDLE_SPINS) {
+            sched_yield();
+        } else {
+            sleep_idle();
+            misses = 0;
+        }
+    }
+    return NULL;
+}
+
+static int cpu_count(void) {
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+// The thread that gets here first is the program's main thread, worker 0.
+static void start_workers(void) {
+    int count = cpu_count();
+    const char *env = getenv("GART_THREADS");
+    if (env && atoi(env) > 0) count = atoi(env);
+    if (count > MAX_WORKERS) count = MAX_WORKERS;
+
+    deques = aligned_alloc(64, count * sizeof(struct Deque));
+    if (!deques) {
+        fprintf(stderr, "out of memory for %d workers\n", count);
+        exit(1);
+    }
+    memset(deques, 0, count * sizeof(struct Deque));
+    worker_count = count;
+    self = 0;
+
+    for (int i = 1; i < count; i++) {
+        pthread_t id;
+        if (pthread_create(&id, NULL, worker_main, (void *)(intptr_t)i) != 0) {
+            fprintf(stderr, "could not start worker %d\n", i);
+            exit(1);
+        }
+        pthread_detach(id);
+    }
+}
+
+int gart_workers(void) {
+    pthread_once(&started, start_workers);
+    return worker_count;
+}
+
+void gart_spawn(struct gart_frame *frame, void (*fn)(void *args), const void *args, size_t size) {
+    // nobody could steal it, so it may as well run now
+    if (gart_workers() == 1 || self < 0) {
+        fn((void *)args);
+        return;
+    }
+    struct Task *task = malloc(sizeof(struct Task) + size);
+    if (!task) {
+        fprintf(stderr, "out of memory for a task\n");
+        exit(1);
+    }
+    task->fn = fn;
+    task->frame = frame;
+    memcpy(task->args, args, size);
+    atomic_fetch_add_explicit(&frame->pending, 1, memory_order_relaxed);
+    if (!deque_push(&deques[self], task)) {
+        run_task(task);
+        return;
+    }
+    if (atomic_load(&sleepers) > 0) {
+        pthread_mutex_lock(&sleep_lock);
+        pthread_cond_signal(&wake);
+        pthread_mutex_unlock(&sleep_lock);
+    }
+}
+
+void gart_sync(struct gart_frame *frame) {
+    if (atomic_load_explicit(&frame->pending, memory_order_acquire) == 0) return;
+    unsigned seed = (unsigned)(uintptr_t)frame;
+    while (atomic_load_explicit(&frame->pending, memory_order_acquire) > 0) {
+        struct Task *task = find_task(&seed);
+        if (task) {
+            run_task(task);
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+struct Range {
+    void  (*body)(void *ctx, int64_t lo, int64_t hi);
+    void   *ctx;
+    int64_t lo;
+    int64_t hi;
+    int64_t grain;
+};
+
+static void run_range(void *arg);
+
+// Halves the range, offering each upper half for stealing, until what is
+// left is small enough to run here.
+static void split_range(struct Range range) {
+    struct gart_frame frame = {0};
+    while (range.hi - range.lo > range.grain) {
+        struct Range upper = range;
+        upper.lo = range.lo + (range.hi - range.lo) / 2;
+        gart_spawn(&frame, run_range, &upper, sizeof(upper));
+        range.hi = upper.lo;
+    }
+    range.body(range.ctx, range.lo, range.hi);
+    gart_sync(&frame);
+}
+
+static void run_range(void *arg) {
+    split_range(*(struct Range *)arg);
+}
+
+void gart_parallel_for(int64_t count, void (*body)(void *ctx, int64_t lo, int64_t hi), void *ctx) {
+    if (count <= 0) return;
+    int workers = gart_workers();
+    if (workers == 1 || self < 0) {
+        body(ctx, 0, count);
+        return;
+    }
+    int64_t grain = count / ((int64_t)workers * 8);
+    split_range((struct Range){ body, ctx, 0, count, grain > 0 ? grain : 1 });
+}
+
+void gart_lock(void) {
+    pthread_mutex_lock(&reduce_lock);
+}
+
+void gart_unlock(void) {
+    pthread_mutex_unlock(&reduce_lock);
+}
+
+void gart_fail(const char *format, int64_t a, int64_t b, int64_t c) {
+    fprintf(stderr, format, (long long)a, (long long)b, (long long)c);
+    exit(1);
+}
@@ -0,0 +1,561 @@
+#ifndef GART_RT_H
+#define GART_RT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Runtime linked into every gart program: the arenas arrays are allocated
+// from, strings, the index behind maps, println's writers, and a
+// work-stealing scheduler behind 'spawn', 'sync' and 'parallel for'. Each
+// worker thread owns a deque of tasks, pushes and pops at its bottom, and when it runs dry steals from the top of
+// another's. The calling thread is worker 0; the others start on first
+// use, one per core, or GART_THREADS of them in all.
+//
+// It also holds the templates of the slices, vecs and maps of generated
+// code, which each module's header instantiates for the types it uses.
+
+// GART_SCOPED frees a function's arena as it returns; without it the
+// arena lasts as long as the program. A string literal is one weak array,
+// which the linker keeps once for all modules. The cold paths of a
+// template may go unused where it is instantiated.
+#if defined(__GNUC__)
+#define GART_ALWAYS_INLINE static inline __attribute__((always_inline))
+#define GART_COLD __attribute__((cold, noinline, unused))
+#define GART_SCOPED(fn) __attribute__((cleanup(fn)))
+#define GART_LITERAL(name, text) __attribute__((weak)) const char name[] = text;
+#else
+#define GART_ALWAYS_INLINE static inline
+#define GART_COLD
+#define GART_SCOPED(fn)
+#define GART_LITERAL(name, text) static const char name[] = text;
+#endif
+
+// Prints the message, with up to three numbers in it, and exits.
+_Noreturn GART_COLD void gart_fail(const char *format, int64_t a, int64_t b, int64_t c);
+
+// Indexing and slicing check their bounds unless the program is built
+// with --no-bounds-check.
+#if defined(GART_NO_BOUNDS_CHECK)
+#define GART_CHECK_INDEX(i, len)
+#define GART_CHECK_RANGE(lo, hi, len)
+#else
+#define GART_CHECK_INDEX(i, len) \
+    if ((uint64_t)(i) >= (uint64_t)(len)) gart_fail("index %lld out of bounds for length %lld\n", i, len, 0)
+#define GART_CHECK_RANGE(lo, hi, len) \
+    if ((lo) < 0 || (lo) > (hi) || (hi) > (len)) \
+        gart_fail("slice [%lld:%lld] out of bounds for length %lld\n", lo, hi, len)
+#endif
+
+static inline int64_t gart_index(int64_t i, int64_t len) {
+    GART_CHECK_INDEX(i, len);
+    (void)len;
+    return i;
+}
+
+// The tasks one function spawned and hasn't synced yet.
+struct gart_frame {
+    _Atomic int64_t pending;
+};
+
+// Runs fn(args) as a task of `frame`, on any worker. `size` bytes of args
+// are copied, so they may live on the spawner's stack.
+void gart_spawn(struct gart_frame *frame, void (*fn)(void *args), const void *args, size_t size);
+
+// Waits for every task of `frame`, running other tasks meanwhile.
+void gart_sync(struct gart_frame *frame);
+
+// Calls body(ctx, lo, hi) on ranges covering iterations [0, count), split
+// in halves down to a grain that gives each worker several to steal.
+void gart_parallel_for(int64_t count, void (*body)(void *ctx, int64_t lo, int64_t hi), void *ctx);
+
+// Turns of 'parallel for i = start, end, step', which includes end.
+static inline int64_t gart_count(int64_t start, int64_t end, int64_t step) {
+    if (step > 0) return end < start ? 0 : (end - start) / step + 1;
+    return end > start ? 0 : (start - end) / -step + 1;
+}
+
+// Serializes merging the partial results of 'parallel for' reductions.
+void gart_lock(void);
+void gart_unlock(void);
+
+// Number of workers, starting them if needed.
+int gart_workers(void);
+
+// Bump allocator behind the arrays a program creates: memory is handed
+// out from large blocks, zero-filled, and released all at once. A
+// function whose arrays never outlive it allocates them from an arena of
+// its own, freed when it returns; the rest come from gart_heap.
+struct gart_block;
+
+struct gart_arena {
+    struct gart_block *block;
+    char              *ptr;
+    char              *end;
+};
+
+// The calling thread's arena, freed with the program.
+extern _Thread_local struct gart_arena gart_heap;
+
+// Starts a new block for what doesn't fit in the current one.
+void *gart_arena_grow(struct gart_arena *arena, size_t size, size_t align);
+void gart_arena_free(struct gart_arena *arena);
+
+// `align` is a power of two.
+static inline void *gart_arena_alloc(struct gart_arena *arena, size_t size, size_t align) {
+    uintptr_t at = ((uintptr_t)arena->ptr + align - 1) & ~(uintptr_t)(align - 1);
+    if (!arena->ptr || at > (uintptr_t)arena->end || size > (uintptr_t)arena->end - at) {
+        return gart_arena_grow(arena, size, align);
+    }
+    arena->ptr = (char *)at + size;
+    return memset((char *)at, 0, size);
+}
+
+// Makes a block `old`, `size` bytes allocated from `arena`, `new_size`
+// bytes long: in place when it is the arena's last allocation and the
+// block has room, else as a copy, leaving the old bytes to the arena.
+// The added bytes are zero.
+void *gart_arena_resize(struct gart_arena *arena, void *old, size_t size, size_t new_size, size_t align);
+
+// The arena a vec or map grows in: its function's, or for NULL the
+// gart_heap of whichever thread is growing it.
+static inline struct gart_arena *gart_arena_of(struct gart_arena *arena) {
+    return arena ? arena : &gart_heap;
+}
+
+// Bytes for `len` elements, rounded up to a multiple of `align`; small
+// enough that a struct's worth of them can be added up.
+static inline size_t gart_span(int64_t len, size_t size, size_t align) {
+    if (len < 0) gart_fail("array length %lld is negative\n", len, 0, 0);
+    if ((uint64_t)len > SIZE_MAX / 1024 / size) gart_fail("out of memory for %lld elements\n", len, 0, 0);
+    return ((size_t)len * size + align - 1) / align * align;
+}
+
+// Zero-filled, from the function's arena or gart_heap.
+static inline void *gart_alloc(struct gart_arena *arena, int64_t len, size_t size, size_t align) {
+    return gart_arena_alloc(arena, gart_span(len, size, 1), align);
+}
+
+// Slices: a pointer and a length per element type.
+#define GART_SLICE(T, name) \
+    typedef struct { T *ptr; int64_t len; } name; \
+    static inline T *name##_at(name s, int64_t i) { \
+        GART_CHECK_INDEX(i, s.len); \
+        return &s.ptr[i]; \
+    } \
+    static inline name name##_sub(name s, int64_t lo, int64_t hi) { \
+        GART_CHECK_RANGE(lo, hi, s.len); \
+        return (name){ s.ptr + lo, hi - lo }; \
+    } \
+    static inline name name##_from(name s, int64_t lo) { \
+        return name##_sub(s, lo, s.len); \
+    } \
+    static inline name name##_alloc(struct gart_arena *arena, int64_t len) { \
+        return (name){ gart_alloc(arena, len, sizeof(T), _Alignof(T)), len }; \
+    }
+
+// A gart string: 16 bytes, passed by value, that know their length.
+// Strings of up to GART_STR_SMALL bytes are stored inline, NUL-terminated,
+// with the length in the last byte; longer ones point at their bytes,
+// with the top bit of that byte set. The bytes a string points at are
+// followed by readable memory up to a NUL, though not always right away:
+// a substring may end inside the string it was cut from. All zero bytes
+// make the empty string.
+typedef union gart_str {
+    struct {
+        const char *ptr;
+        uint64_t    len;    // GART_STR_PACK(length)
+    } big;
+    char small[16];
+} gart_str;
+
+#define GART_STR_SMALL 14
+
+// The length of a long string, packed so that its flag lands in small[15].
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define GART_STR_PACK(len)   ((uint64_t)(len) << 8 | 0x80)
+#define GART_STR_UNPACK(len) ((len) >> 8)
+#else
+#define GART_STR_PACK(len)   ((uint64_t)(len) | (uint64_t)1 << 63)
+#define GART_STR_UNPACK(len) ((len) & ~((uint64_t)1 << 63))
+#endif
+
+// A string literal: `bytes` is its static array, shared by every module.
+#define GART_STR_INIT(bytes, len) { .big = { bytes, GART_STR_PACK(len) } }
+#define GART_STR(bytes, len) ((gart_str)GART_STR_INIT(bytes, len))
+
+static inline int gart_str_is_small(gart_str s) {
+    return !((unsigned char)s.small[15] & 0x80);
+}
+
+static inline int64_t gart_str_len(gart_str s) {
+    return gart_str_is_small(s) ? (unsigned char)s.small[15] : (int64_t)GART_STR_UNPACK(s.big.len);
+}
+
+// The bytes of *s, which for a short string are inside it.
+static inline const char *gart_str_data(const gart_str *s) {
+    return gart_str_is_small(*s) ? s->small : s->big.ptr;
+}
+
+// Byte i, as 0 to 255; i is in bounds.
+static inline int gart_str_byte(gart_str s, int64_t i) {
+    return (unsigned char)(gart_str_is_small(s) ? s.small[i] : s.big.ptr[i]);
+}
+
+// Strings from C, NULL included, which stays apart from the empty string.
+static inline gart_str gart_str_of_c(const char *s) {
+    return (gart_str){ .big = { s, GART_STR_PACK(s ? strlen(s) : 0) } };
+}
+
+static inline int gart_str_is_null(gart_str s) {
+    return !gart_str_is_small(s) && !s.big.ptr;
+}
+
+// A NUL-terminated copy of `len` bytes at `s`, for strings that need one.
+const char *gart_str_terminate(const char *s, size_t len);
+
+// *s for C: its own bytes when a NUL follows them, else a copy.
+static inline const char *gart_str_cstr(const gart_str *s) {
+    if (gart_str_is_small(*s)) return s->small;
+    size_t len = GART_STR_UNPACK(s->big.len);
+    if (!s->big.ptr || s->big.ptr[len] == '\0') return s->big.ptr;
+    return gart_str_terminate(s->big.ptr, len);
+}
+
+// A new string holding a copy of `len` bytes at `s`.
+gart_str gart_str_make(const char *s, int64_t len);
+
+// Bytes lo up to hi of s, in bounds: a view of a long string, a copy
+// when short enough to be stored inline.
+static inline gart_str gart_str_view(gart_str s, int64_t lo, int64_t hi) {
+    if (hi - lo <= GART_STR_SMALL || gart_str_is_small(s)) {
+        gart_str sub = {0};
+        memcpy(sub.small, gart_str_data(&s) + lo, hi - lo);
+        sub.small[15] = (char)(hi - lo);
+        return sub;
+    }
+    return (gart_str){ .big = { s.big.ptr + lo, GART_STR_PACK(hi - lo) } };
+}
+
+static inline int gart_str_eq(gart_str a, gart_str b) {
+    int64_t len = gart_str_len(a);
+    return len == gart_str_len(b) && memcmp(gart_str_data(&a), gart_str_data(&b), len) == 0;
+}
+
+// Negative, zero or positive as a sorts before, with or after b, by bytes.
+int gart_str_cmp(gart_str a, gart_str b);
+
+// a + b. Appending to the string made last on this thread extends it in
+// place, so building a string piece by piece copies each piece once.
+gart_str gart_str_cat(gart_str a, gart_str b);
+// parts[0] + ... + parts[count - 1], with one allocation.
+gart_str gart_str_join(const gart_str *parts, int count);
+
+static inline int gart_str_at(gart_str s, int64_t i) {
+    GART_CHECK_INDEX(i, gart_str_len(s));
+    return gart_str_byte(s, i);
+}
+
+static inline gart_str gart_str_sub(gart_str s, int64_t lo, int64_t hi) {
+    GART_CHECK_RANGE(lo, hi, gart_str_len(s));
+    return gart_str_view(s, lo, hi);
+}
+
+static inline gart_str gart_str_from(gart_str s, int64_t lo) {
+    return gart_str_sub(s, lo, gart_str_len(s));
+}
+
+GART_SLICE(int, gart_slice_int)
+GART_SLICE(int64_t, gart_slice_int64)
+GART_SLICE(float, gart_slice_float)
+GART_SLICE(double, gart_slice_double)
+GART_SLICE(bool, gart_slice_bool)
+GART_SLICE(gart_str, gart_slice_str)
+GART_SLICE(void *, gart_slice_pointer)
+
+// Hashing, for map keys. Numbers and pointers go through a 64-bit
+// finalizer, so keys that differ only in their high bits still spread.
+static inline uint64_t gart_hash_int(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static inline uint64_t gart_hash_double(double d) {
+    uint64_t bits;
+    d += 0.0;   // -0.0 == 0.0, so they hash the same
+    memcpy(&bits, &d, sizeof(bits));
+    return gart_hash_int(bits);
+}
+
+static inline uint64_t gart_hash_pointer(const void *p) {
+    return gart_hash_int((uintptr_t)p);
+}
+
+uint64_t gart_hash_bytes(const char *s, size_t len);
+
+static inline uint64_t gart_hash_str(gart_str s) {
+    return gart_hash_bytes(gart_str_data(&s), gart_str_len(s));
+}
+
+#define GART_EQ(a, b) ((a) == (b))
+
+// The index of a map, after SwissTable: open addressing over a power of
+// two of slots, each with a control byte that is GART_EMPTY, GART_DELETED
+// or 7 bits of the hash of the key in it. A lookup probes groups of 16
+// slots, from the group the rest of the hash picks on, comparing all 16
+// control bytes at once (SSE2) and looking at keys only where they match,
+// until a group with an empty slot. The control bytes of the first group
+// are repeated past the end, so a group can start at any slot. A slot
+// holds the number of an entry; the map keeps its keys and values in
+// insertion order in arrays of their own, so iterating them is a walk
+// over contiguous memory.
+#define GART_GROUP   16
+#define GART_EMPTY   ((int8_t)-128)
+#define GART_DELETED ((int8_t)-2)
+
+struct gart_table {
+    int8_t            *ctrl;    // mask + 1 + GART_GROUP control bytes
+    uint32_t          *slots;   // entry of each full slot
+    int64_t            mask;    // slots - 1, 0 before the first insert
+    int64_t            fill;    // entries it takes before growing, what the arrays hold
+    int64_t            room;    // empty slots that may still be filled
+    int64_t            reserve; // entries to make room for on the first insert
+    struct gart_arena *arena;   // as for gart_arena_of
+    float              load;    // most of the slots that fill
+};
+
+// The control bytes of a table without slots: a lookup finds nothing
+// and an insert grows it first.
+extern const int8_t gart_empty_group[GART_GROUP];
+
+#define GART_TABLE_INIT(reserve, load) \
+    { (int8_t *)gart_empty_group, NULL, 0, 0, 0, reserve, NULL, load }
+
+#if defined(__GNUC__)
+#define gart_ctz(x) __builtin_ctz(x)
+#else
+static inline int gart_ctz(uint32_t x) {
+    int n = 0;
+    while (!(x & 1)) x >>= 1, n++;
+    return n;
+}
+#endif
+
+// Bit i of each is set for control byte i of the group at `ctrl`: equal
+// to h2, GART_EMPTY, and either empty or deleted.
+#if defined(__SSE2__)
+#include <emmintrin.h>
+
+static inline uint32_t gart_group_match(const int8_t *ctrl, int8_t h2) {
+    __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(h2)));
+}
+
+static inline uint32_t gart_group_empty(const int8_t *ctrl) {
+    return gart_group_match(ctrl, GART_EMPTY);
+}
+
+static inline uint32_t gart_group_free(const int8_t *ctrl) {
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+}
+#else
+static inline uint32_t gart_group_match(const int8_t *ctrl, int8_t h2) {
+    uint32_t bits = 0;
+    for (int i = 0; i < GART_GROUP; i++) bits |= (uint32_t)(ctrl[i] == h2) << i;
+    return bits;
+}
+
+static inline uint32_t gart_group_empty(const int8_t *ctrl) {
+    return gart_group_match(ctrl, GART_EMPTY);
+}
+
+static inline uint32_t gart_group_free(const int8_t *ctrl) {
+    uint32_t bits = 0;
+    for (int i = 0; i < GART_GROUP; i++) bits |= (uint32_t)(ctrl[i] < 0) << i;
+    return bits;
+}
+#endif
+
+#define GART_H1(hash) ((int64_t)((hash) >> 7))
+#define GART_H2(hash) ((int8_t)((hash) & 0x7f))
+
+static inline void gart_table_set(struct gart_table *t, int64_t slot, int8_t ctrl) {
+    t->ctrl[slot] = ctrl;
+    t->ctrl[((slot - GART_GROUP) & t->mask) + GART_GROUP] = ctrl;
+}
+
+// Puts `entry`, whose key hashes to `hash`, in the first free slot of its
+// probe sequence; the table has room.
+static inline void gart_table_claim(struct gart_table *t, uint64_t hash, int64_t entry) {
+    int64_t pos = GART_H1(hash) & t->mask;
+    uint32_t free;
+    for (int64_t step = GART_GROUP; !(free = gart_group_free(t->ctrl + pos)); step += GART_GROUP) {
+        pos = (pos + step) & t->mask;
+    }
+    int64_t slot = (pos + gart_ctz(free)) & t->mask;
+    t->room -= t->ctrl[slot] == GART_EMPTY;
+    gart_table_set(t, slot, GART_H2(hash));
+    t->slots[slot] = (uint32_t)entry;
+}
+
+// Gives the table new, empty slots for `len` entries and at least one
+// more: twice as many when the entries fill more than half of it, the
+// same number when deletions left the rest (or `reserve` on the first
+// insert). The caller claims a slot for each of its entries again.
+void gart_table_rebuild(struct gart_table *t, int64_t len);
+
+// Points the slot of entry `from`, whose key hashes to `hash`, at `to`.
+void gart_table_move(struct gart_table *t, uint64_t hash, int64_t from, int64_t to);
+
+// Makes room for more elements of `size` bytes at `ptr`, *cap of them so
+// far, in `arena` (NULL for gart_heap): `reserve`, at least 4, the first
+// time, then *cap times `grow`. Returns where they are now.
+void *gart_vec_grow(struct gart_arena *arena, void *ptr, int64_t *cap, int64_t reserve, float grow,
+                    size_t size, size_t align);
+
+// Vecs and maps, reached through a pointer. A vec grows by its factor in
+// the arena it was made from, or gart_heap.
+#define GART_VEC_INIT(reserve, grow) { NULL, 0, 0, reserve, NULL, grow }
+#define GART_VEC(T, name, slice) \
+    typedef struct name { T *ptr; int64_t len, cap, reserve; struct gart_arena *arena; float grow; } name; \
+    static inline name *name##_new(struct gart_arena *arena, int64_t reserve, float grow) { \
+        name *v = gart_arena_alloc(arena, sizeof(name), _Alignof(name)); \
+        *v = (name)GART_VEC_INIT(reserve, grow); \
+        v->arena = arena == &gart_heap ? NULL : arena; \
+        return v; \
+    } \
+    static inline void name##_push(name *v, T x) { \
+        if (v->len == v->cap) { \
+            v->ptr = gart_vec_grow(v->arena, v->ptr, &v->cap, v->reserve, v->grow, sizeof(T), _Alignof(T)); \
+        } \
+        v->ptr[v->len++] = x; \
+    } \
+    static inline T name##_pop(name *v) { \
+        if (v->len == 0) gart_fail("pop from an empty vec\n", 0, 0, 0); \
+        return v->ptr[--v->len]; \
+    } \
+    static inline T *name##_at(name *v, int64_t i) { \
+        GART_CHECK_INDEX(i, v->len); \
+        return &v->ptr[i]; \
+    } \
+    static inline slice name##_view(name *v) { \
+        return (slice){ v->ptr, v->len }; \
+    }
+
+// A map keeps its entries in insertion order behind a gart_table; del
+// moves the last entry into the hole, so the entries stay dense. `hash`
+// and `eq` take keys.
+#define GART_MAP_INIT(reserve, load) { NULL, NULL, 0, GART_TABLE_INIT(reserve, load) }
+#define GART_MAP(K, V, name, key_slice, value_slice, hash, eq) \
+    typedef struct name { K *keys; V *values; int64_t len; struct gart_table index; } name; \
+    static inline name *name##_new(struct gart_arena *arena, int64_t reserve, float load) { \
+        name *m = gart_arena_alloc(arena, sizeof(name), _Alignof(name)); \
+        *m = (name)GART_MAP_INIT(reserve, load); \
+        m->index.arena = arena == &gart_heap ? NULL : arena; \
+        return m; \
+    } \
+    static inline int64_t name##_slot(const name *m, K k, uint64_t h) { \
+        const struct gart_table *t = &m->index; \
+        int64_t pos = GART_H1(h) & t->mask; \
+        for (int64_t step = GART_GROUP;; step += GART_GROUP) { \
+            for (uint32_t match = gart_group_match(t->ctrl + pos, GART_H2(h)); match; match &= match - 1) { \
+                int64_t slot = (pos + gart_ctz(match)) & t->mask; \
+                if (eq(m->keys[t->slots[slot]], k)) return slot; \
+            } \
+            if (gart_group_empty(t->ctrl + pos)) return -1; \
+            pos = (pos + step) & t->mask; \
+        } \
+    } \
+    static GART_COLD void name##_rehash(name *m) { \
+        struct gart_arena *arena = gart_arena_of(m->index.arena); \
+        int64_t fill = m->index.fill; \
+        gart_table_rebuild(&m->index, m->len); \
+        m->keys = gart_arena_resize(arena, m->keys, fill * sizeof(K), m->index.fill * sizeof(K), _Alignof(K)); \
+        m->values = gart_arena_resize(arena, m->values, fill * sizeof(V), m->index.fill * sizeof(V), _Alignof(V)); \
+        for (int64_t e = 0; e < m->len; e++) gart_table_claim(&m->index, hash(m->keys[e]), e); \
+    } \
+    static inline V name##_get(const name *m, K k) { \
+        int64_t slot = name##_slot(m, k, hash(k)); \
+        return slot < 0 ? (V){0} : m->values[m->index.slots[slot]]; \
+    } \
+    static inline V *name##_put(name *m, K k) { \
+        uint64_t h = hash(k); \
+        int64_t slot = name##_slot(m, k, h); \
+        if (slot >= 0) return &m->values[m->index.slots[slot]]; \
+        if (m->index.room == 0) name##_rehash(m); \
+        int64_t e = m->len++; \
+        gart_table_claim(&m->index, h, e); \
+        m->keys[e] = k; \
+        memset(&m->values[e], 0, sizeof(V)); \
+        return &m->values[e]; \
+    } \
+    static inline bool name##_has(const name *m, K k) { \
+        return name##_slot(m, k, hash(k)) >= 0; \
+    } \
+    static inline bool name##_del(name *m, K k) { \
+        int64_t slot = name##_slot(m, k, hash(k)); \
+        if (slot < 0) return false; \
+        int64_t e = m->index.slots[slot], last = --m->len; \
+        gart_table_set(&m->index, slot, GART_DELETED); \
+        if (e != last) { \
+            gart_table_move(&m->index, hash(m->keys[last]), last, e); \
+            m->keys[e] = m->keys[last]; \
+            m->values[e] = m->values[last]; \
+        } \
+        return true; \
+    } \
+    static inline key_slice name##_keys(const name *m) { \
+        return (key_slice){ m->keys, m->len }; \
+    } \
+    static inline value_slice name##_values(const name *m) { \
+        return (value_slice){ m->values, m->len }; \
+    }
+
+// What a println writes, put together here and handed to stdout in one
+// piece, or in several when it outgrows the buffer. gart parses the
+// format while translating and calls a writer per conversion.
+struct gart_line {
+    size_t len;
+    char   buf[512];
+};
+
+// Writes what the buffer holds to stdout.
+void gart_line_flush(struct gart_line *line);
+// Text too long for what is left of the buffer.
+void gart_line_write(struct gart_line *line, const char *s, size_t len);
+
+static inline void gart_line_str(struct gart_line *line, const char *s, size_t len) {
+    if (len > sizeof(line->buf) - line->len) {
+        gart_line_write(line, s, len);
+        return;
+    }
+    memcpy(line->buf + line->len, s, len);
+    line->len += len;
+}
+
+static inline void gart_line_char(struct gart_line *line, char c) {
+    if (line->len == sizeof(line->buf)) gart_line_flush(line);
+    line->buf[line->len++] = c;
+}
+
+void gart_line_int(struct gart_line *line, int64_t value);             // %d
+void gart_line_uint(struct gart_line *line, uint64_t value);           // %u
+void gart_line_hex(struct gart_line *line, uint64_t value, int upper); // %x, %X
+void gart_line_double(struct gart_line *line, double value, int precision); // %f, %.Nf
+// %s
+static inline void gart_line_text(struct gart_line *line, gart_str s) {
+    if (gart_str_is_null(s)) {
+        gart_line_str(line, "(null)", 6);   // what glibc's printf writes
+        return;
+    }
+    gart_line_str(line, gart_str_data(&s), gart_str_len(s));
+}
+// Any other conversion, through snprintf.
+void gart_line_format(struct gart_line *line, const char *spec, ...);
+
+#endif // GART_RT_H
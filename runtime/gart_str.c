@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gart_rt.h"
+
+// `size` bytes from the end of gart_heap, which strings never give back.
+static char *reserve(size_t size) {
+    struct gart_arena *heap = &gart_heap;
+    if (heap->ptr && size <= (size_t)(heap->end - heap->ptr)) {
+        char *at = heap->ptr;
+        heap->ptr += size;
+        return at;
+    }
+    return gart_arena_grow(heap, size, 1);
+}
+
+const char *gart_str_terminate(const char *s, size_t len) {
+    char *copy = reserve(len + 1);
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+gart_str gart_str_make(const char *s, int64_t len) {
+    gart_str str = {0};
+    if (len <= GART_STR_SMALL) {
+        memcpy(str.small, s, len);
+        str.small[15] = (char)len;
+        return str;
+    }
+    str.big.ptr = gart_str_terminate(s, len);
+    str.big.len = GART_STR_PACK(len);
+    return str;
+}
+
+int gart_str_cmp(gart_str a, gart_str b) {
+    int64_t a_len = gart_str_len(a), b_len = gart_str_len(b);
+    int order = memcmp(gart_str_data(&a), gart_str_data(&b), a_len < b_len ? a_len : b_len);
+    if (order) return order;
+    return a_len < b_len ? -1 : a_len > b_len;
+}
+
+gart_str gart_str_cat(gart_str a, gart_str b) {
+    int64_t a_len = gart_str_len(a), b_len = gart_str_len(b);
+    int64_t len = a_len + b_len;
+    if (len <= GART_STR_SMALL) {
+        gart_str str = {0};
+        memcpy(str.small, gart_str_data(&a), a_len);
+        memcpy(str.small + a_len, gart_str_data(&b), b_len);
+        str.small[15] = (char)len;
+        return str;
+    }
+    struct gart_arena *heap = &gart_heap;
+    if (!gart_str_is_small(a) && a.big.ptr + a_len + 1 == heap->ptr && b_len <= heap->end - heap->ptr) {
+        // a ends with the last thing allocated: its NUL moves to the new end
+        char *end = heap->ptr - 1;
+        memcpy(end, gart_str_data(&b), b_len);
+        end[b_len] = '\0';
+        heap->ptr += b_len;
+        return (gart_str){ .big = { a.big.ptr, GART_STR_PACK(len) } };
+    }
+    char *bytes = reserve(len + 1);
+    memcpy(bytes, gart_str_data(&a), a_len);
+    memcpy(bytes + a_len, gart_str_data(&b), b_len);
+    bytes[len] = '\0';
+    return (gart_str){ .big = { bytes, GART_STR_PACK(len) } };
+}
+
+gart_str gart_str_join(const gart_str *parts, int count) {
+    int64_t len = 0;
+    for (int i = 0; i < count; i++) len += gart_str_len(parts[i]);
+    gart_str str = {0};
+    char *bytes = len <= GART_STR_SMALL ? str.small : reserve(len + 1);
+    char *at = bytes;
+    for (int i = 0; i < count; i++) {
+        int64_t part = gart_str_len(parts[i]);
+        memcpy(at, gart_str_data(&parts[i]), part);
+        at += part;
+    }
+    if (len <= GART_STR_SMALL) {
+        str.small[15] = (char)len;
+        return str;
+    }
+    *at = '\0';
+    return (gart_str){ .big = { bytes, GART_STR_PACK(len) } };
+}
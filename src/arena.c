@@ -0,0 +1,57 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+#define ARENA_BLOCK_SIZE 0x10000
+#define ARENA_ALIGN      16
+
+void *arena_alloc(struct Arena *arena, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    if ((size_t)(arena->end - arena->ptr) < size) {
+        size_t block_size = size > ARENA_BLOCK_SIZE / 4 ? size : ARENA_BLOCK_SIZE;
+        struct ArenaBlock *block = malloc(sizeof(struct ArenaBlock) + block_size);
+        if (!block) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        block->size = block_size;
+
+        if (block_size == ARENA_BLOCK_SIZE || !arena->block) {
+            block->prev = arena->block;
+            arena->block = block;
+            arena->ptr = block->data;
+            arena->end = block->data + block_size;
+        } else {
+            // oversized request: keep bumping in the current block
+            block->prev = arena->block->prev;
+            arena->block->prev = block;
+            return block->data;
+        }
+    }
+
+    void *mem = arena->ptr;
+    arena->ptr += size;
+    return mem;
+}
+
+char *arena_strndup(struct Arena *arena, const char *str, size_t len) {
+    char *copy = arena_alloc(arena, len + 1);
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+void arena_free(struct Arena *arena) {
+    struct ArenaBlock *block = arena->block;
+    while (block) {
+        struct ArenaBlock *prev = block->prev;
+        free(block);
+        block = prev;
+    }
+    arena->block = NULL;
+    arena->ptr = NULL;
+    arena->end = NULL;
+}
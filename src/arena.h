@@ -0,0 +1,24 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Bump allocator: memory is handed out from large blocks and only ever
+// released all at once with arena_free.
+struct ArenaBlock {
+    struct ArenaBlock *prev;
+    size_t size;
+    char data[];
+};
+
+struct Arena {
+    struct ArenaBlock *block;
+    char *ptr;
+    char *end;
+};
+
+void *arena_alloc(struct Arena *arena, size_t size);
+char *arena_strndup(struct Arena *arena, const char *str, size_t len);
+void arena_free(struct Arena *arena);
+
+#endif // ARENA_H
@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast.h"
+
+void ast_init(struct Ast *ast) {
+    memset(ast, 0, sizeof(*ast));
+    ast->node_cap = 1024;
+    ast->nodes = malloc(ast->node_cap * sizeof(struct Node));
+    if (!ast->nodes) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    // node 0 is the null node
+    memset(&ast->nodes[0], 0, sizeof(struct Node));
+    ast->node_count = 1;
+}
+
+void ast_free(struct Ast *ast) {
+    free(ast->nodes);
+    free(ast->records);
+    scope_free(&ast->globals);
+    memset(ast, 0, sizeof(*ast));
+}
+
+NodeId ast_new(struct Ast *ast, int kind) {
+    if (ast->node_count == ast->node_cap) {
+        ast->node_cap *= 2;
+        ast->nodes = realloc(ast->nodes, ast->node_cap * sizeof(struct Node));
+        if (!ast->nodes) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+    NodeId id = ast->node_count++;
+    struct Node *node = AST_NODE(ast, id);
+    memset(node, 0, sizeof(*node));
+    node->kind = kind;
+    return id;
+}
+
+void ast_append(struct Ast *ast, NodeId parent, NodeId *last, NodeId child) {
+    if (*last) {
+        AST_NODE(ast, *last)->next = child;
+    } else {
+        AST_NODE(ast, parent)->lhs = child;
+    }
+    *last = child;
+}
+
+uint16_t ast_add_record(struct Ast *ast, NodeId decl) {
+    if (ast->record_count == UINT16_MAX) return 0;
+    if (ast->record_count + 1u >= ast->record_cap) {
+        ast->record_cap = ast->record_cap ? ast->record_cap * 2 : 8;
+        ast->records = realloc(ast->records, ast->record_cap * sizeof(NodeId));
+        if (!ast->records) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+    // index 0 stands for "no struct"
+    if (ast->record_count == 0) ast->records[ast->record_count++] = 0;
+    ast->records[ast->record_count] = decl;
+    return ast->record_count++;
+}
+
+uint16_t ast_find_record(const struct Ast *ast, Sym name) {
+    for (uint16_t r = 1; r < ast->record_count; r++) {
+        if (AST_NODE(ast, ast->records[r])->name == name) return r;
+    }
+    return 0;
+}
+
+NodeId ast_find_field(const struct Ast *ast, uint16_t record, Sym name) {
+    if (record == 0 || record >= ast->record_count) return 0;
+    for (NodeId field = AST_NODE(ast, ast->records[record])->lhs; field; field = AST_NODE(ast, field)->next) {
+        if (AST_NODE(ast, field)->name == name) return field;
+    }
+    return 0;
+}
+
+bool ast_array_length(struct Ast *ast, NodeId id, long *len) {
+    struct Node *node = AST_NODE(ast, id);
+    if (node->kind == NODE_IDENT) {
+        struct Node *decl = node->rhs ? AST_NODE(ast, node->rhs) : NULL;
+        if (!decl || decl->kind != NODE_VARIABLE || (decl->flags & NODE_ASSIGNED) || !decl->lhs) return false;
+        node = AST_NODE(ast, decl->lhs);
+    }
+    if (node->kind == NODE_ARRAY) {
+        *len = 0;
+        for (NodeId element = node->lhs; element; element = AST_NODE(ast, element)->next) (*len)++;
+        return true;
+    }
+    // a vec or map only reserves room, its length changes
+    if (node->kind == NODE_ARRAY_NEW && node->type != TYPE_VEC && node->type != TYPE_MAP
+        && AST_NODE(ast, node->lhs)->kind == NODE_INT) {
+        *len = AST_NODE(ast, node->lhs)->int_value;
+        return true;
+    }
+    return false;
+}
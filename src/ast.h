@@ -0,0 +1,178 @@
+#ifndef AST_H
+#define AST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "intern.h"
+#include "symtab.h"
+
+// Nodes live in one flat array and refer to each other by index, so the
+// whole tree is a couple of allocations no matter how big the program is.
+// Index 0 is reserved as the "no node" value.
+typedef uint32_t NodeId;
+
+enum NodeKind {
+    NODE_NONE,
+    NODE_FUNCTION,  // name, type = return type; lhs = first statement; rhs = first parameter
+    NODE_PARAM,     // name, type
+    NODE_VARIABLE,  // name; lhs = initializer
+    NODE_RETURN,    // lhs = value
+    NODE_CALL,      // name; lhs = first argument; rhs = function, once resolved;
+                    // op = enum Builtin for push, pop, ... on a vec or map
+    NODE_INT,       // int_value
+    NODE_FLOAT,     // float_value
+    NODE_STRING,    // str
+    NODE_BOOL,      // int_value
+    NODE_NULL,
+    NODE_IDENT,     // name; rhs = variable, once resolved
+    NODE_UNARY,     // op; lhs = operand
+    NODE_BINARY,    // op; lhs, rhs = operands
+    NODE_CAST,      // type; lhs = operand
+    NODE_BLOCK,     // lhs = first statement
+    NODE_IF,        // lhs = condition; rhs = then block; alt = else block, or an 'elif' NODE_IF
+    NODE_WHILE,     // lhs = condition; rhs = body block
+    NODE_FOR,       // lhs = loop variable (initialized to the start); rhs = body block;
+                    // alt = end, whose next is the step, if given. The loop variable
+                    // of a 'simd for' or 'parallel for' lists in rhs what cgen needs
+                    // around the loop, see parallel.h
+    NODE_ASSIGN,    // op = OP_NONE or the operator of a compound assignment; lhs = IDENT; rhs = value
+    NODE_BREAK,
+    NODE_CONTINUE,
+    NODE_ARRAY,     // lhs = first element
+    NODE_ARRAY_NEW, // elem; lhs = length, zero-filled. With type TYPE_VEC or TYPE_MAP
+                    // a new empty container: lhs = entries to reserve; float_value =
+                    // growth factor or maximum load, 0 for the default
+    NODE_INDEX,     // lhs = array; rhs = index
+    NODE_SLICE,     // lhs = array; rhs = start; alt = end, 0 for the array's end
+    NODE_LEN,       // lhs = array
+    NODE_STRUCT,    // name; lhs = first field; rhs = alignment from 'align(N)', 0 if none
+    NODE_FIELD,     // name, type, elem, record; rhs = alignment from 'align(N)', 0 if none
+    NODE_CONSTRUCT, // name, record; lhs = first field value in declaration order, none for all zero
+    NODE_MEMBER,    // name; lhs = struct value; rhs = field, once typed
+    NODE_SYNC,      // waits for the tasks the function spawned
+    NODE_FUNC_REF,  // name; rhs = function, 0 for one of another module: a function
+                    // used as a value, a pointer to it
+};
+
+enum VarType {
+    TYPE_NONE,
+    TYPE_INT,       // C int, what functions return unless told otherwise
+    TYPE_INT64,
+    TYPE_FLOAT,
+    TYPE_DOUBLE,
+    TYPE_BOOL,
+    TYPE_STR,
+    TYPE_POINTER,
+    TYPE_SLICE,     // pointer and length of `elem`s: arrays and views into them
+    TYPE_STRUCT,    // the struct declared by ast->records[record]
+    TYPE_VEC,       // growable array of `elem`s, by reference
+    TYPE_MAP,       // hash map, by reference; elem = MAP_ELEM(key type, value type)
+};
+
+// A map's key and value types share its node's elem.
+#define MAP_ELEM(key, value) ((key) << 4 | (value))
+#define MAP_KEY(elem)        ((elem) >> 4)
+#define MAP_VALUE(elem)      ((elem) & 15)
+
+// Calls to these names with a vec or map as the first argument, when no
+// function of that name is declared.
+enum Builtin {
+    BUILTIN_NONE,
+    BUILTIN_PUSH,   // push(v, x): appends x to vec v
+    BUILTIN_POP,    // pop(v): removes and returns the last element
+    BUILTIN_HAS,    // has(m, k): whether map m holds key k
+    BUILTIN_DEL,    // del(m, k): removes k, returns whether it was there
+    BUILTIN_KEYS,   // keys(m): a slice of the keys in insertion order
+    BUILTIN_VALUES, // values(m): a slice of the values, in the same order
+};
+
+enum Op {
+    OP_NONE,
+    OP_NEG, OP_NOT, OP_BITNOT,                  // unary
+    OP_MUL, OP_DIV, OP_MOD,
+    OP_ADD, OP_SUB,
+    OP_SHL, OP_SHR,
+    OP_LT, OP_LE, OP_GT, OP_GE,
+    OP_EQ, OP_NE,
+    OP_BITAND, OP_BITXOR, OP_BITOR,
+    OP_AND, OP_OR,
+};
+
+enum NodeFlags {
+    NODE_GLOBAL    = 1 << 0,
+    NODE_DEAD      = 1 << 1,    // unreachable declaration, not emitted
+    NODE_INLINE    = 1 << 2,    // 'inline fn': inline whenever the body allows
+    NODE_NOINLINE  = 1 << 3,    // 'noinline fn': never inline
+    NODE_IN_HEADER = 1 << 4,    // function defined static inline in the module header
+    NODE_ASSIGNED  = 1 << 5,    // variable changed after its declaration
+    NODE_UNCHECKED = 1 << 6,    // index proven in bounds, no check emitted
+    NODE_SOA       = 1 << 7,    // 'soa struct': arrays of it are laid out field by field
+    NODE_SIMD      = 1 << 8,    // 'simd for': iterations are independent, vectorize the loop
+    NODE_RESTRICT  = 1 << 9,    // index read through its 'simd for's restrict pointer
+    NODE_PARALLEL  = 1 << 10,   // 'parallel for': iterations run on the runtime's workers
+    NODE_SPAWN     = 1 << 11,   // 'spawn f()': the call runs as a task
+    NODE_TASKS     = 1 << 12,   // function or 'parallel for' body that spawns; a return
+                                // or 'sync' that waits for its tasks
+    NODE_REGION    = 1 << 13,   // function with an arena freed as it returns; an
+                                // array allocated from it
+    NODE_FORMAT    = 1 << 14,   // println with a checked literal format, written
+                                // piece by piece
+    NODE_LITERAL   = 1 << 15,   // string literal emitted as a gart string, whose
+                                // array cgen_literals defines
+};
+
+struct Node {
+    uint8_t  kind;
+    uint8_t  op;        // enum Op, for unary and binary nodes
+    uint16_t flags;
+    uint8_t  type;      // enum VarType, for functions, parameters and casts
+    uint8_t  elem;      // enum VarType of the elements when type is TYPE_SLICE or TYPE_VEC
+    uint16_t record;    // struct of a TYPE_STRUCT value or elements, index into ast->records
+    NodeId   next;      // next sibling in a statement/argument/declaration list
+    NodeId   lhs;
+    NodeId   rhs;
+    union {
+        long        int_value;
+        double      float_value;
+        Sym         name;
+        Sym         str;
+        NodeId      alt;
+    };
+};
+
+struct Ast {
+    struct Node *nodes;
+    uint32_t     node_count;
+    uint32_t     node_cap;
+    NodeId       first;     // first top-level declaration
+    int          error_count;
+    struct Scope globals;   // module-level functions and variables
+    NodeId      *records;   // struct declarations in source order; [0] is unused
+    uint16_t     record_count;
+    uint32_t     record_cap;
+};
+
+#define AST_NODE(ast, id) (&(ast)->nodes[(id)])
+
+void ast_init(struct Ast *ast);
+void ast_free(struct Ast *ast);
+NodeId ast_new(struct Ast *ast, int kind);
+
+// Append `child` to the list whose head is parent->lhs; `last` tracks the tail.
+void ast_append(struct Ast *ast, NodeId parent, NodeId *last, NodeId child);
+
+// Registers a struct declaration and returns its record index, 0 when
+// there are too many of them.
+uint16_t ast_add_record(struct Ast *ast, NodeId decl);
+// Record index of the struct called `name`, 0 if none is declared (yet).
+uint16_t ast_find_record(const struct Ast *ast, Sym name);
+// Field `name` of struct `record`, 0 if it has none.
+NodeId ast_find_field(const struct Ast *ast, uint16_t record, Sym name);
+
+// Length of the array `id` evaluates to, when it is known while translating:
+// an array literal, '[n]T' with a constant n, or a variable never
+// reassigned that is initialized with one of those.
+bool ast_array_length(struct Ast *ast, NodeId id, long *len);
+
+#endif // AST_H
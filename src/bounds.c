@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "bounds.h"
+
+// The 'for' loops around the code being walked, innermost first.
+struct LoopFrame {
+    NodeId                  loop;
+    bool                    counter_fixed;  // the body never assigns the counter
+    const struct LoopFrame *outer;
+};
+
+static bool assigns(struct Ast *ast, NodeId first, NodeId var) {
+    for (NodeId stmt = first; stmt; stmt = AST_NODE(ast, stmt)->next) {
+        struct Node *node = AST_NODE(ast, stmt);
+        switch (node->kind) {
+            case NODE_ASSIGN:
+                if (AST_NODE(ast, node->lhs)->kind == NODE_IDENT && AST_NODE(ast, node->lhs)->rhs == var) return true;
+                break;
+            case NODE_BLOCK:
+                if (assigns(ast, node->lhs, var)) return true;
+                break;
+            case NODE_IF:
+                if (assigns(ast, node->rhs, var) || (node->alt && assigns(ast, node->alt, var))) return true;
+                break;
+            case NODE_WHILE:
+            case NODE_FOR:
+                if (assigns(ast, node->rhs, var)) return true;
+                break;
+        }
+    }
+    return false;
+}
+
+// k when the value of `id` is known to be len(array) - k, -1 otherwise.
+static long below_length(struct Ast *ast, NodeId id, NodeId array) {
+    struct Node *node = AST_NODE(ast, id);
+    switch (node->kind) {
+        case NODE_LEN: {
+            struct Node *of = AST_NODE(ast, node->lhs);
+            return of->kind == NODE_IDENT && of->rhs == array ? 0 : -1;
+        }
+        case NODE_BINARY: {
+            struct Node *k = AST_NODE(ast, node->rhs);
+            if (node->op != OP_SUB || k->kind != NODE_INT || k->int_value < 0) return -1;
+            long below = below_length(ast, node->lhs, array);
+            return below < 0 ? -1 : below + k->int_value;
+        }
+        case NODE_IDENT: {
+            struct Node *decl = node->rhs ? AST_NODE(ast, node->rhs) : NULL;
+            if (!decl || (decl->flags & NODE_ASSIGNED)) return -1;
+            // n itself, for an array made by '[n]T'
+            struct Node *made = AST_NODE(ast, AST_NODE(ast, array)->lhs);
+            if (AST_NODE(ast, array)->kind == NODE_VARIABLE && made->kind == NODE_ARRAY_NEW
+                && AST_NODE(ast, made->lhs)->kind == NODE_IDENT && AST_NODE(ast, made->lhs)->rhs == node->rhs) {
+                return 0;
+            }
+            if (decl->kind != NODE_VARIABLE || !decl->lhs) return -1;
+            return below_length(ast, decl->lhs, array);
+        }
+        case NODE_INT: {
+            // len(a) - 1 on an array of known length is folded to a constant
+            struct Node *decl = AST_NODE(ast, array);
+            long len;
+            if (decl->kind != NODE_VARIABLE || !decl->lhs || !ast_array_length(ast, decl->lhs, &len)) return -1;
+            return node->int_value >= 0 && node->int_value <= len ? len - node->int_value : -1;
+        }
+    }
+    return -1;
+}
+
+// Whether every value the counter of `loop` takes indexes into `array`.
+static bool loop_in_bounds(struct Ast *ast, NodeId loop, NodeId array) {
+    struct Node *node = AST_NODE(ast, loop);
+    NodeId start = AST_NODE(ast, node->lhs)->lhs;
+    NodeId end = node->alt;
+    NodeId step = AST_NODE(ast, end)->next;
+    NodeId low = start, high = end;
+    if (step) {
+        struct Node *s = AST_NODE(ast, step);
+        if (s->kind != NODE_INT || s->int_value == 0) return false;
+        if (s->int_value < 0) {
+            low = end;
+            high = start;
+        }
+    }
+    struct Node *first = AST_NODE(ast, low);
+    return first->kind == NODE_INT && first->int_value >= 0 && below_length(ast, high, array) >= 1;
+}
+
+static void check_index(struct Ast *ast, NodeId id, const struct LoopFrame *loops) {
+    struct Node *node = AST_NODE(ast, id);
+    struct Node *array = AST_NODE(ast, node->lhs);
+    struct Node *index = AST_NODE(ast, node->rhs);
+    if (array->kind != NODE_IDENT || !array->rhs || index->kind != NODE_IDENT || !index->rhs) return;
+    // a vec's length changes without assigning it, a map's index is a key
+    if (array->type == TYPE_VEC || array->type == TYPE_MAP) return;
+
+    // an array variable keeps its length unless it is reassigned; a
+    // function's gvar keeps the length of the first call, so only a
+    // constant one is known
+    struct Node *decl = AST_NODE(ast, array->rhs);
+    long len;
+    if (decl->flags & NODE_ASSIGNED) return;
+    if ((decl->flags & NODE_GLOBAL) && !(decl->lhs && ast_array_length(ast, decl->lhs, &len))) return;
+
+    for (const struct LoopFrame *frame = loops; frame; frame = frame->outer) {
+        if (AST_NODE(ast, frame->loop)->lhs != index->rhs) continue;
+        if (frame->counter_fixed && loop_in_bounds(ast, frame->loop, array->rhs)) {
+            node->flags |= NODE_UNCHECKED;
+        }
+        return;
+    }
+}
+
+static void elide_expr(struct Ast *ast, NodeId id, const struct LoopFrame *loops) {
+    struct Node *node = AST_NODE(ast, id);
+    switch (node->kind) {
+        case NODE_CALL:
+        case NODE_ARRAY:
+        case NODE_CONSTRUCT:
+            for (NodeId arg = node->lhs; arg; arg = AST_NODE(ast, arg)->next) {
+                elide_expr(ast, arg, loops);
+            }
+            break;
+        case NODE_UNARY:
+        case NODE_CAST:
+        case NODE_LEN:
+        case NODE_ARRAY_NEW:
+        case NODE_MEMBER:
+            elide_expr(ast, node->lhs, loops);
+            break;
+        case NODE_BINARY:
+            elide_expr(ast, node->lhs, loops);
+            elide_expr(ast, node->rhs, loops);
+            break;
+        case NODE_SLICE:
+            elide_expr(ast, node->lhs, loops);
+            elide_expr(ast, node->rhs, loops);
+            if (node->alt) elide_expr(ast, node->alt, loops);
+            break;
+        case NODE_INDEX:
+            elide_expr(ast, node->lhs, loops);
+            elide_expr(ast, node->rhs, loops);
+            if (loops) check_index(ast, id, loops);
+            break;
+    }
+}
+
+static void elide_statements(struct Ast *ast, NodeId first, const struct LoopFrame *loops) {
+    for (NodeId stmt = first; stmt; stmt = AST_NODE(ast, stmt)->next) {
+        struct Node *node = AST_NODE(ast, stmt);
+        switch (node->kind) {
+            case NODE_CALL:
+                elide_expr(ast, stmt, loops);
+                break;
+            case NODE_VARIABLE:
+            case NODE_RETURN:
+                if (node->lhs) elide_expr(ast, node->lhs, loops);
+                break;
+            case NODE_ASSIGN:
+                elide_expr(ast, node->lhs, loops);
+                elide_expr(ast, node->rhs, loops);
+                break;
+            case NODE_BLOCK:
+                elide_statements(ast, node->lhs, loops);
+                break;
+            case NODE_IF:
+            case NODE_WHILE:
+                elide_expr(ast, node->lhs, loops);
+                elide_statements(ast, node->rhs, loops);
+                if (node->kind == NODE_IF && node->alt) elide_statements(ast, node->alt, loops);
+                break;
+            case NODE_FOR: {
+                elide_expr(ast, AST_NODE(ast, node->lhs)->lhs, loops);
+                for (NodeId bound = node->alt; bound; bound = AST_NODE(ast, bound)->next) {
+                    elide_expr(ast, bound, loops);
+                }
+                struct LoopFrame frame = { stmt, !assigns(ast, node->rhs, node->lhs), loops };
+                elide_statements(ast, node->rhs, &frame);
+                break;
+            }
+        }
+    }
+}
+
+void elide_bounds_checks(struct Ast *ast) {
+    for (NodeId decl = ast->first; decl; decl = AST_NODE(ast, decl)->next) {
+        struct Node *node = AST_NODE(ast, decl);
+        if (node->kind == NODE_FUNCTION && !(node->flags & NODE_DEAD)) {
+            elide_statements(ast, node->lhs, NULL);
+        }
+    }
+}
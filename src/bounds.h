@@ -0,0 +1,14 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include "ast.h"
+
+// Flags NODE_UNCHECKED on every index the enclosing 'for' loops prove in
+// bounds: the index is a loop counter that starts at a non-negative
+// constant and stops at least one short of the array's length, and
+// neither the counter nor the array variable changes inside the loop.
+// Indexes into vecs and maps keep their checks. Needs the types, so runs
+// after infer_types.
+void elide_bounds_checks(struct Ast *ast);
+
+#endif // BOUNDS_H
@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "cache.h"
+
+// Bumped whenever the records below change, so old caches load empty.
+#define CACHE_FORMAT 3
+
+// Format, one record per line:
+//   gartcache <format> <version>
+//   link <key>
+//   module <src_hash> <emit_hash> <obj_key> <c_path>
+//   fn <type> <elem> <name>  functions of the module above, in order
+//   call <name>              names called by the function above
+
+void cache_load(struct Cache *cache, const char *path, const char *version) {
+    memset(cache, 0, sizeof(*cache));
+    FILE *f = fopen(path, "r");
+    if (!f) return;
+
+    char line[4096], expected[256];
+    snprintf(expected, sizeof(expected), "gartcache %d %s\n", CACHE_FORMAT, version);
+    if (!fgets(line, sizeof(line), f) || strcmp(line, expected) != 0) {
+        fclose(f);
+        return;
+    }
+
+    struct CacheEntry *entry = NULL;
+    while (fgets(line, sizeof(line), f)) {
+        uint64_t src_hash, emit_hash, obj_key;
+        int type, elem, offset = 0;
+        line[strcspn(line, "\n")] = '\0';
+        if (sscanf(line, "link %" SCNx64, &cache->link_key) == 1) {
+            continue;
+        }
+        if (sscanf(line, "module %" SCNx64 " %" SCNx64 " %" SCNx64 " %n",
+                   &src_hash, &emit_hash, &obj_key, &offset) == 3 && offset > 0) {
+            entry = cache_put(cache, line + offset, src_hash, emit_hash, obj_key, NULL);
+        } else if (entry && sscanf(line, "fn %d %d %n", &type, &elem, &offset) == 2 && offset > 0) {
+            summary_add_fn(&entry->summary, intern_cstr(line + offset), type, elem);
+        } else if (entry && entry->summary.fn_count && strncmp(line, "call ", 5) == 0) {
+            summary_add_call(&entry->summary, intern_cstr(line + 5));
+        }
+    }
+    fclose(f);
+}
+
+bool cache_save(const struct Cache *cache, const char *path, const char *version) {
+    char tmp_path[4096];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *f = fopen(tmp_path, "w");
+    if (!f) return false;
+
+    fprintf(f, "gartcache %d %s\n", CACHE_FORMAT, version);
+    fprintf(f, "link %016" PRIx64 "\n", cache->link_key);
+    for (int i = 0; i < cache->count; i++) {
+        const struct CacheEntry *entry = &cache->entries[i];
+        fprintf(f, "module %016" PRIx64 " %016" PRIx64 " %016" PRIx64 " %s\n",
+                entry->src_hash, entry->emit_hash, entry->obj_key, entry->c_path);
+        const struct Summary *summary = &entry->summary;
+        for (uint32_t i = 0; i < summary->fn_count; i++) {
+            fprintf(f, "fn %d %d %s\n", summary->fns[i].type, summary->fns[i].elem, sym_str(summary->fns[i].name));
+            for (uint32_t c = 0; c < summary->fns[i].call_count; c++) {
+                fprintf(f, "call %s\n", sym_str(summary->calls[summary->fns[i].first_call + c]));
+            }
+        }
+    }
+    if (fclose(f) != 0) return false;
+
+    // replace in one step so an interrupted build never leaves half a cache
+    remove(path);
+    return rename(tmp_path, path) == 0;
+}
+
+void cache_free(struct Cache *cache) {
+    for (int i = 0; i < cache->count; i++) {
+        free(cache->entries[i].c_path);
+        summary_free(&cache->entries[i].summary);
+    }
+    free(cache->entries);
+    memset(cache, 0, sizeof(*cache));
+}
+
+struct CacheEntry *cache_find(struct Cache *cache, const char *c_path) {
+    for (int i = 0; i < cache->count; i++) {
+        if (strcmp(cache->entries[i].c_path, c_path) == 0) {
+            return &cache->entries[i];
+        }
+    }
+    return NULL;
+}
+
+struct CacheEntry *cache_put(struct Cache *cache, const char *c_path, uint64_t src_hash, uint64_t emit_hash,
+                             uint64_t obj_key, const struct Summary *summary) {
+    struct CacheEntry *entry = cache_find(cache, c_path);
+    if (!entry) {
+        if (cache->count == cache->cap) {
+            cache->cap = cache->cap ? cache->cap * 2 : 64;
+            cache->entries = realloc(cache->entries, cache->cap * sizeof(struct CacheEntry));
+        }
+        entry = &cache->entries[cache->count++];
+        memset(entry, 0, sizeof(*entry));
+        entry->c_path = strdup(c_path);
+    }
+    entry->src_hash = src_hash;
+    entry->emit_hash = emit_hash;
+    entry->obj_key = obj_key;
+
+    summary_free(&entry->summary);
+    if (summary) summary_copy(&entry->summary, summary);
+    return entry;
+}
@@ -0,0 +1,36 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "dce.h"
+
+// Persistent record of what the previous build produced, so modules whose
+// inputs did not change skip parsing, emission and C compilation.
+struct CacheEntry {
+    char    *c_path;
+    uint64_t src_hash;  // source the .c/.h were generated from
+    uint64_t emit_hash; // what else the .c was generated from: live set, callee types
+    uint64_t obj_key;   // everything the .o was compiled from
+    struct Summary summary;
+};
+
+struct Cache {
+    struct CacheEntry *entries;
+    int                count;
+    int                cap;
+    uint64_t           link_key;
+};
+
+// A missing, unreadable or stale-version cache simply loads empty.
+void cache_load(struct Cache *cache, const char *path, const char *version);
+bool cache_save(const struct Cache *cache, const char *path, const char *version);
+void cache_free(struct Cache *cache);
+
+struct CacheEntry *cache_find(struct Cache *cache, const char *c_path);
+// Records a module; `summary` (may be NULL) is copied.
+struct CacheEntry *cache_put(struct Cache *cache, const char *c_path, uint64_t src_hash, uint64_t emit_hash,
+                             uint64_t obj_key, const struct Summary *summary);
+
+#endif // CACHE_H
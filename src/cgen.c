@@ -0,0 +1,2014 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "cgen.h"
+#include "format.h"
+#include "hash.h"
+
+static void emit_escaped_text(struct OutBuf *out, const char *input, size_t len) {
+    const char *end = input + len;
+    for (const char *src = input; src != end; src++) {
+        switch (*src) {
+            case '\n': ob_lit(out, "\\n"); break;
+            case '\t': ob_lit(out, "\\t"); break;
+            case '\r': ob_lit(out, "\\r"); break;
+            case '\\': ob_lit(out, "\\\\"); break;
+            case '\"': ob_lit(out, "\\\""); break;
+            case '\'': ob_lit(out, "\\\'"); break;
+            case '\0': ob_lit(out, "\\000"); break;
+            default:
+                ob_putc(out, *src);
+        }
+    }
+}
+
+static void emit_escaped(struct OutBuf *out, Sym str) {
+    emit_escaped_text(out, sym_str(str), sym_len(str));
+}
+
+static void emit_name(struct OutBuf *out, Sym name) {
+    ob_write(out, sym_str(name), sym_len(name));
+}
+
+static void emit_value(struct Ast *ast, NodeId id, struct OutBuf *out);
+static void emit_array(struct Ast *ast, NodeId id, struct OutBuf *out, bool initializer, bool any_size);
+
+static const char *c_types[] = {
+    [TYPE_INT]     = "int",
+    [TYPE_INT64]   = "int64_t",
+    [TYPE_FLOAT]   = "float",
+    [TYPE_DOUBLE]  = "double",
+    [TYPE_BOOL]    = "bool",
+    [TYPE_STR]     = "gart_str",
+    [TYPE_POINTER] = "void *",
+};
+
+// Slices are structs defined per element type by the program header.
+static const char *slice_types[] = {
+    [TYPE_NONE]    = "gart_slice_int",
+    [TYPE_INT]     = "gart_slice_int",
+    [TYPE_INT64]   = "gart_slice_int64",
+    [TYPE_FLOAT]   = "gart_slice_float",
+    [TYPE_DOUBLE]  = "gart_slice_double",
+    [TYPE_BOOL]    = "gart_slice_bool",
+    [TYPE_STR]     = "gart_slice_str",
+    [TYPE_POINTER] = "gart_slice_pointer",
+};
+
+// Vecs and maps are defined per element, or key and value, type by the
+// GART_VEC and GART_MAP of the module header, and passed by pointer:
+// 'gart_vec_<elem>', 'gart_map_<key>_<value>'.
+static const char *type_tags[] = {
+    [TYPE_INT]    = "int",    [TYPE_INT64] = "int64", [TYPE_FLOAT]   = "float", [TYPE_DOUBLE] = "double",
+    [TYPE_BOOL]   = "bool",   [TYPE_STR]   = "str",   [TYPE_POINTER] = "pointer",
+};
+
+static const int elem_sizes[] = {
+    [TYPE_INT] = 4, [TYPE_INT64] = 8, [TYPE_FLOAT] = 4, [TYPE_DOUBLE] = 8,
+    [TYPE_BOOL] = 1, [TYPE_STR] = 16, [TYPE_POINTER] = 8, [TYPE_SLICE] = 16,
+    [TYPE_VEC] = 8, [TYPE_MAP] = 8,
+};
+
+// Fixed arrays up to this size live on the stack, bigger ones on the heap.
+#define STACK_ARRAY_LIMIT (64 * 1024)
+
+static struct Node *record_decl(struct Ast *ast, int record) {
+    return AST_NODE(ast, ast->records[record]);
+}
+
+static bool is_soa(struct Ast *ast, int elem, int record) {
+    return elem == TYPE_STRUCT && (record_decl(ast, record)->flags & NODE_SOA);
+}
+
+static void type_layout(struct Ast *ast, int type, int record, int *size, int *align);
+
+// Alignment of a field in the C struct: its type's, or more if asked for.
+static int field_align(struct Ast *ast, NodeId field, bool natural) {
+    struct Node *node = AST_NODE(ast, field);
+    int size, align;
+    type_layout(ast, node->type, node->record, &size, &align);
+    return !natural && (int)node->rhs > align ? (int)node->rhs : align;
+}
+
+// The fields of a struct in the order they are laid out: by decreasing
+// alignment, which leaves no padding between fields of natural alignment,
+// declaration order breaking ties. `natural` ignores 'align(N)', as for
+// the arrays of a soa struct. Returns a malloc'd array of `*count`.
+static NodeId *layout_fields(struct Ast *ast, int record, bool natural, int *count) {
+    *count = 0;
+    for (NodeId f = record_decl(ast, record)->lhs; f; f = AST_NODE(ast, f)->next) (*count)++;
+    NodeId *order = malloc(*count * sizeof(NodeId));
+    if (!order) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    int n = 0;
+    for (NodeId f = record_decl(ast, record)->lhs; f; f = AST_NODE(ast, f)->next) {
+        int align = field_align(ast, f, natural);
+        int at = n++;
+        while (at > 0 && field_align(ast, order[at - 1], natural) < align) {
+            order[at] = order[at - 1];
+            at--;
+        }
+        order[at] = f;
+    }
+    return order;
+}
+
+// Size and alignment the C compiler gives a value of `type`.
+static void type_layout(struct Ast *ast, int type, int record, int *size, int *align) {
+    if (type != TYPE_STRUCT) {
+        *size = elem_sizes[type];
+        *align = type == TYPE_SLICE || type == TYPE_STR ? 8 : elem_sizes[type];
+        return;
+    }
+    struct Node *decl = record_decl(ast, record);
+    int count, offset = 0;
+    *align = decl->rhs ? (int)decl->rhs : 1;
+    NodeId *order = layout_fields(ast, record, false, &count);
+    for (int i = 0; i < count; i++) {
+        int field_size, natural;
+        type_layout(ast, AST_NODE(ast, order[i])->type, AST_NODE(ast, order[i])->record, &field_size, &natural);
+        int a = field_align(ast, order[i], false);
+        offset = (offset + a - 1) / a * a + field_size;
+        if (a > *align) *align = a;
+    }
+    free(order);
+    *size = (offset + *align - 1) / *align * *align;
+}
+
+// Slices are structs defined per element type: by the program header for
+// the scalars, next to the struct for a struct, and field by field for a
+// soa struct.
+static void emit_slice_type(struct Ast *ast, struct OutBuf *out, int elem, int record) {
+    if (elem != TYPE_STRUCT) {
+        ob_puts(out, slice_types[elem]);
+        return;
+    }
+    ob_puts(out, is_soa(ast, elem, record) ? "gart_soa_" : "gart_slice_");
+    emit_name(out, record_decl(ast, record)->name);
+}
+
+static void emit_type_tag(struct Ast *ast, struct OutBuf *out, int type, int record) {
+    if (type == TYPE_STRUCT) {
+        emit_name(out, record_decl(ast, record)->name);
+    } else {
+        ob_puts(out, type_tags[type]);
+    }
+}
+
+static void emit_container_name(struct Ast *ast, struct OutBuf *out, int type, int elem, int record) {
+    if (type == TYPE_VEC) {
+        ob_lit(out, "gart_vec_");
+        emit_type_tag(ast, out, elem, record);
+        return;
+    }
+    ob_lit(out, "gart_map_");
+    emit_type_tag(ast, out, MAP_KEY(elem), 0);
+    ob_putc(out, '_');
+    emit_type_tag(ast, out, MAP_VALUE(elem), record);
+}
+
+static bool is_container(int type) {
+    return type == TYPE_VEC || type == TYPE_MAP;
+}
+
+// Whether the C type of `type` ends in a '*', which a name follows without a space.
+static bool is_pointer(int type) {
+    return type == TYPE_POINTER || is_container(type);
+}
+
+static void emit_type(struct Ast *ast, struct OutBuf *out, int type, int elem, int record) {
+    if (type == TYPE_SLICE) {
+        emit_slice_type(ast, out, elem, record);
+    } else if (is_container(type)) {
+        emit_container_name(ast, out, type, elem, record);
+        ob_lit(out, " *");
+    } else if (type == TYPE_STRUCT) {
+        emit_name(out, record_decl(ast, record)->name);
+    } else {
+        ob_puts(out, c_types[type]);
+    }
+}
+
+// "type name", without a space after a '*'.
+static void emit_declarator(struct Ast *ast, struct OutBuf *out, int type, int elem, int record, Sym name) {
+    emit_type(ast, out, type, elem, record);
+    if (!is_pointer(type)) ob_putc(out, ' ');
+    emit_name(out, name);
+}
+
+// A zero value of `type` that C's warnings accept: '{.field = 0}' naming
+// the first field of a struct, bracketed as deep as structs nest.
+static void emit_zero(struct Ast *ast, struct OutBuf *out, int type, int record) {
+    if (type == TYPE_SLICE || type == TYPE_STR) {
+        ob_lit(out, "{0}");
+    } else if (type == TYPE_STRUCT) {
+        int count;
+        NodeId *order = layout_fields(ast, record, false, &count);
+        ob_lit(out, "{.");
+        emit_name(out, AST_NODE(ast, order[0])->name);
+        ob_lit(out, " = ");
+        emit_zero(ast, out, AST_NODE(ast, order[0])->type, AST_NODE(ast, order[0])->record);
+        ob_putc(out, '}');
+        free(order);
+    } else {
+        ob_putc(out, '0');
+    }
+}
+
+// A zero of `type` as an expression, a compound literal unless it's a scalar.
+static void emit_zero_value(struct Ast *ast, struct OutBuf *out, int type, int elem, int record) {
+    if (type == TYPE_SLICE || type == TYPE_STR || type == TYPE_STRUCT) {
+        ob_putc(out, '(');
+        emit_type(ast, out, type, elem, record);
+        ob_putc(out, ')');
+    }
+    emit_zero(ast, out, type, record);
+}
+
+static const char *op_text[] = {
+    [OP_NEG] = "-", [OP_NOT] = "!", [OP_BITNOT] = "~",
+    [OP_MUL] = " * ", [OP_DIV] = " / ", [OP_MOD] = " % ",
+    [OP_ADD] = " + ", [OP_SUB] = " - ",
+    [OP_SHL] = " << ", [OP_SHR] = " >> ",
+    [OP_LT] = " < ", [OP_LE] = " <= ", [OP_GT] = " > ", [OP_GE] = " >= ",
+    [OP_EQ] = " == ", [OP_NE] = " != ",
+    [OP_BITAND] = " & ", [OP_BITXOR] = " ^ ", [OP_BITOR] = " | ",
+    [OP_AND] = " && ", [OP_OR] = " || ",
+};
+
+static const char *builtin_suffixes[] = {
+    [BUILTIN_PUSH] = "_push(", [BUILTIN_POP] = "_pop(", [BUILTIN_HAS] = "_has(",
+    [BUILTIN_DEL] = "_del(", [BUILTIN_KEYS] = "_keys(", [BUILTIN_VALUES] = "_values(",
+};
+
+// A builtin on a vec or map calls its function of the container's type.
+static void emit_call(struct Ast *ast, NodeId id, struct OutBuf *out) {
+    struct Node *call = AST_NODE(ast, id);
+    if (call->op) {
+        struct Node *container = AST_NODE(ast, call->lhs);
+        emit_container_name(ast, out, container->type, container->elem, container->record);
+        ob_puts(out, builtin_suffixes[call->op]);
+    } else {
+        emit_name(out, call->name);
+        ob_putc(out, '(');
+    }
+    for (NodeId arg = call->lhs; arg; arg = AST_NODE(ast, arg)->next) {
+        if (arg != call->lhs) {
+            ob_lit(out, ", ");
+        }
+        emit_value(ast, arg, out);
+    }
+    ob_putc(out, ')');
+}
+
+// The pointer a slice decays to: its elements, or for a soa array the
+// first field's, which start the block holding all of them.
+static void emit_decay(struct Ast *ast, NodeId slice, struct OutBuf *out) {
+    struct Node *node = AST_NODE(ast, slice);
+    if (!is_soa(ast, node->elem, node->record)) {
+        ob_lit(out, ".ptr");
+        return;
+    }
+    int count;
+    NodeId *order = layout_fields(ast, node->record, true, &count);
+    ob_putc(out, '.');
+    emit_name(out, AST_NODE(ast, order[0])->name);
+    free(order);
+}
+
+// Whether evaluating `id` twice is the same as once: nothing in it calls
+// or allocates.
+static bool repeatable(struct Ast *ast, NodeId id) {
+    struct Node *node = AST_NODE(ast, id);
+    switch (node->kind) {
+        case NODE_CALL:
+        case NODE_ARRAY:
+        case NODE_ARRAY_NEW:
+        case NODE_CONSTRUCT:
+            return false;
+        case NODE_MEMBER:
+        case NODE_LEN:
+        case NODE_UNARY:
+        case NODE_CAST:
+            return repeatable(ast, node->lhs);
+        case NODE_INDEX:
+        case NODE_BINARY:
+            return repeatable(ast, node->lhs) && repeatable(ast, node->rhs);
+    }
+    return true;
+}
+
+// 'a[i].x' on a soa array reads the field's own array, 'a.x[i]', which is
+// what keeps loops over one field contiguous.
+static void emit_member(struct Ast *ast, NodeId id, struct OutBuf *out) {
+    struct Node *node = AST_NODE(ast, id);
+    struct Node *element = AST_NODE(ast, node->lhs);
+    struct Node *array = element->kind == NODE_INDEX ? AST_NODE(ast, element->lhs) : NULL;
+    if (!array || !is_soa(ast, array->elem, array->record) || !repeatable(ast, element->lhs)) {
+        emit_value(ast, node->lhs, out);
+        ob_putc(out, '.');
+        emit_name(out, node->name);
+        return;
+    }
+    emit_value(ast, element->lhs, out);
+    // 'a__x', the field's restrict pointer when hoisted out of a 'simd for'
+    ob_puts(out, element->flags & NODE_RESTRICT ? "__" : ".");
+    emit_name(out, node->name);
+    ob_putc(out, '[');
+    if (element->flags & NODE_UNCHECKED) {
+        emit_value(ast, element->rhs, out);
+    } else {
+        ob_lit(out, "gart_index(");
+        emit_value(ast, element->rhs, out);
+        ob_lit(out, ", ");
+        emit_value(ast, element->lhs, out);
+        ob_lit(out, ".len)");
+    }
+    ob_putc(out, ']');
+}
+
+// 'gart_lit_<hash of the text>', the same in every module.
+static void emit_literal_name(struct OutBuf *out, const char *prefix, Sym str) {
+    static const char digits[] = "0123456789abcdef";
+    uint64_t hash = hash_bytes(sym_str(str), sym_len(str), 0);
+    ob_puts(out, prefix);
+    for (int shift = 60; shift >= 0; shift -= 4) ob_putc(out, digits[hash >> shift & 15]);
+}
+
+// A string literal as a gart string pointing at its shared array, which
+// cgen_literals defines ahead of the code; an initializer leaves out the type.
+static void emit_literal(struct Ast *ast, NodeId id, struct OutBuf *out, bool initializer) {
+    struct Node *node = AST_NODE(ast, id);
+    if (sym_len(node->str) == 0) {
+        ob_puts(out, initializer ? "{0}" : "((gart_str){0})");
+        return;
+    }
+    node->flags |= NODE_LITERAL;
+    ob_puts(out, initializer ? "GART_STR_INIT(" : "GART_STR(");
+    emit_literal_name(out, "gart_lit_", node->str);
+    ob_lit(out, ", ");
+    ob_int(out, sym_len(node->str));
+    ob_putc(out, ')');
+}
+
+// '((T){.field = value, ...})', naming the fields so the layout can put
+// them in any order; an initializer leaves out the type.
+static void emit_construct(struct Ast *ast, NodeId id, struct OutBuf *out, bool initializer) {
+    struct Node *node = AST_NODE(ast, id);
+    if (!initializer) {
+        ob_lit(out, "((");
+        emit_name(out, record_decl(ast, node->record)->name);
+        ob_putc(out, ')');
+    }
+    if (!node->lhs) {
+        emit_zero(ast, out, TYPE_STRUCT, node->record);
+        if (!initializer) ob_putc(out, ')');
+        return;
+    }
+    ob_putc(out, '{');
+    NodeId field = record_decl(ast, node->record)->lhs;
+    for (NodeId value = node->lhs; value; value = AST_NODE(ast, value)->next) {
+        if (value != node->lhs) ob_lit(out, ", ");
+        ob_putc(out, '.');
+        emit_name(out, AST_NODE(ast, field)->name);
+        ob_lit(out, " = ");
+        if (AST_NODE(ast, value)->kind == NODE_CONSTRUCT) {
+            emit_construct(ast, value, out, initializer);
+        } else if (AST_NODE(ast, value)->kind == NODE_STRING) {
+            emit_literal(ast, value, out, initializer);
+        } else {
+            emit_value(ast, value, out);
+        }
+        field = AST_NODE(ast, field)->next;
+    }
+    ob_putc(out, '}');
+    if (!initializer) ob_putc(out, ')');
+}
+
+// A string for C: a literal as one, anything else through gart_str_cstr,
+// which wants it in memory.
+static void emit_cstr(struct Ast *ast, NodeId id, struct OutBuf *out) {
+    struct Node *node = AST_NODE(ast, id);
+    if (node->kind == NODE_STRING) {
+        ob_putc(out, '"');
+        emit_escaped(out, node->str);
+        ob_putc(out, '"');
+    } else if (node->kind == NODE_IDENT) {
+        ob_lit(out, "gart_str_cstr(&");
+        emit_name(out, node->name);
+        ob_putc(out, ')');
+    } else {
+        ob_lit(out, "gart_str_cstr((gart_str[]){");
+        emit_value(ast, id, out);
+        ob_lit(out, "})");
+    }
+}
+
+// The operands of a chain of '+' on strings, left to right, at most `max`:
+// 'a + b + c' is '(a + b) + c', so the chain runs down the left.
+static int string_parts(struct Ast *ast, NodeId id, NodeId *parts, int max) {
+    int count = 0;
+    while (count < max - 1 && AST_NODE(ast, id)->kind == NODE_BINARY && AST_NODE(ast, id)->op == OP_ADD
+           && AST_NODE(ast, id)->type == TYPE_STR) {
+        parts[count++] = AST_NODE(ast, id)->rhs;
+        id = AST_NODE(ast, id)->lhs;
+    }
+    parts[count++] = id;
+    for (int i = 0; i < count / 2; i++) {
+        NodeId swap = parts[i];
+        parts[i] = parts[count - 1 - i];
+        parts[count - 1 - i] = swap;
+    }
+    return count;
+}
+
+// '+' joins strings, 'a + b + c' with one allocation; the comparisons
+// compare bytes, or with null test for C's NULL.
+static void emit_string_binary(struct Ast *ast, NodeId id, struct OutBuf *out) {
+    struct Node *node = AST_NODE(ast, id);
+    NodeId lhs = node->lhs, rhs = node->rhs;
+    int op = node->op;
+    if (op == OP_ADD) {
+        NodeId parts[16];
+        int count = string_parts(ast, id, parts, 16);
+        ob_puts(out, count == 2 ? "gart_str_cat(" : "gart_str_join((gart_str[]){");
+        for (int i = 0; i < count; i++) {
+            if (i) ob_lit(out, ", ");
+            emit_value(ast, parts[i], out);
+        }
+        if (count == 2) {
+            ob_putc(out, ')');
+        } else {
+            ob_lit(out, "}, ");
+            ob_int(out, count);
+            ob_putc(out, ')');
+        }
+        return;
+    }
+    if (AST_NODE(ast, lhs)->type != AST_NODE(ast, rhs)->type) {
+        ob_puts(out, op == OP_EQ ? "(gart_str_is_null(" : "(!gart_str_is_null(");
+        emit_value(ast, AST_NODE(ast, lhs)->type == TYPE_STR ? lhs : rhs, out);
+        ob_lit(out, "))");
+    } else if (op == OP_EQ || op == OP_NE) {
+        ob_puts(out, op == OP_EQ ? "(gart_str_eq(" : "(!gart_str_eq(");
+        emit_value(ast, lhs, out);
+        ob_lit(out, ", ");
+        emit_value(ast, rhs, out);
+        ob_lit(out, "))");
+    } else {
+        ob_lit(out, "(gart_str_cmp(");
+        emit_value(ast, lhs, out);
+        ob_lit(out, ", ");
+        emit_value(ast, rhs, out);
+        ob_putc(out, ')');
+        ob_puts(out, op_text[op]);
+        ob_lit(out, "0)");
+    }
+}
+
+static void emit_value(struct Ast *ast, NodeId id, struct OutBuf *out) {
+    struct Node *node = AST_NODE(ast, id);
+    switch (node->kind) {
+        case NODE_INT:
+            ob_int(out, node->int_value);
+            break;
+        case NODE_FLOAT:
+            ob_double(out, node->float_value);
+            break;
+        case NODE_STRING:
+            emit_literal(ast, id, out, false);
+            break;
+        case NODE_BOOL:
+            ob_putc(out, node->int_value ? '1' : '0');
+            break;
+        case NODE_NULL:
+            ob_lit(out, "NULL");
+            break;
+        case NODE_IDENT:
+            emit_name(out, node->name);
+            break;
+        case NODE_FUNC_REF:
+            // a pointer, like any other C function pointer gets
+            ob_lit(out, "(void *)");
+            emit_name(out, node->name);
+            break;
+        case NODE_CALL:
+            emit_call(ast, id, out);
+            break;
+        // fully parenthesized, so C's precedence never has a say
+        case NODE_UNARY:
+            ob_putc(out, '(');
+            ob_puts(out, op_text[node->op]);
+            emit_value(ast, node->lhs, out);
+            ob_putc(out, ')');
+            break;
+        case NODE_BINARY:
+            if (AST_NODE(ast, node->lhs)->type == TYPE_STR || AST_NODE(ast, node->rhs)->type == TYPE_STR) {
+                emit_string_binary(ast, id, out);
+                break;
+            }
+            ob_putc(out, '(');
+            emit_value(ast, node->lhs, out);
+            ob_puts(out, op_text[node->op]);
+            emit_value(ast, node->rhs, out);
+            ob_putc(out, ')');
+            break;
+        case NODE_CAST:
+            if (AST_NODE(ast, node->lhs)->type == TYPE_STR) {
+                // a string handed to C is NUL-terminated, one kept stays as it is
+                if (node->type == TYPE_STR) {
+                    emit_value(ast, node->lhs, out);
+                } else {
+                    emit_cstr(ast, node->lhs, out);
+                }
+                break;
+            }
+            if (node->type == TYPE_STR) {
+                ob_lit(out, "gart_str_of_c(");
+                emit_value(ast, node->lhs, out);
+                ob_putc(out, ')');
+                break;
+            }
+            ob_lit(out, "((");
+            ob_puts(out, c_types[node->type]);
+            ob_putc(out, ')');
+            emit_value(ast, node->lhs, out);
+            // a slice handed to C decays to its elements
+            if (AST_NODE(ast, node->lhs)->type == TYPE_SLICE) emit_decay(ast, node->lhs, out);
+            ob_putc(out, ')');
+            break;
+        case NODE_INDEX: {
+            struct Node *array = AST_NODE(ast, node->lhs);
+            if (is_container(array->type)) {
+                // a vec's element in place; a map's value, zero for a missing key
+                bool vec = array->type == TYPE_VEC;
+                if (vec) ob_lit(out, "(*");
+                emit_container_name(ast, out, array->type, array->elem, array->record);
+                ob_puts(out, vec ? "_at(" : "_get(");
+                emit_value(ast, node->lhs, out);
+                ob_lit(out, ", ");
+                emit_value(ast, node->rhs, out);
+                ob_puts(out, vec ? "))" : ")");
+            } else if (array->type == TYPE_STR) {
+                ob_puts(out, node->flags & NODE_UNCHECKED ? "gart_str_byte(" : "gart_str_at(");
+                emit_value(ast, node->lhs, out);
+                ob_lit(out, ", ");
+                emit_value(ast, node->rhs, out);
+                ob_putc(out, ')');
+            } else if (is_soa(ast, array->elem, array->record)) {
+                // a whole element of a soa array is gathered from its fields
+                emit_slice_type(ast, out, array->elem, array->record);
+                ob_lit(out, "_get(");
+                emit_value(ast, node->lhs, out);
+                ob_lit(out, ", ");
+                emit_value(ast, node->rhs, out);
+                ob_putc(out, ')');
+            } else if (node->flags & NODE_UNCHECKED) {
+                emit_value(ast, node->lhs, out);
+                ob_puts(out, node->flags & NODE_RESTRICT ? "__ptr[" : ".ptr[");
+                emit_value(ast, node->rhs, out);
+                ob_putc(out, ']');
+            } else {
+                ob_lit(out, "(*");
+                emit_slice_type(ast, out, array->elem, array->record);
+                ob_lit(out, "_at(");
+                emit_value(ast, node->lhs, out);
+                ob_lit(out, ", ");
+                emit_value(ast, node->rhs, out);
+                ob_lit(out, "))");
+            }
+            break;
+        }
+        case NODE_SLICE:
+            if (node->type == TYPE_STR) {
+                ob_lit(out, "gart_str");
+            } else {
+                emit_slice_type(ast, out, node->elem, node->record);
+            }
+            ob_puts(out, node->alt ? "_sub(" : "_from(");
+            if (AST_NODE(ast, node->lhs)->type == TYPE_VEC) {
+                struct Node *vec = AST_NODE(ast, node->lhs);
+                emit_container_name(ast, out, TYPE_VEC, vec->elem, vec->record);
+                ob_lit(out, "_view(");
+                emit_value(ast, node->lhs, out);
+                ob_putc(out, ')');
+            } else {
+                emit_value(ast, node->lhs, out);
+            }
+            ob_lit(out, ", ");
+            emit_value(ast, AST_NODE(ast, id)->rhs, out);
+            if (node->alt) {
+                ob_lit(out, ", ");
+                emit_value(ast, node->alt, out);
+            }
+            ob_putc(out, ')');
+            break;
+        case NODE_MEMBER:
+            emit_member(ast, id, out);
+            break;
+        case NODE_CONSTRUCT:
+            emit_construct(ast, id, out, false);
+            break;
+        case NODE_LEN:
+            if (AST_NODE(ast, node->lhs)->type == TYPE_STR) {
+                ob_lit(out, "gart_str_len(");
+                emit_value(ast, node->lhs, out);
+                ob_putc(out, ')');
+                break;
+            }
+            emit_value(ast, node->lhs, out);
+            ob_puts(out, is_container(AST_NODE(ast, node->lhs)->type) ? "->len" : ".len");
+            break;
+        case NODE_ARRAY:
+        case NODE_ARRAY_NEW:
+            emit_array(ast, id, out, false, false);
+            break;
+    }
+}
+
+// The reserve and the growth factor or maximum load of a new vec or map.
+static void emit_container_args(struct Ast *ast, NodeId id, struct OutBuf *out) {
+    struct Node *node = AST_NODE(ast, id);
+    double policy = node->float_value ? node->float_value : node->type == TYPE_VEC ? 2.0 : 0.875;
+    emit_value(ast, node->lhs, out);
+    ob_lit(out, ", ");
+    ob_double(out, policy);
+}
+
+// Length of an array whose storage can be a compound literal: a literal
+// one, or a zero-filled one of constant length, which on the stack
+// (`any_size` false) must be small. 0 when it can't.
+static long fixed_length(struct Ast *ast, NodeId id, bool any_size) {
+    struct Node *array = AST_NODE(ast, id);
+    long len;
+    int size, align;
+    if (!ast_array_length(ast, id, &len) || len <= 0) return 0;
+    type_layout(ast, array->elem, array->record, &size, &align);
+    if (array->kind == NODE_ARRAY_NEW && !any_size && len > STACK_ARRAY_LIMIT / size) return 0;
+    return len;
+}
+
+bool cgen_allocates(struct Ast *ast, NodeId id) {
+    return fixed_length(ast, id, false) == 0;
+}
+
+// '(T[]){elements}' for an array literal.
+static void emit_elements(struct Ast *ast, NodeId id, struct OutBuf *out) {
+    struct Node *array = AST_NODE(ast, id);
+    ob_putc(out, '(');
+    emit_type(ast, out, array->elem, TYPE_NONE, array->record);
+    ob_lit(out, "[]){");
+    for (NodeId element = array->lhs; element; element = AST_NODE(ast, element)->next) {
+        if (element != array->lhs) ob_lit(out, ", ");
+        if (AST_NODE(ast, element)->kind == NODE_CONSTRUCT) {
+            emit_construct(ast, element, out, true);
+        } else {
+            emit_value(ast, element, out);
+        }
+    }
+    ob_putc(out, '}');
+}
+
+// '{(T[]){elements}, n}', or '{(T[n]){0}, n}' for '[n]T'. A soa array
+// has one '(T[n]){0}' per field.
+static void emit_fixed_array(struct Ast *ast, NodeId id, long len, struct OutBuf *out) {
+    struct Node *array = AST_NODE(ast, id);
+    ob_putc(out, '{');
+    if (is_soa(ast, array->elem, array->record)) {
+        for (NodeId f = record_decl(ast, array->record)->lhs; f; f = AST_NODE(ast, f)->next) {
+            struct Node *field = AST_NODE(ast, f);
+            ob_putc(out, '.');
+            emit_name(out, field->name);
+            ob_lit(out, " = (");
+            emit_type(ast, out, field->type, field->elem, field->record);
+            ob_putc(out, '[');
+            ob_int(out, len);
+            ob_lit(out, "]){");
+            emit_zero(ast, out, field->type, field->record);
+            ob_lit(out, "}, ");
+        }
+        ob_lit(out, ".len = ");
+    } else if (array->kind == NODE_ARRAY) {
+        emit_elements(ast, id, out);
+        ob_lit(out, ", ");
+    } else {
+        ob_lit(out, "(");
+        emit_type(ast, out, array->elem, TYPE_NONE, array->record);
+        ob_putc(out, '[');
+        ob_int(out, len);
+        ob_lit(out, "]){");
+        emit_zero(ast, out, array->elem, array->record);
+        ob_lit(out, "}, ");
+    }
+    ob_int(out, len);
+    ob_putc(out, '}');
+}
+
+// An array literal or '[n]T' as a slice value. Arrays too big for the
+// stack or sized at run time are allocated from an arena: the function's
+// when plan_regions found the array doesn't outlive it, else gart_heap.
+static void emit_array(struct Ast *ast, NodeId id, struct OutBuf *out, bool initializer, bool any_size) {
+    struct Node *array = AST_NODE(ast, id);
+    if (is_container(array->type)) {
+        emit_container_name(ast, out, array->type, array->elem, array->record);
+        ob_puts(out, array->flags & NODE_REGION ? "_new(&gart_region, " : "_new(&gart_heap, ");
+        emit_container_args(ast, id, out);
+        ob_putc(out, ')');
+        return;
+    }
+    long len = fixed_length(ast, id, any_size);
+    if (!len) {
+        emit_slice_type(ast, out, array->elem, array->record);
+        ob_puts(out, array->flags & NODE_REGION ? "_alloc(&gart_region, " : "_alloc(&gart_heap, ");
+        emit_value(ast, array->lhs, out);
+        ob_putc(out, ')');
+        return;
+    }
+    if (!initializer) {
+        ob_lit(out, "((");
+        emit_slice_type(ast, out, array->elem, array->record);
+        ob_putc(out, ')');
+    }
+    emit_fixed_array(ast, id, len, out);
+    if (!initializer) ob_putc(out, ')');
+}
+
+// `static_storage`: the variable outlives the function, so fixed arrays
+// of any size have their storage in the program image.
+static void emit_initializer(struct Ast *ast, NodeId id, struct OutBuf *out, bool static_storage) {
+    struct Node *init = AST_NODE(ast, id);
+    if (init->kind == NODE_BOOL) {
+        if (init->int_value) ob_lit(out, "true");
+        else ob_lit(out, "false");
+    } else if (init->kind == NODE_ARRAY || init->kind == NODE_ARRAY_NEW) {
+        emit_array(ast, id, out, true, static_storage);
+    } else if (init->kind == NODE_CONSTRUCT) {
+        emit_construct(ast, id, out, true);
+    } else if (init->kind == NODE_STRING) {
+        emit_literal(ast, id, out, static_storage);
+    } else {
+        emit_value(ast, id, out);
+    }
+}
+
+// Module-level variables (gvar or svar) are private to their module. A
+// new vec or map there is static storage of its own, empty until the
+// first push or insert allocates.
+static void emit_global(struct Ast *ast, NodeId id, struct OutBuf *out) {
+    struct Node *var = AST_NODE(ast, id);
+    if (!var->lhs) return;
+    struct Node *init = AST_NODE(ast, var->lhs);
+    if (init->kind == NODE_ARRAY_NEW && is_container(init->type)) {
+        ob_lit(out, "static ");
+        emit_container_name(ast, out, init->type, init->elem, init->record);
+        ob_putc(out, ' ');
+        emit_name(out, var->name);
+        ob_puts(out, init->type == TYPE_VEC ? "__data = GART_VEC_INIT(" : "__data = GART_MAP_INIT(");
+        emit_container_args(ast, var->lhs, out);
+        ob_lit(out, ");\nstatic ");
+        emit_declarator(ast, out, var->type, var->elem, var->record, var->name);
+        ob_lit(out, " = &");
+        emit_name(out, var->name);
+        ob_lit(out, "__data;\n");
+        return;
+    }
+    ob_lit(out, "static ");
+    emit_declarator(ast, out, var->type, var->elem, var->record, var->name);
+    ob_lit(out, " = ");
+    emit_initializer(ast, var->lhs, out, true);
+    ob_lit(out, ";\n");
+}
+
+static void emit_indent(struct OutBuf *out, int depth) {
+    for (int i = 0; i < depth; i++) ob_lit(out, "    ");
+}
+
+// 'static T name__field[n];' for each field of a soa array.
+static void emit_soa_storage(struct Ast *ast, NodeId id, long len, struct OutBuf *out, int depth) {
+    struct Node *var = AST_NODE(ast, id);
+    struct Node *init = AST_NODE(ast, var->lhs);
+    for (NodeId f = record_decl(ast, init->record)->lhs; f; f = AST_NODE(ast, f)->next) {
+        struct Node *field = AST_NODE(ast, f);
+        ob_lit(out, "static ");
+        emit_declarator(ast, out, field->type, field->elem, field->record, var->name);
+        ob_lit(out, "__");
+        emit_name(out, field->name);
+        ob_putc(out, '[');
+        ob_int(out, len);
+        ob_lit(out, "];\n");
+        emit_indent(out, depth);
+    }
+}
+
+// '{.field = memset(name__field, 0, sizeof(name__field)), ..., .len = n}'
+static void emit_soa_refill(struct Ast *ast, NodeId id, long len, struct OutBuf *out) {
+    struct Node *var = AST_NODE(ast, id);
+    struct Node *init = AST_NODE(ast, var->lhs);
+    ob_putc(out, '{');
+    for (NodeId f = record_decl(ast, init->record)->lhs; f; f = AST_NODE(ast, f)->next) {
+        Sym field = AST_NODE(ast, f)->name;
+        ob_putc(out, '.');
+        emit_name(out, field);
+        ob_lit(out, " = memset(");
+        for (int i = 0; i < 2; i++) {
+            if (i) ob_lit(out, ", 0, sizeof(");
+            emit_name(out, var->name);
+            ob_lit(out, "__");
+            emit_name(out, field);
+        }
+        ob_lit(out, ")), ");
+    }
+    ob_lit(out, ".len = ");
+    ob_int(out, len);
+    ob_putc(out, '}');
+}
+
+// Inside a function an svar is a plain C local. A gvar keeps its value
+// for the whole run: it has static storage, still only visible in its
+// scope, and takes its initializer once. A literal initializes the
+// storage itself; anything else is evaluated the first time the
+// declaration runs, behind a flag.
+static void emit_local(struct Ast *ast, NodeId id, struct OutBuf *out, int depth) {
+    struct Node *var = AST_NODE(ast, id);
+    if (!var->lhs) return;
+    emit_indent(out, depth);
+    struct Node *init = AST_NODE(ast, var->lhs);
+    bool literal = init->kind == NODE_INT || init->kind == NODE_FLOAT || init->kind == NODE_BOOL ||
+                   init->kind == NODE_NULL || init->kind == NODE_STRING;
+    if (!(var->flags & NODE_GLOBAL) || literal) {
+        if (var->flags & NODE_GLOBAL) ob_lit(out, "static ");
+        emit_declarator(ast, out, var->type, var->elem, var->record, var->name);
+        ob_lit(out, " = ");
+        emit_initializer(ast, var->lhs, out, var->flags & NODE_GLOBAL);
+        ob_lit(out, ";\n");
+        return;
+    }
+
+    // a fixed array gets static storage next to it, filled the first time
+    long len = init->kind == NODE_ARRAY || init->kind == NODE_ARRAY_NEW ? fixed_length(ast, var->lhs, true) : 0;
+    bool soa = is_soa(ast, init->elem, init->record);
+    if (len && soa) {
+        emit_soa_storage(ast, id, len, out, depth);
+    } else if (len) {
+        ob_lit(out, "static ");
+        emit_declarator(ast, out, init->elem, TYPE_NONE, init->record, var->name);
+        ob_lit(out, "__data[");
+        ob_int(out, len);
+        ob_lit(out, "];\n");
+        emit_indent(out, depth);
+    }
+    ob_lit(out, "static ");
+    emit_declarator(ast, out, var->type, var->elem, var->record, var->name);
+    ob_lit(out, ";\n");
+    emit_indent(out, depth);
+    ob_lit(out, "static bool ");
+    emit_name(out, var->name);
+    ob_lit(out, "__set;\n");
+    emit_indent(out, depth);
+    ob_lit(out, "if (!");
+    emit_name(out, var->name);
+    ob_lit(out, "__set) {\n");
+    emit_indent(out, depth + 1);
+    emit_name(out, var->name);
+    ob_lit(out, "__set = true;\n");
+    emit_indent(out, depth + 1);
+    emit_name(out, var->name);
+    ob_lit(out, " = ");
+    if (len) {
+        ob_lit(out, "(");
+        emit_slice_type(ast, out, init->elem, init->record);
+        ob_putc(out, ')');
+    }
+    if (len && soa) {
+        emit_soa_refill(ast, id, len, out);
+    } else if (len) {
+        ob_puts(out, init->kind == NODE_ARRAY ? "{memcpy(" : "{memset(");
+        emit_name(out, var->name);
+        ob_lit(out, "__data, ");
+        if (init->kind == NODE_ARRAY) {
+            emit_elements(ast, var->lhs, out);
+        } else {
+            ob_putc(out, '0');
+        }
+        ob_lit(out, ", sizeof(");
+        emit_name(out, var->name);
+        ob_lit(out, "__data)), ");
+        ob_int(out, len);
+        ob_putc(out, '}');
+    } else if (init->kind == NODE_CONSTRUCT) {
+        emit_value(ast, var->lhs, out);    // assigned, so not a bare initializer
+    } else {
+        emit_initializer(ast, var->lhs, out, false);
+    }
+    ob_lit(out, ";\n");
+    emit_indent(out, depth);
+    ob_lit(out, "}\n");
+}
+
+static const char *assign_text[] = {
+    [OP_NONE] = " = ",
+    [OP_MUL] = " *= ", [OP_DIV] = " /= ", [OP_MOD] = " %= ",
+    [OP_ADD] = " += ", [OP_SUB] = " -= ",
+    [OP_SHL] = " <<= ", [OP_SHR] = " >>= ",
+    [OP_BITAND] = " &= ", [OP_BITXOR] = " ^= ", [OP_BITOR] = " |= ",
+};
+
+// Whether `id` is an element of a vec or map, or a field of one, which
+// is reached through a pointer into the container.
+static bool in_container(struct Ast *ast, NodeId id) {
+    while (AST_NODE(ast, id)->kind == NODE_MEMBER) id = AST_NODE(ast, id)->lhs;
+    struct Node *node = AST_NODE(ast, id);
+    return node->kind == NODE_INDEX && is_container(AST_NODE(ast, node->lhs)->type);
+}
+
+// What an assignment stores into, where a map element missing its key
+// is added, zero, first.
+static void emit_place(struct Ast *ast, NodeId id, struct OutBuf *out) {
+    struct Node *node = AST_NODE(ast, id);
+    if (!in_container(ast, id)) {
+        emit_value(ast, id, out);
+    } else if (node->kind == NODE_MEMBER) {
+        emit_place(ast, node->lhs, out);
+        ob_putc(out, '.');
+        emit_name(out, AST_NODE(ast, id)->name);
+    } else if (AST_NODE(ast, node->lhs)->type == TYPE_MAP) {
+        struct Node *map = AST_NODE(ast, node->lhs);
+        ob_lit(out, "(*");
+        emit_container_name(ast, out, TYPE_MAP, map->elem, map->record);
+        ob_lit(out, "_put(");
+        emit_value(ast, node->lhs, out);
+        ob_lit(out, ", ");
+        emit_value(ast, AST_NODE(ast, id)->rhs, out);
+        ob_lit(out, "))");
+    } else {
+        emit_value(ast, id, out);
+    }
+}
+
+// An assignment, but for soa elements and spawned calls. A value stored
+// into a vec or map that could change the container is evaluated first,
+// so the pointer into it is taken after.
+static void emit_assign(struct Ast *ast, NodeId id, struct OutBuf *out) {
+    struct Node *stmt = AST_NODE(ast, id);
+    NodeId target = stmt->lhs, value = stmt->rhs;
+    int op = stmt->op;
+    bool place = in_container(ast, target);
+    bool first = place && !repeatable(ast, value);
+    bool append = op == OP_ADD && AST_NODE(ast, value)->type == TYPE_STR;
+    bool braces = first || (place && append);
+    if (braces) ob_lit(out, "{ ");
+    if (first) {
+        struct Node *to = AST_NODE(ast, target);
+        emit_type(ast, out, to->type, to->elem, to->record);
+        if (!is_pointer(to->type)) ob_putc(out, ' ');
+        ob_lit(out, "gart_value = ");
+        emit_value(ast, value, out);
+        ob_lit(out, "; ");
+    }
+    if (append) {
+        // 's += t' appends, in place when s was the last string made
+        if (place) {
+            ob_lit(out, "gart_str *gart_slot = &");
+            emit_place(ast, target, out);
+            ob_lit(out, "; *gart_slot = gart_str_cat(*gart_slot, ");
+        } else {
+            emit_value(ast, target, out);
+            ob_lit(out, " = gart_str_cat(");
+            emit_value(ast, target, out);
+            ob_lit(out, ", ");
+        }
+        if (first) ob_lit(out, "gart_value");
+        else emit_value(ast, value, out);
+        ob_lit(out, ");");
+    } else {
+        emit_place(ast, target, out);
+        ob_puts(out, assign_text[op]);
+        if (first) ob_lit(out, "gart_value");
+        else emit_value(ast, value, out);
+        ob_putc(out, ';');
+    }
+    ob_puts(out, braces ? " }\n" : "\n");
+}
+
+// "(cond)", without doubling the parentheses of a binary expression.
+static void emit_condition(struct Ast *ast, NodeId id, struct OutBuf *out) {
+    if (AST_NODE(ast, id)->kind == NODE_BINARY) {
+        emit_value(ast, id, out);
+    } else {
+        ob_putc(out, '(');
+        emit_value(ast, id, out);
+        ob_putc(out, ')');
+    }
+}
+
+static void emit_statements(struct Ast *ast, NodeId first, struct OutBuf *out, int depth);
+
+// "{\n ... }" around the statements of a block.
+static void emit_block(struct Ast *ast, NodeId block, struct OutBuf *out, int depth) {
+    ob_lit(out, "{\n");
+    emit_statements(ast, AST_NODE(ast, block)->lhs, out, depth + 1);
+    emit_indent(out, depth);
+    ob_putc(out, '}');
+}
+
+static bool is_negative_literal(struct Node *node) {
+    return (node->kind == NODE_INT && node->int_value < 0) ||
+           (node->kind == NODE_FLOAT && node->float_value < 0);
+}
+
+static void emit_for_test(struct Ast *ast, NodeId id, bool constant_end, bool down, struct OutBuf *out) {
+    struct Node *loop = AST_NODE(ast, id);
+    Sym name = AST_NODE(ast, loop->lhs)->name;
+    emit_name(out, name);
+    ob_puts(out, down ? " >= " : " <= ");
+    if (constant_end) {
+        emit_value(ast, loop->alt, out);
+    } else {
+        emit_name(out, name);
+        ob_lit(out, "__end");
+    }
+}
+
+static const char *reduction_text[] = {
+    [OP_ADD] = "+", [OP_MUL] = "*", [OP_BITAND] = "&", [OP_BITXOR] = "^", [OP_BITOR] = "|",
+};
+
+// What a 'simd for' needs ahead of it: its end, which OpenMP won't have
+// declared in the loop's init, a restrict pointer per array listed by
+// prepare_parallel, and the pragma with the reductions.
+static void emit_simd_preamble(struct Ast *ast, NodeId id, bool constant_end, struct OutBuf *out, int depth) {
+    struct Node *var = AST_NODE(ast, AST_NODE(ast, id)->lhs);
+    if (!constant_end) {
+        emit_indent(out, depth);
+        emit_type(ast, out, var->type, var->elem, var->record);
+        ob_putc(out, ' ');
+        emit_name(out, var->name);
+        ob_lit(out, "__end = ");
+        emit_value(ast, AST_NODE(ast, id)->alt, out);
+        ob_lit(out, ";\n");
+    }
+    for (NodeId clause = var->rhs; clause; clause = AST_NODE(ast, clause)->next) {
+        struct Node *node = AST_NODE(ast, clause);
+        if (node->kind == NODE_IDENT && node->op != OP_NONE) continue;
+        // 'T *restrict a__ptr = a.ptr;', or 'a__x = a.x' for a soa field
+        struct Node *array = AST_NODE(ast, node->kind == NODE_MEMBER ? node->lhs : clause);
+        struct Node *decl = AST_NODE(ast, array->rhs);
+        Sym member = intern_cstr("ptr");
+        emit_indent(out, depth);
+        if (node->kind == NODE_MEMBER) {
+            struct Node *field = AST_NODE(ast, ast_find_field(ast, decl->record, node->name));
+            emit_type(ast, out, field->type, field->elem, field->record);
+            member = node->name;
+        } else {
+            emit_type(ast, out, decl->elem, TYPE_NONE, decl->record);
+        }
+        ob_lit(out, " *restrict ");
+        emit_name(out, array->name);
+        ob_lit(out, "__");
+        emit_name(out, member);
+        ob_lit(out, " = ");
+        emit_name(out, array->name);
+        ob_putc(out, '.');
+        emit_name(out, member);
+        ob_lit(out, ";\n");
+    }
+    emit_indent(out, depth);
+    ob_lit(out, "#pragma omp simd");
+    for (NodeId clause = var->rhs; clause; clause = AST_NODE(ast, clause)->next) {
+        struct Node *node = AST_NODE(ast, clause);
+        if (node->kind != NODE_IDENT || node->op == OP_NONE) continue;
+        ob_lit(out, " reduction(");
+        ob_puts(out, reduction_text[node->op]);
+        ob_putc(out, ':');
+        emit_name(out, node->name);
+        ob_putc(out, ')');
+    }
+    ob_putc(out, '\n');
+    emit_indent(out, depth);
+}
+
+// "T *", where a spawned call's result goes and a 'parallel for' finds a
+// variable from outside its body.
+static void emit_pointer_type(struct Ast *ast, struct OutBuf *out, int type, int elem, int record) {
+    emit_type(ast, out, type, elem, record);
+    if (!is_pointer(type)) ob_putc(out, ' ');
+    ob_putc(out, '*');
+}
+
+static bool spawned(struct Ast *ast, NodeId id) {
+    return id && AST_NODE(ast, id)->kind == NODE_CALL && (AST_NODE(ast, id)->flags & NODE_SPAWN);
+}
+
+static void emit_task_name(struct OutBuf *out, const char *prefix, NodeId id) {
+    ob_puts(out, prefix);
+    ob_int(out, id);
+}
+
+// The C function a spawned call runs as, with the struct of what it is
+// handed: the arguments, evaluated by the spawner, and where the result
+// goes when it is kept. `result` is the variable, 0 for none.
+static void emit_spawn_task(struct Ast *ast, NodeId id, NodeId result, struct OutBuf *out) {
+    struct Node *call = AST_NODE(ast, id);
+    bool args = result || call->lhs;
+    if (args) {
+        ob_lit(out, "struct ");
+        emit_task_name(out, "gart_spawn", id);
+        ob_lit(out, " {\n");
+        if (result) {
+            struct Node *decl = AST_NODE(ast, result);
+            ob_lit(out, "    ");
+            emit_pointer_type(ast, out, decl->type, decl->elem, decl->record);
+            ob_lit(out, "result;\n");
+        }
+        int n = 0;
+        for (NodeId arg = call->lhs; arg; arg = AST_NODE(ast, arg)->next) {
+            struct Node *node = AST_NODE(ast, arg);
+            ob_lit(out, "    ");
+            emit_type(ast, out, node->type, node->elem, node->record);
+            if (!is_pointer(node->type)) ob_putc(out, ' ');
+            ob_putc(out, 'a');
+            ob_int(out, n++);
+            ob_lit(out, ";\n");
+        }
+        ob_lit(out, "};\n\n");
+    }
+
+    ob_lit(out, "static void ");
+    emit_task_name(out, "gart_spawn", id);
+    ob_lit(out, "(void *gart_args) {\n");
+    if (args) {
+        ob_lit(out, "    struct ");
+        emit_task_name(out, "gart_spawn", id);
+        ob_lit(out, " *args = gart_args;\n    ");
+    } else {
+        ob_lit(out, "    (void)gart_args;\n    ");
+    }
+    if (result) ob_lit(out, "*args->result = ");
+    emit_name(out, AST_NODE(ast, id)->name);
+    ob_putc(out, '(');
+    int n = 0;
+    for (NodeId arg = AST_NODE(ast, id)->lhs; arg; arg = AST_NODE(ast, arg)->next) {
+        if (n) ob_lit(out, ", ");
+        ob_lit(out, "args->a");
+        ob_int(out, n++);
+    }
+    ob_lit(out, ");\n}\n\n");
+}
+
+// 'gart_spawn(&gart_tasks, gart_spawnN, &(struct gart_spawnN){&x, args},
+// sizeof(struct gart_spawnN));', the runtime copying the struct.
+static void emit_spawn(struct Ast *ast, NodeId id, NodeId result, struct OutBuf *out, int depth) {
+    struct Node *call = AST_NODE(ast, id);
+    emit_indent(out, depth);
+    ob_lit(out, "gart_spawn(&gart_tasks, ");
+    emit_task_name(out, "gart_spawn", id);
+    if (!result && !call->lhs) {
+        ob_lit(out, ", NULL, 0);\n");
+        return;
+    }
+    ob_lit(out, ", &(struct ");
+    emit_task_name(out, "gart_spawn", id);
+    ob_lit(out, "){");
+    if (result) {
+        ob_putc(out, '&');
+        emit_name(out, AST_NODE(ast, result)->name);
+    }
+    for (NodeId arg = call->lhs; arg; arg = AST_NODE(ast, arg)->next) {
+        if (result || arg != call->lhs) ob_lit(out, ", ");
+        emit_value(ast, arg, out);
+    }
+    ob_lit(out, "}, sizeof(struct ");
+    emit_task_name(out, "gart_spawn", id);
+    ob_lit(out, "));\n");
+}
+
+// What a reduction starts from in each range: 0, or 1 for '*' and all
+// ones for '&'.
+static const char *reduction_identity[] = {
+    [OP_ADD] = "0", [OP_MUL] = "1", [OP_BITAND] = "~0", [OP_BITXOR] = "0", [OP_BITOR] = "0",
+};
+
+// A 'parallel for' becomes a C function running its turns [lo, hi), which
+// the runtime calls for the ranges it splits the loop into. It is handed
+// the start and the address of each variable from outside the body that
+// prepare_parallel listed; it works on copies, and adds its part of each
+// reduction back under the runtime's lock.
+static void emit_parallel_task(struct Ast *ast, NodeId id, struct OutBuf *out) {
+    struct Node *loop = AST_NODE(ast, id);
+    struct Node *var = AST_NODE(ast, loop->lhs);
+    NodeId step = AST_NODE(ast, loop->alt)->next;
+    ob_lit(out, "struct ");
+    emit_task_name(out, "gart_par", id);
+    ob_lit(out, " {\n    ");
+    emit_type(ast, out, var->type, var->elem, var->record);
+    ob_lit(out, " gart_start;\n");
+    for (NodeId clause = var->rhs; clause; clause = AST_NODE(ast, clause)->next) {
+        struct Node *decl = AST_NODE(ast, AST_NODE(ast, clause)->rhs);
+        ob_lit(out, "    ");
+        emit_pointer_type(ast, out, decl->type, decl->elem, decl->record);
+        emit_name(out, decl->name);
+        ob_lit(out, ";\n");
+    }
+    ob_lit(out, "};\n\n");
+
+    ob_lit(out, "static void ");
+    emit_task_name(out, "gart_par", id);
+    ob_lit(out, "(void *gart_ctx, int64_t gart_lo, int64_t gart_hi) {\n    struct ");
+    emit_task_name(out, "gart_par", id);
+    ob_lit(out, " *gart_p = gart_ctx;\n");
+    bool reductions = false;
+    for (NodeId clause = var->rhs; clause; clause = AST_NODE(ast, clause)->next) {
+        struct Node *node = AST_NODE(ast, clause);
+        struct Node *decl = AST_NODE(ast, node->rhs);
+        ob_lit(out, "    ");
+        emit_declarator(ast, out, decl->type, decl->elem, decl->record, decl->name);
+        if (node->op != OP_NONE) {
+            ob_lit(out, " = ");
+            ob_puts(out, reduction_identity[node->op]);
+            reductions = true;
+        } else {
+            ob_lit(out, " = *gart_p->");
+            emit_name(out, decl->name);
+        }
+        ob_lit(out, ";\n");
+    }
+    if (loop->flags & NODE_TASKS) ob_lit(out, "    struct gart_frame gart_tasks = {0};\n");
+    // the body keeps a block of its own, where it may reuse the counter's name
+    ob_lit(out, "    for (int64_t gart_k = gart_lo; gart_k < gart_hi; gart_k++) {\n        ");
+    emit_declarator(ast, out, var->type, var->elem, var->record, var->name);
+    ob_lit(out, " = (");
+    emit_type(ast, out, var->type, var->elem, var->record);
+    ob_lit(out, ")(gart_p->gart_start + gart_k * ");
+    if (step) {
+        emit_value(ast, step, out);
+    } else {
+        ob_putc(out, '1');
+    }
+    ob_lit(out, ");\n        ");
+    emit_block(ast, loop->rhs, out, 2);
+    ob_lit(out, "\n    }\n");
+    if (loop->flags & NODE_TASKS) ob_lit(out, "    gart_sync(&gart_tasks);\n");
+    if (reductions) {
+        ob_lit(out, "    gart_lock();\n");
+        for (NodeId clause = var->rhs; clause; clause = AST_NODE(ast, clause)->next) {
+            struct Node *node = AST_NODE(ast, clause);
+            if (node->op == OP_NONE) continue;
+            ob_lit(out, "    *gart_p->");
+            emit_name(out, node->name);
+            ob_puts(out, assign_text[node->op]);
+            emit_name(out, node->name);
+            ob_lit(out, ";\n");
+        }
+        ob_lit(out, "    gart_unlock();\n");
+    }
+    ob_lit(out, "}\n\n");
+}
+
+// '{ struct gart_parN gart_par = {start, &x}; gart_parallel_for(...); }':
+// the end is evaluated once, before any turn runs.
+static void emit_parallel_for(struct Ast *ast, NodeId id, struct OutBuf *out, int depth) {
+    struct Node *loop = AST_NODE(ast, id);
+    struct Node *var = AST_NODE(ast, loop->lhs);
+    NodeId step = AST_NODE(ast, loop->alt)->next;
+    ob_lit(out, "{\n");
+    emit_indent(out, depth + 1);
+    ob_lit(out, "struct ");
+    emit_task_name(out, "gart_par", id);
+    ob_lit(out, " gart_par = {");
+    emit_value(ast, var->lhs, out);
+    for (NodeId clause = var->rhs; clause; clause = AST_NODE(ast, clause)->next) {
+        ob_lit(out, ", &");
+        emit_name(out, AST_NODE(ast, clause)->name);
+    }
+    ob_lit(out, "};\n");
+    emit_indent(out, depth + 1);
+    ob_lit(out, "gart_parallel_for(gart_count(gart_par.gart_start, ");
+    emit_value(ast, AST_NODE(ast, id)->alt, out);
+    ob_lit(out, ", ");
+    if (step) {
+        emit_value(ast, step, out);
+    } else {
+        ob_putc(out, '1');
+    }
+    ob_lit(out, "), ");
+    emit_task_name(out, "gart_par", id);
+    ob_lit(out, ", &gart_par);\n");
+    emit_indent(out, depth);
+    ob_lit(out, "}\n");
+}
+
+// 'for i = start, end, step' counts up to and including end, or down to
+// it when the step is negative. The end and the step are evaluated once;
+// when the step is a literal the direction is settled here, not per turn.
+// A 'simd for' goes in a block of its own, after its preamble; a 'parallel
+// for' calls into the runtime instead.
+static void emit_for(struct Ast *ast, NodeId id, struct OutBuf *out, int depth) {
+    struct Node *loop = AST_NODE(ast, id);
+    struct Node *var = AST_NODE(ast, loop->lhs);
+    NodeId end = loop->alt;
+    NodeId step = AST_NODE(ast, end)->next;
+    int step_kind = step ? AST_NODE(ast, step)->kind : NODE_INT;
+    bool constant_step = step_kind == NODE_INT || step_kind == NODE_FLOAT;
+    bool constant_end = AST_NODE(ast, end)->kind == NODE_INT || AST_NODE(ast, end)->kind == NODE_FLOAT;
+    bool simd = loop->flags & NODE_SIMD;
+
+    if (loop->flags & NODE_PARALLEL) {
+        emit_parallel_for(ast, id, out, depth);
+        return;
+    }
+    if (simd) {
+        ob_lit(out, "{\n");
+        emit_simd_preamble(ast, id, constant_end, out, ++depth);
+    }
+    ob_lit(out, "for (");
+    emit_declarator(ast, out, var->type, var->elem, var->record, var->name);
+    ob_lit(out, " = ");
+    emit_value(ast, var->lhs, out);
+    if (!constant_end && !simd) {
+        ob_lit(out, ", ");
+        emit_name(out, var->name);
+        ob_lit(out, "__end = ");
+        emit_value(ast, end, out);
+    }
+    if (!constant_step) {
+        ob_lit(out, ", ");
+        emit_name(out, var->name);
+        ob_lit(out, "__step = ");
+        emit_value(ast, step, out);
+    }
+    ob_lit(out, "; ");
+
+    if (constant_step) {
+        emit_for_test(ast, id, constant_end, step && is_negative_literal(AST_NODE(ast, step)), out);
+    } else {
+        emit_name(out, var->name);
+        ob_lit(out, "__step > 0 ? ");
+        emit_for_test(ast, id, constant_end, false, out);
+        ob_lit(out, " : ");
+        emit_for_test(ast, id, constant_end, true, out);
+    }
+    ob_lit(out, "; ");
+
+    emit_name(out, var->name);
+    if (!step) {
+        ob_lit(out, "++");
+    } else if (constant_step) {
+        ob_lit(out, " += ");
+        emit_value(ast, step, out);
+    } else {
+        ob_lit(out, " += ");
+        emit_name(out, var->name);
+        ob_lit(out, "__step");
+    }
+    ob_lit(out, ") ");
+    emit_block(ast, loop->rhs, out, depth);
+    ob_putc(out, '\n');
+    if (simd) {
+        emit_indent(out, depth - 1);
+        ob_lit(out, "}\n");
+    }
+}
+
+// C types the conversions of printf take, by length modifier.
+static const char *signed_types[] = {
+    [LENGTH_NONE] = "int", [LENGTH_HH] = "signed char", [LENGTH_H] = "short", [LENGTH_L] = "long",
+    [LENGTH_LL] = "long long", [LENGTH_J] = "intmax_t", [LENGTH_Z] = "ptrdiff_t", [LENGTH_T] = "ptrdiff_t",
+};
+static const char *unsigned_types[] = {
+    [LENGTH_NONE] = "unsigned", [LENGTH_HH] = "unsigned char", [LENGTH_H] = "unsigned short",
+    [LENGTH_L] = "unsigned long", [LENGTH_LL] = "unsigned long long", [LENGTH_J] = "uintmax_t",
+    [LENGTH_Z] = "size_t", [LENGTH_T] = "size_t",
+};
+
+// The argument converted as printf would read it: '(T)(value)'.
+static void emit_converted(struct Ast *ast, const struct FormatSpec *spec, NodeId arg, struct OutBuf *out) {
+    const char *type = NULL;
+    switch (spec->conv) {
+        case 'd': case 'i':
+            type = signed_types[spec->length];
+            break;
+        case 'o': case 'u': case 'x': case 'X':
+            type = unsigned_types[spec->length];
+            break;
+        case 'c':
+            type = spec->plain ? "char" : "int";
+            break;
+        case 'p':
+            type = "void *";
+            break;
+        case 's':
+            break;
+        default:
+            type = "double";
+    }
+    // gart_line_text takes the string itself, snprintf a char *
+    if (AST_NODE(ast, arg)->type == TYPE_STR && !(spec->plain && spec->conv == 's')) {
+        emit_cstr(ast, arg, out);
+        return;
+    }
+    if (type) {
+        ob_putc(out, '(');
+        ob_puts(out, type);
+        ob_lit(out, ")(");
+    }
+    emit_value(ast, arg, out);
+    if (type) ob_putc(out, ')');
+}
+
+// The text gathered since the last conversion, if any.
+static void emit_line_text(struct OutBuf *text, struct OutBuf *out, int depth) {
+    if (text->len == 0) return;
+    emit_indent(out, depth);
+    if (text->len == 1) {
+        ob_lit(out, "gart_line_char(&gart_line, '");
+        emit_escaped_text(out, text->data, 1);
+        ob_lit(out, "');\n");
+    } else {
+        ob_lit(out, "gart_line_str(&gart_line, \"");
+        emit_escaped_text(out, text->data, text->len);
+        ob_lit(out, "\", ");
+        ob_int(out, text->len);
+        ob_lit(out, ");\n");
+    }
+    text->len = 0;
+}
+
+// A println whose format check_formats parsed, written to a gart_line
+// piece by piece: the text as it is, each plain conversion by a writer of
+// its own, and the others through snprintf one at a time.
+static void emit_println(struct Ast *ast, NodeId id, struct OutBuf *out, int depth) {
+    NodeId format_node = AST_NODE(ast, id)->lhs;
+    const char *format = sym_str(AST_NODE(ast, format_node)->str);
+    int len = sym_len(AST_NODE(ast, format_node)->str);
+    NodeId arg = AST_NODE(ast, format_node)->next;
+    struct OutBuf text;
+    ob_init(&text);
+
+    ob_lit(out, "{\n");
+    emit_indent(out, depth + 1);
+    ob_lit(out, "struct gart_line gart_line;\n");
+    emit_indent(out, depth + 1);
+    ob_lit(out, "gart_line.len = 0;\n");
+    for (int at = 0; at < len; at++) {
+        if (format[at] != '%') {
+            ob_putc(&text, format[at]);
+            continue;
+        }
+        struct FormatSpec spec;
+        format_spec(format, len, at, &spec);
+        at += spec.len - 1;
+        if (spec.conv == '%') {
+            ob_putc(&text, '%');
+            continue;
+        }
+        if (spec.plain && spec.conv == 's' && AST_NODE(ast, arg)->kind == NODE_STRING) {
+            // a constant string is more text
+            ob_write(&text, sym_str(AST_NODE(ast, arg)->str), sym_len(AST_NODE(ast, arg)->str));
+            arg = AST_NODE(ast, arg)->next;
+            continue;
+        }
+        emit_line_text(&text, out, depth + 1);
+        emit_indent(out, depth + 1);
+        if (!spec.plain) {
+            ob_lit(out, "gart_line_format(&gart_line, \"");
+            emit_escaped_text(out, format + spec.offset, spec.len);
+            ob_putc(out, '"');
+            for (int c = 0; c < spec.stars; c++) {
+                ob_lit(out, ", (int)(");
+                emit_value(ast, arg, out);
+                ob_putc(out, ')');
+                arg = AST_NODE(ast, arg)->next;
+            }
+            ob_lit(out, ", ");
+            emit_converted(ast, &spec, arg, out);
+            ob_lit(out, ");\n");
+            arg = AST_NODE(ast, arg)->next;
+            continue;
+        }
+        switch (spec.conv) {
+            case 'd': case 'i': ob_lit(out, "gart_line_int(&gart_line, "); break;
+            case 'u':           ob_lit(out, "gart_line_uint(&gart_line, "); break;
+            case 'x': case 'X': ob_lit(out, "gart_line_hex(&gart_line, "); break;
+            case 'c':           ob_lit(out, "gart_line_char(&gart_line, "); break;
+            case 's':           ob_lit(out, "gart_line_text(&gart_line, "); break;
+            case 'f':           ob_lit(out, "gart_line_double(&gart_line, "); break;
+        }
+        emit_converted(ast, &spec, arg, out);
+        if (spec.conv == 'x' || spec.conv == 'X') {
+            ob_puts(out, spec.conv == 'X' ? ", 1" : ", 0");
+        } else if (spec.conv == 'f') {
+            ob_lit(out, ", ");
+            ob_int(out, spec.precision < 0 ? 6 : spec.precision);
+        }
+        ob_lit(out, ");\n");
+        arg = AST_NODE(ast, arg)->next;
+    }
+    emit_line_text(&text, out, depth + 1);
+    emit_indent(out, depth + 1);
+    ob_lit(out, "gart_line_flush(&gart_line);\n");
+    emit_indent(out, depth);
+    ob_lit(out, "}\n");
+    ob_free(&text);
+}
+
+static void emit_statement(struct Ast *ast, NodeId id, struct OutBuf *out, int depth) {
+    struct Node *stmt = AST_NODE(ast, id);
+    switch (stmt->kind) {
+        case NODE_RETURN:
+            emit_indent(out, depth);
+            if (stmt->flags & NODE_TASKS) {
+                ob_lit(out, "gart_sync(&gart_tasks);\n");
+                emit_indent(out, depth);
+            }
+            if (!stmt->lhs) {
+                ob_lit(out, "return ");
+                emit_zero_value(ast, out, stmt->type, stmt->elem, stmt->record);
+                ob_lit(out, ";\n");
+                break;
+            }
+            ob_lit(out, "return ");
+            emit_value(ast, stmt->lhs, out);
+            ob_lit(out, ";\n");
+            break;
+        case NODE_VARIABLE:
+            if (spawned(ast, stmt->lhs)) {
+                // zero until the task stores the result
+                emit_indent(out, depth);
+                emit_declarator(ast, out, stmt->type, stmt->elem, stmt->record, stmt->name);
+                ob_lit(out, " = ");
+                emit_zero(ast, out, stmt->type, stmt->record);
+                ob_lit(out, ";\n");
+                emit_spawn(ast, AST_NODE(ast, id)->lhs, id, out, depth);
+                break;
+            }
+            emit_local(ast, id, out, depth);
+            break;
+        case NODE_CALL:
+            if (stmt->flags & NODE_SPAWN) {
+                emit_spawn(ast, id, 0, out, depth);
+                break;
+            }
+            if (stmt->flags & NODE_FORMAT) {
+                emit_indent(out, depth);
+                emit_println(ast, id, out, depth);
+                break;
+            }
+            emit_indent(out, depth);
+            emit_call(ast, id, out);
+            ob_lit(out, ";\n");
+            break;
+        case NODE_ASSIGN: {
+            if (spawned(ast, stmt->rhs)) {
+                emit_spawn(ast, stmt->rhs, AST_NODE(ast, stmt->lhs)->rhs, out, depth);
+                break;
+            }
+            emit_indent(out, depth);
+            struct Node *target = AST_NODE(ast, stmt->lhs);
+            struct Node *array = target->kind == NODE_INDEX ? AST_NODE(ast, target->lhs) : NULL;
+            if (array && is_soa(ast, array->elem, array->record)) {
+                // a whole element of a soa array is scattered to its fields
+                emit_slice_type(ast, out, array->elem, array->record);
+                ob_lit(out, "_set(");
+                emit_value(ast, target->lhs, out);
+                ob_lit(out, ", ");
+                emit_value(ast, target->rhs, out);
+                ob_lit(out, ", ");
+                emit_value(ast, stmt->rhs, out);
+                ob_lit(out, ");\n");
+                break;
+            }
+            emit_assign(ast, id, out);
+            break;
+        }
+        case NODE_BLOCK:
+            // a branch folded away leaves its statements in a block of their own
+            emit_indent(out, depth);
+            emit_block(ast, id, out, depth);
+            ob_putc(out, '\n');
+            break;
+        case NODE_IF:
+            emit_indent(out, depth);
+            for (;;) {
+                ob_lit(out, "if ");
+                emit_condition(ast, stmt->lhs, out);
+                ob_putc(out, ' ');
+                emit_block(ast, stmt->rhs, out, depth);
+                if (!stmt->alt) break;
+                ob_lit(out, " else ");
+                if (AST_NODE(ast, stmt->alt)->kind != NODE_IF) {
+                    emit_block(ast, stmt->alt, out, depth);
+                    break;
+                }
+                stmt = AST_NODE(ast, stmt->alt);
+            }
+            ob_putc(out, '\n');
+            break;
+        case NODE_WHILE:
+            emit_indent(out, depth);
+            ob_lit(out, "while ");
+            emit_condition(ast, stmt->lhs, out);
+            ob_putc(out, ' ');
+            emit_block(ast, stmt->rhs, out, depth);
+            ob_putc(out, '\n');
+            break;
+        case NODE_FOR:
+            emit_indent(out, depth);
+            emit_for(ast, id, out, depth);
+            break;
+        case NODE_BREAK:
+            emit_indent(out, depth);
+            ob_lit(out, "break;\n");
+            break;
+        case NODE_CONTINUE:
+            emit_indent(out, depth);
+            ob_lit(out, "continue;\n");
+            break;
+        case NODE_SYNC:
+            // nothing to wait for where nothing was spawned
+            if (stmt->flags & NODE_TASKS) {
+                emit_indent(out, depth);
+                ob_lit(out, "gart_sync(&gart_tasks);\n");
+            }
+            break;
+    }
+}
+
+static void emit_statements(struct Ast *ast, NodeId first, struct OutBuf *out, int depth) {
+    for (NodeId stmt = first; stmt; stmt = AST_NODE(ast, stmt)->next) {
+        emit_statement(ast, stmt, out, depth);
+    }
+}
+
+static void emit_signature(struct Ast *ast, NodeId id, struct OutBuf *out) {
+    struct Node *func = AST_NODE(ast, id);
+    emit_declarator(ast, out, func->type, func->elem, func->record, func->name);
+    ob_putc(out, '(');
+    for (NodeId param = func->rhs; param; param = AST_NODE(ast, param)->next) {
+        struct Node *p = AST_NODE(ast, param);
+        if (param != func->rhs) ob_lit(out, ", ");
+        emit_declarator(ast, out, p->type, p->elem, p->record, p->name);
+    }
+    ob_putc(out, ')');
+}
+
+// A function that spawns keeps its tasks in a frame, and waits for them
+// before it returns; one with an arena frees it after that.
+static void emit_function(struct Ast *ast, NodeId id, struct OutBuf *out, const char *prefix) {
+    struct Node *func = AST_NODE(ast, id);
+    ob_puts(out, prefix);
+    emit_signature(ast, id, out);
+    ob_lit(out, " {\n");
+    if (func->flags & NODE_REGION) {
+        ob_lit(out, "    struct gart_arena gart_region GART_SCOPED(gart_arena_free) = {0};\n");
+    }
+    if (func->flags & NODE_TASKS) ob_lit(out, "    struct gart_frame gart_tasks = {0};\n");
+    emit_statements(ast, func->lhs, out, 1);
+    NodeId last = func->lhs;
+    while (last && AST_NODE(ast, last)->next) last = AST_NODE(ast, last)->next;
+    if (!(last && AST_NODE(ast, last)->kind == NODE_RETURN)) {
+        // falling off the end returns zero, as 'main' does in C
+        if (func->flags & NODE_TASKS) ob_lit(out, "    gart_sync(&gart_tasks);\n");
+        ob_lit(out, "    return ");
+        emit_zero_value(ast, out, func->type, func->elem, func->record);
+        ob_lit(out, ";\n");
+    }
+    ob_lit(out, "}\n");
+}
+
+// The C functions that spawned calls and 'parallel for' bodies run as go
+// ahead of the function they are in, inner ones first.
+static void emit_tasks(struct Ast *ast, NodeId first, struct OutBuf *out) {
+    for (NodeId stmt = first; stmt; stmt = AST_NODE(ast, stmt)->next) {
+        struct Node *node = AST_NODE(ast, stmt);
+        switch (node->kind) {
+            case NODE_CALL:
+                if (node->flags & NODE_SPAWN) emit_spawn_task(ast, stmt, 0, out);
+                break;
+            case NODE_VARIABLE:
+                if (spawned(ast, node->lhs)) emit_spawn_task(ast, node->lhs, stmt, out);
+                break;
+            case NODE_ASSIGN:
+                if (spawned(ast, node->rhs)) emit_spawn_task(ast, node->rhs, AST_NODE(ast, node->lhs)->rhs, out);
+                break;
+            case NODE_BLOCK:
+                emit_tasks(ast, node->lhs, out);
+                break;
+            case NODE_IF:
+                emit_tasks(ast, node->rhs, out);
+                if (node->alt) emit_tasks(ast, node->alt, out);
+                break;
+            case NODE_WHILE:
+                emit_tasks(ast, node->rhs, out);
+                break;
+            case NODE_FOR:
+                emit_tasks(ast, node->rhs, out);
+                if (node->flags & NODE_PARALLEL) emit_parallel_task(ast, stmt, out);
+                break;
+        }
+    }
+}
+
+void cgen_program(struct Ast *ast, struct OutBuf *out) {
+    for (NodeId decl = ast->first; decl; decl = AST_NODE(ast, decl)->next) {
+        if (AST_NODE(ast, decl)->flags & (NODE_DEAD | NODE_IN_HEADER)) continue;
+        switch (AST_NODE(ast, decl)->kind) {
+            case NODE_FUNCTION:
+                emit_tasks(ast, AST_NODE(ast, decl)->lhs, out);
+                emit_function(ast, decl, out, "");
+                break;
+            case NODE_VARIABLE:
+                emit_global(ast, decl, out);
+                break;
+        }
+    }
+}
+
+// 'typedef struct Name {...} Name;' with the fields in layout order. An
+// 'align(N)' on the struct goes on its first field, which C then applies
+// to the whole struct; on a soa struct it is for the field arrays instead.
+static void emit_struct(struct Ast *ast, int record, struct OutBuf *out) {
+    struct Node *decl = record_decl(ast, record);
+    NodeId struct_align = decl->flags & NODE_SOA ? 0 : decl->rhs;
+    int count;
+    NodeId *order = layout_fields(ast, record, false, &count);
+    ob_lit(out, "typedef struct ");
+    emit_name(out, decl->name);
+    ob_lit(out, " {\n");
+    for (int i = 0; i < count; i++) {
+        struct Node *field = AST_NODE(ast, order[i]);
+        NodeId align = field->rhs;
+        if (i == 0 && struct_align > align) align = struct_align;
+        ob_lit(out, "    ");
+        if (align) {
+            ob_lit(out, "_Alignas(");
+            ob_int(out, align);
+            ob_lit(out, ") ");
+        }
+        emit_declarator(ast, out, field->type, field->elem, field->record, field->name);
+        ob_lit(out, ";\n");
+    }
+    ob_lit(out, "} ");
+    emit_name(out, decl->name);
+    ob_lit(out, ";\n");
+    free(order);
+}
+
+static void emit_soa_name(struct Ast *ast, int record, struct OutBuf *out, const char *suffix) {
+    ob_lit(out, "gart_soa_");
+    emit_name(out, record_decl(ast, record)->name);
+    ob_puts(out, suffix);
+}
+
+// `format` once per field, with the field name for each '@' in it, and
+// `separator` between them.
+static void emit_per_field(struct Ast *ast, const NodeId *order, int count, const char *format,
+                           const char *separator, struct OutBuf *out) {
+    for (int i = 0; i < count; i++) {
+        if (i) ob_puts(out, separator);
+        for (const char *c = format; *c; c++) {
+            if (*c == '@') {
+                emit_name(out, AST_NODE(ast, order[i])->name);
+            } else {
+                ob_putc(out, *c);
+            }
+        }
+    }
+}
+
+// Arrays of a soa struct: one array per field, all of the same length,
+// with GART_SLICE's helpers except that _get and _set copy a whole element
+// in place of _at. The field arrays share one allocation, in decreasing
+// alignment so none needs padding.
+static void emit_soa(struct Ast *ast, int record, struct OutBuf *out) {
+    int count;
+    NodeId *order = layout_fields(ast, record, true, &count);
+    Sym name = record_decl(ast, record)->name;
+
+    ob_lit(out, "typedef struct {\n");
+    for (int i = 0; i < count; i++) {
+        struct Node *field = AST_NODE(ast, order[i]);
+        ob_lit(out, "    ");
+        emit_type(ast, out, field->type, field->elem, field->record);
+        ob_lit(out, " *");
+        emit_name(out, field->name);
+        ob_lit(out, ";\n");
+    }
+    ob_lit(out, "    int64_t len;\n} ");
+    emit_soa_name(ast, record, out, ";\n");
+
+    ob_lit(out, "static inline ");
+    emit_name(out, name);
+    ob_putc(out, ' ');
+    emit_soa_name(ast, record, out, "_get(");
+    emit_soa_name(ast, record, out, " s, int64_t i) {\n");
+    ob_lit(out, "    GART_CHECK_INDEX(i, s.len);\n    return (");
+    emit_name(out, name);
+    ob_lit(out, "){ ");
+    emit_per_field(ast, order, count, ".@ = s.@[i]", ", ", out);
+    ob_lit(out, " };\n}\n");
+
+    ob_lit(out, "static inline void ");
+    emit_soa_name(ast, record, out, "_set(");
+    emit_soa_name(ast, record, out, " s, int64_t i, ");
+    emit_name(out, name);
+    ob_lit(out, " v) {\n    GART_CHECK_INDEX(i, s.len);\n");
+    emit_per_field(ast, order, count, "    s.@[i] = v.@;\n", "", out);
+    ob_lit(out, "}\n");
+
+    ob_lit(out, "static inline ");
+    emit_soa_name(ast, record, out, " ");
+    emit_soa_name(ast, record, out, "_sub(");
+    emit_soa_name(ast, record, out, " s, int64_t lo, int64_t hi) {\n");
+    ob_lit(out, "    GART_CHECK_RANGE(lo, hi, s.len);\n    return (");
+    emit_soa_name(ast, record, out, "){ ");
+    emit_per_field(ast, order, count, "s.@ + lo, ", "", out);
+    ob_lit(out, "hi - lo };\n}\n");
+
+    ob_lit(out, "static inline ");
+    emit_soa_name(ast, record, out, " ");
+    emit_soa_name(ast, record, out, "_from(");
+    emit_soa_name(ast, record, out, " s, int64_t lo) {\n    return ");
+    emit_soa_name(ast, record, out, "_sub(s, lo, s.len);\n}\n");
+
+    // with 'align(N)' every field's array starts at a multiple of N
+    NodeId align = record_decl(ast, record)->rhs;
+    ob_lit(out, "static inline ");
+    emit_soa_name(ast, record, out, " ");
+    emit_soa_name(ast, record, out, "_alloc(struct gart_arena *arena, int64_t len) {\n");
+    for (int i = 0; i < count; i++) {
+        struct Node *field = AST_NODE(ast, order[i]);
+        ob_lit(out, "    size_t ");
+        emit_name(out, field->name);
+        ob_lit(out, "__span = gart_span(len, sizeof(");
+        emit_type(ast, out, field->type, field->elem, field->record);
+        ob_lit(out, "), ");
+        ob_int(out, align ? align : 1);
+        ob_lit(out, ");\n");
+    }
+    ob_lit(out, "    char *at = gart_alloc(arena, 1, ");
+    emit_per_field(ast, order, count, "@__span", " + ", out);
+    ob_lit(out, ", ");
+    if (align) {
+        ob_int(out, align);
+    } else {
+        ob_lit(out, "_Alignof(");
+        emit_name(out, name);
+        ob_putc(out, ')');
+    }
+    ob_lit(out, ");\n    ");
+    emit_soa_name(ast, record, out, " s;\n");
+    for (int i = 0; i < count; i++) {
+        if (i) {
+            ob_lit(out, "    at += ");
+            emit_name(out, AST_NODE(ast, order[i - 1])->name);
+            ob_lit(out, "__span;\n");
+        }
+        ob_lit(out, "    s.");
+        emit_name(out, AST_NODE(ast, order[i])->name);
+        ob_lit(out, " = (void *)at;\n");
+    }
+    ob_lit(out, "    s.len = len;\n    return s;\n}\n");
+    free(order);
+}
+
+// Struct definitions and the slice types for arrays of them, which the
+// prototypes below and the module's code use.
+static void emit_structs(struct Ast *ast, struct OutBuf *out) {
+    for (int record = 1; record < ast->record_count; record++) {
+        emit_struct(ast, record, out);
+        if (record_decl(ast, record)->flags & NODE_SOA) {
+            emit_soa(ast, record, out);
+        } else {
+            ob_lit(out, "GART_SLICE(");
+            emit_name(out, record_decl(ast, record)->name);
+            ob_lit(out, ", gart_slice_");
+            emit_name(out, record_decl(ast, record)->name);
+            ob_lit(out, ")\n");
+        }
+        ob_putc(out, '\n');
+    }
+}
+
+static const char *hash_functions[] = {
+    [TYPE_INT] = "gart_hash_int", [TYPE_INT64] = "gart_hash_int", [TYPE_FLOAT] = "gart_hash_double",
+    [TYPE_DOUBLE] = "gart_hash_double", [TYPE_BOOL] = "gart_hash_int", [TYPE_STR] = "gart_hash_str",
+    [TYPE_POINTER] = "gart_hash_pointer",
+};
+
+// 'GART_VEC(T, gart_vec_T, slice)' or 'GART_MAP(K, V, name, key slice,
+// value slice, hash, eq)', once in the translation unit whichever module
+// header gets there first.
+static void emit_container(struct Ast *ast, int type, int elem, int record, struct OutBuf *out) {
+    ob_lit(out, "#ifndef GART_DEFINED_");
+    emit_container_name(ast, out, type, elem, record);
+    ob_lit(out, "\n#define GART_DEFINED_");
+    emit_container_name(ast, out, type, elem, record);
+    if (type == TYPE_VEC) {
+        ob_lit(out, "\nGART_VEC(");
+        emit_type(ast, out, elem, TYPE_NONE, record);
+        ob_lit(out, ", ");
+        emit_container_name(ast, out, type, elem, record);
+        ob_lit(out, ", ");
+        emit_slice_type(ast, out, elem, record);
+    } else {
+        int key = MAP_KEY(elem), value = MAP_VALUE(elem);
+        ob_lit(out, "\nGART_MAP(");
+        emit_type(ast, out, key, TYPE_NONE, 0);
+        ob_lit(out, ", ");
+        emit_type(ast, out, value, TYPE_NONE, record);
+        ob_lit(out, ", ");
+        emit_container_name(ast, out, type, elem, record);
+        ob_lit(out, ", ");
+        emit_slice_type(ast, out, key, 0);
+        ob_lit(out, ", ");
+        emit_slice_type(ast, out, value, record);
+        ob_lit(out, ", ");
+        ob_puts(out, hash_functions[key]);
+        ob_puts(out, key == TYPE_STR ? ", gart_str_eq" : ", GART_EQ");
+    }
+    ob_lit(out, ")\n#endif\n");
+}
+
+// Every vec and map type the module names, after the structs they may hold.
+static void emit_containers(struct Ast *ast, struct OutBuf *out) {
+    uint32_t *seen = NULL;
+    int count = 0, cap = 0;
+    for (NodeId id = 1; id < ast->node_count; id++) {
+        struct Node *node = AST_NODE(ast, id);
+        if (!is_container(node->type)) continue;
+        uint32_t key = (uint32_t)node->type << 24 | (uint32_t)node->elem << 16 | node->record;
+        int i = 0;
+        while (i < count && seen[i] != key) i++;
+        if (i < count) continue;
+        if (count == cap) {
+            cap = cap ? cap * 2 : 8;
+            seen = realloc(seen, cap * sizeof(uint32_t));
+            if (!seen) {
+                fprintf(stderr, "out of memory\n");
+                exit(1);
+            }
+        }
+        seen[count++] = key;
+        emit_container(ast, node->type, node->elem, node->record, out);
+    }
+    if (count) ob_putc(out, '\n');
+    free(seen);
+}
+
+void cgen_prototypes(struct Ast *ast, struct OutBuf *out) {
+    emit_structs(ast, out);
+    emit_containers(ast, out);
+    for (NodeId decl = ast->first; decl; decl = AST_NODE(ast, decl)->next) {
+        struct Node *node = AST_NODE(ast, decl);
+        if (node->kind == NODE_FUNCTION && node->name != sym_main && !(node->flags & NODE_IN_HEADER)) {
+            emit_signature(ast, decl, out);
+            ob_lit(out, ";\n");
+        }
+    }
+}
+
+void cgen_inline_definitions(struct Ast *ast, struct OutBuf *out) {
+    for (NodeId decl = ast->first; decl; decl = AST_NODE(ast, decl)->next) {
+        struct Node *node = AST_NODE(ast, decl);
+        if (node->kind == NODE_FUNCTION && (node->flags & NODE_IN_HEADER)) {
+            emit_function(ast, decl, out, node->flags & NODE_INLINE ? "GART_ALWAYS_INLINE " : "static inline ");
+        }
+    }
+}
+
+void cgen_literals(struct Ast *ast, struct OutBuf *out) {
+    uint32_t count = 0;
+    for (NodeId id = 1; id < ast->node_count; id++) {
+        if (AST_NODE(ast, id)->flags & NODE_LITERAL) count++;
+    }
+    if (count == 0) return;
+    // the texts defined so far, an open-addressed set
+    uint32_t cap = 16;
+    while (cap < count * 2) cap *= 2;
+    Sym *seen = calloc(cap, sizeof(Sym));
+    if (!seen) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    for (NodeId id = 1; id < ast->node_count; id++) {
+        struct Node *node = AST_NODE(ast, id);
+        if (!(node->flags & NODE_LITERAL)) continue;
+        node->flags &= ~NODE_LITERAL;
+        uint32_t slot = (uint32_t)hash_mix(node->str) & (cap - 1);
+        while (seen[slot] && seen[slot] != node->str) slot = (slot + 1) & (cap - 1);
+        if (seen[slot]) continue;
+        seen[slot] = node->str;
+        // another header may have defined it in this translation unit already
+        emit_literal_name(out, "#ifndef GART_LIT_", node->str);
+        emit_literal_name(out, "\n#define GART_LIT_", node->str);
+        emit_literal_name(out, "\nGART_LITERAL(gart_lit_", node->str);
+        ob_lit(out, ", \"");
+        emit_escaped(out, node->str);
+        ob_lit(out, "\")\n#endif\n");
+    }
+    free(seen);
+}
@@ -0,0 +1,25 @@
+#ifndef CGEN_H
+#define CGEN_H
+
+#include "ast.h"
+#include "outbuf.h"
+
+// C backend: walks a parsed program and appends the equivalent C to `out`.
+void cgen_program(struct Ast *ast, struct OutBuf *out);
+
+// Whether the array literal or '[n]T' `id`, in a function, is allocated
+// at run time rather than on the stack.
+bool cgen_allocates(struct Ast *ast, NodeId id);
+
+// Declarations of the functions `ast` defines, for other modules to call.
+void cgen_prototypes(struct Ast *ast, struct OutBuf *out);
+
+// Definitions of the functions inlined into other modules (NODE_IN_HEADER),
+// included after every module's prototypes.
+void cgen_inline_definitions(struct Ast *ast, struct OutBuf *out);
+
+// Definitions of the string literals the code emitted since the last call
+// uses (NODE_LITERAL), which go ahead of it in the same file.
+void cgen_literals(struct Ast *ast, struct OutBuf *out);
+
+#endif // CGEN_H
@@ -3,37 +3,13 @@
 #include <string.h>
 #include <stdbool.h>
 
+#include "common.h"
 #include "clexer.h"
-
-#define STB_C_LEXER_IMPLEMENTATION
-#include "stb_c_lexer.h"
-
-enum VarType {
-    TYPE_STR,
-    TYPE_INT,
-    TYPE_FLOAT,
-    TYPE_TOKEN,
-};
-
-struct Variable {
-    int type;
-    char *name;
-    char* Str;
-    int Int;
-    int Token;
-    float Float;
-};
+#include "keywords.h"
 
 int float_pc = 0;
 int str_pc = 0;
 bool write_code = false;
-char *functions[2048];
-struct Variable *variables[2048];
-int var_count = 0;
-int func_count = 0;
-
-#define PRINT_ERR(fmt, ...) { printf("\x1b[1;31m"); printf("Error: "); printf("\x1b[0m"); printf(fmt, ##__VA_ARGS__); }
-#define PRINT_ERR2(fmt, ...) printf("\x1b[1;31m"); printf("Error: "); printf("\x1b[0m"); printf(fmt, ##__VA_ARGS__);
 
 const char* CLEX_to_tokenstr[] = {
     [CLEX_eof]         = "<eof>",
@@ -65,219 +41,973 @@ const char* CLEX_to_tokenstr[] = {
     [CLEX_eqarrow]     = "Operator",
     [CLEX_shleq]       = "Operator",
     [CLEX_shreq]       = "Operator",
+    [KW_fn]            = "Keyword",
+    [KW_end]           = "Keyword",
+    [KW_return]        = "Keyword",
+    [KW_gvar]          = "Keyword",
+    [KW_svar]          = "Keyword",
+    [KW_true]          = "Keyword",
+    [KW_false]         = "Keyword",
+    [KW_null]          = "Keyword",
+    [KW_inline]        = "Keyword",
+    [KW_noinline]      = "Keyword",
+    [KW_if]            = "Keyword",
+    [KW_elif]          = "Keyword",
+    [KW_else]          = "Keyword",
+    [KW_while]         = "Keyword",
+    [KW_for]           = "Keyword",
+    [KW_break]         = "Keyword",
+    [KW_continue]      = "Keyword",
+    [KW_len]           = "Keyword",
+    [KW_struct]        = "Keyword",
+    [KW_soa]           = "Keyword",
+    [KW_simd]          = "Keyword",
+    [KW_parallel]      = "Keyword",
+    [KW_spawn]         = "Keyword",
+    [KW_sync]          = "Keyword",
+    [KW_vec]           = "Keyword",
+    [KW_map]           = "Keyword",
 };
 
-char* escape_string(const char* input) {
-    if (!input) return NULL;
-    size_t len = strlen(input);
-    size_t max_len = len * 2 + 1;
-    char* escaped = malloc(max_len);
-    if (!escaped) return NULL;
-
-    char* dst = escaped;
-    for (const char* src = input; *src; src++) {
-        switch (*src) {
-            case '\n': *dst++ = '\\'; *dst++ = 'n'; break;
-            case '\t': *dst++ = '\\'; *dst++ = 't'; break;
-            case '\r': *dst++ = '\\'; *dst++ = 'r'; break;
-            case '\\': *dst++ = '\\'; *dst++ = '\\'; break;
-            case '\"': *dst++ = '\\'; *dst++ = '\"'; break;
-            case '\'': *dst++ = '\\'; *dst++ = '\''; break;
-            default:
-                *dst++ = *src;
-        }
-    }
-    *dst = '\0';
-    return escaped;
-}
-
-bool expect_clex(stb_lexer *lexer, int expected) {
-    if (!stb_c_lexer_get_token(lexer)) {
-        PRINT_ERR("unexpected end of input, expected token %s\n", CLEX_to_tokenstr[expected]);
+bool expect_clex(struct Lexer *lexer, int expected) {
+    // single characters are their own token kind
+    const char *want = expected < 256 ? (char[]){ '\'', (char)expected, '\'', '\0' }
+                                      : CLEX_to_tokenstr[expected];
+    if (!lex_next(lexer)) {
+        PRINT_ERR("unexpected end of input, expected token %s\n", want);
         return false;
     }
     if (lexer->token != expected) {
         const char *got = (lexer->token >= 0 && lexer->token < 256)
                           ? (char[]){ (char)lexer->token, '\0' }
                           : lexer->string;
-        PRINT_ERR("expected token %s, got '%s'\n", CLEX_to_tokenstr[expected], got);
+        PRINT_ERR("expected token %s, got '%s'\n", want, got);
         return false;
     }
     return true;
 }
 
-void parse_return(stb_lexer *lexer, FILE *out, const char* func_name) {
-    stb_c_lexer_get_token(lexer);
+static NodeId parse_expression(struct Lexer *lexer, struct Ast *ast);
 
-    int retVal = 0;
+NodeId parse_return(struct Lexer *lexer, struct Ast *ast) {
+    NodeId ret = ast_new(ast, NODE_RETURN);
 
-    switch(lexer->token)    {
-        case CLEX_intlit:
-            retVal = lexer->int_number;
-            break;
-        //supporting only ints currently
-        /*case CLEX_dqstring:
-            retval = &lexer->string;
-            break;*/ 
-        case CLEX_id:
-            if (strcmp(lexer->string, "true") == 0) {
-                retVal = 1;
-            } else if (strcmp(lexer->string, "false") == 0 || strcmp(lexer->string, "null") == 0) {
-                retVal = 0;
-            }
-            break;
+    if (!lex_next(lexer)) {
+        PRINT_ERR("unexpected end of input after 'return'\n");
+        return 0;
     }
-    fprintf(out, "    return %d;\n", (retVal)); 
-}
-
-void parse_call(stb_lexer *lexer, FILE *out) {
-    const char *fn_name = strdup(lexer->string);
-
-    if (!expect_clex(lexer, '(')) {
-        free((void *)fn_name);
-        return;
+    // a bare 'return' returns 0
+    if (lexer->token == KW_end || lexer->token == KW_elif || lexer->token == KW_else) {
+        lex_unget(lexer);
+        AST_NODE(ast, ret)->lhs = ast_new(ast, NODE_INT);
+        return ret;
     }
+    lex_unget(lexer);
 
-    fprintf(out, "    %s(", fn_name);
-    free((void *)fn_name);
+    NodeId value = parse_expression(lexer, ast);
+    if (!value) return 0;
+    AST_NODE(ast, ret)->lhs = value;
+    return ret;
+}
+
+// Arguments of a call whose name and '(' have been consumed.
+static NodeId parse_call_args(struct Lexer *lexer, struct Ast *ast, Sym name) {
+    NodeId call = ast_new(ast, NODE_CALL);
+    AST_NODE(ast, call)->name = name;
 
-    bool first = true;
+    NodeId last = 0;
 
     while (true) {
-        if (!stb_c_lexer_get_token(lexer)) {
+        if (!lex_next(lexer)) {
             PRINT_ERR("unexpected end of input in function call\n");
-            return;
+            return 0;
         }
 
         if (lexer->token == ')') {
             break; // end
         }
+        lex_unget(lexer);
 
-        if (!first) {
-            fprintf(out, ", ");
-        }
-        first = false;
+        NodeId arg = parse_expression(lexer, ast);
+        if (!arg) return 0;
+        ast_append(ast, call, &last, arg);
 
-        switch (lexer->token) {
-            case CLEX_intlit:
-                fprintf(out, "%ld", lexer->int_number);
-                break;
-            case CLEX_floatlit:
-                fprintf(out, "%f", lexer->real_number);
-                break;
-            case CLEX_dqstring: {
-                char *escaped = escape_string(lexer->string);
-                fprintf(out, "\"%s\"", escaped);
-                free(escaped);
-                break;
-            }
-            case CLEX_id:
-                if (strcmp(lexer->string, "true") == 0) {
-                    fprintf(out, "1");
-                } else if (strcmp(lexer->string, "false") == 0) {
-                    fprintf(out, "0");
-                } else if (strcmp(lexer->string, "null") == 0) {
-                    fprintf(out, "NULL");
-                } else {
-                    fprintf(out, "%s", lexer->string);
-                }
-                break;
-            default:
-                PRINT_ERR("unexpected token in function call argument\n");
-                return;
-        }
-
-        if (!stb_c_lexer_get_token(lexer)) {
+        if (!lex_next(lexer)) {
             PRINT_ERR("expected ',' or ')' after function parameter\n");
-            return;
+            return 0;
         }
 
         if (lexer->token == ')') {
             break;
         } else if (lexer->token != ',') {
             PRINT_ERR("expected ',' between function parameters\n");
-            return;
+            return 0;
         }
 
         // next arg
     }
 
-    fprintf(out, ");\n");
+    return call;
 }
 
-extern void parse_variable(stb_lexer *lexer, FILE *out, bool global);
+NodeId parse_call(struct Lexer *lexer, struct Ast *ast) {
+    Sym name = intern(lexer->string, lexer->string_len);
+    if (!expect_clex(lexer, '(')) return 0;
+    return parse_call_args(lexer, ast, name);
+}
 
-void parse_function(stb_lexer *lexer, FILE *out) {
-    // expect function name after 'fn'
-    if (!expect_clex(lexer, CLEX_id)) return;
-    fprintf(out, "int %s() {\n", lexer->string);
-    char* func_name = strdup(lexer->string);
-    functions[func_count++] = func_name;
+// After 'spawn': the call to run as a task.
+static NodeId parse_spawn(struct Lexer *lexer, struct Ast *ast) {
+    if (!lex_next(lexer) || lexer->token != CLEX_id) {
+        PRINT_ERR("expected a function call after 'spawn'\n");
+        return 0;
+    }
+    Sym name = intern(lexer->string, lexer->string_len);
+    NodeId call = parse_call(lexer, ast);
+    if (!call) return 0;
+    if (ast_find_record(ast, name)) {
+        PRINT_ERR("'spawn' needs a function call, '%s' is a struct\n", sym_str(name));
+        return 0;
+    }
+    AST_NODE(ast, call)->flags |= NODE_SPAWN;
+    return call;
+}
 
-    // expect '('
-    if (!expect_clex(lexer, '(')) return;
-    // expect ')'
-    if (!expect_clex(lexer, ')')) return;
+// The value after '=': an expression, or a spawned call whose result
+// lands in the variable when its task ends.
+static NodeId parse_value(struct Lexer *lexer, struct Ast *ast) {
+    if (lex_next(lexer)) {
+        if (lexer->token == KW_spawn) return parse_spawn(lexer, ast);
+        lex_unget(lexer);
+    }
+    return parse_expression(lexer, ast);
+}
 
+static const struct {
+    const char *name;
+    int         type;
+} type_names[] = {
+    { "int",     TYPE_INT },
+    { "int64",   TYPE_INT64 },
+    { "float",   TYPE_FLOAT },
+    { "double",  TYPE_DOUBLE },
+    { "bool",    TYPE_BOOL },
+    { "string",  TYPE_STR },
+    { "pointer", TYPE_POINTER },
+};
+
+// TYPE_NONE unless the current token names a scalar type or a struct
+// declared above, whose record index goes in `record`.
+static int type_name(struct Lexer *lexer, struct Ast *ast, uint16_t *record) {
+    if (lexer->token != CLEX_id) return TYPE_NONE;
+    for (size_t i = 0; i < sizeof(type_names) / sizeof(type_names[0]); i++) {
+        if (strcmp(lexer->string, type_names[i].name) == 0) return type_names[i].type;
+    }
+    *record = ast_find_record(ast, intern(lexer->string, lexer->string_len));
+    return *record ? TYPE_STRUCT : TYPE_NONE;
+}
+
+static int parse_type(struct Lexer *lexer, struct Ast *ast, uint8_t *elem, uint16_t *record);
+
+// What a vec or map holds: a scalar, or a struct laid out as one.
+static bool container_holds(struct Ast *ast, int type, uint16_t record, const char *what) {
+    if (type == TYPE_STRUCT && (AST_NODE(ast, ast->records[record])->flags & NODE_SOA)) {
+        PRINT_ERR("%s can't hold soa struct '%s', use an array\n", what,
+                  sym_str(AST_NODE(ast, ast->records[record])->name));
+        return false;
+    }
+    if (type > TYPE_POINTER && type != TYPE_STRUCT) {
+        PRINT_ERR("%s holds scalars or structs, not slices, vecs or maps\n", what);
+        return false;
+    }
+    return true;
+}
+
+// After 'vec' or 'map': '[T]' for a vec of T, '[K]V' for a map from K to
+// V, with the types packed in `elem` by MAP_ELEM.
+static int parse_container(struct Lexer *lexer, struct Ast *ast, uint8_t *elem, uint16_t *record) {
+    bool vec = lexer->token == KW_vec;
+    if (!expect_clex(lexer, '[')) return TYPE_NONE;
+    uint8_t inner = TYPE_NONE;
+    int first = parse_type(lexer, ast, &inner, record);
+    if (first == TYPE_NONE || !expect_clex(lexer, ']')) return TYPE_NONE;
+    if (vec) {
+        if (!container_holds(ast, first, *record, "a vec")) return TYPE_NONE;
+        *elem = first;
+        return TYPE_VEC;
+    }
+    if (first > TYPE_POINTER) {
+        PRINT_ERR("map keys are scalars: numbers, bools, strings or pointers\n");
+        return TYPE_NONE;
+    }
+    int value = parse_type(lexer, ast, &inner, record);
+    if (value == TYPE_NONE || !container_holds(ast, value, *record, "a map")) return TYPE_NONE;
+    *elem = MAP_ELEM(first, value);
+    return TYPE_MAP;
+}
+
+// A type name, '[]' and one for a slice of them with the element type
+// in `elem`, or a vec or map type; returns TYPE_NONE after reporting
+// anything else.
+static int parse_type(struct Lexer *lexer, struct Ast *ast, uint8_t *elem, uint16_t *record) {
+    if (!lex_next(lexer)) {
+        PRINT_ERR("unexpected end of input, expected a type\n");
+        return TYPE_NONE;
+    }
+    if (lexer->token == KW_vec || lexer->token == KW_map) return parse_container(lexer, ast, elem, record);
+    if (lexer->token == '[') {
+        if (!expect_clex(lexer, ']')) return TYPE_NONE;
+        uint8_t inner;
+        int type = parse_type(lexer, ast, &inner, record);
+        if (type == TYPE_SLICE) {
+            PRINT_ERR("slices of slices are not supported\n");
+            return TYPE_NONE;
+        }
+        if (type == TYPE_VEC || type == TYPE_MAP) {
+            PRINT_ERR("slices of vecs or maps are not supported\n");
+            return TYPE_NONE;
+        }
+        if (type == TYPE_NONE) return TYPE_NONE;
+        *elem = type;
+        return TYPE_SLICE;
+    }
+    int type = type_name(lexer, ast, record);
+    if (type == TYPE_NONE && lexer->token == CLEX_id) {
+        PRINT_ERR("unknown type '%s'\n", lexer->string);
+    } else if (type == TYPE_NONE) {
+        PRINT_ERR("expected a type\n");
+    }
+    return type;
+}
+
+// After '[': either the elements of an array, '[1, 2, 3]', or the length
+// of a zero-filled one, '[n]double'.
+static NodeId parse_array(struct Lexer *lexer, struct Ast *ast) {
+    NodeId array = ast_new(ast, NODE_ARRAY);
+    NodeId last = 0;
+    int count = 0;
     while (true) {
-        if (!expect_clex(lexer, CLEX_id)) return;
+        if (!lex_next(lexer)) {
+            PRINT_ERR("unexpected end of input in array\n");
+            return 0;
+        }
+        if (lexer->token == ']') break;
+        lex_unget(lexer);
+
+        NodeId element = parse_expression(lexer, ast);
+        if (!element) return 0;
+        ast_append(ast, array, &last, element);
+        count++;
+
+        if (!lex_next(lexer)) {
+            PRINT_ERR("expected ',' or ']' after array element\n");
+            return 0;
+        }
+        if (lexer->token == ']') break;
+        if (lexer->token != ',') {
+            PRINT_ERR("expected ',' between array elements\n");
+            return 0;
+        }
+    }
+
+    if (!lex_next(lexer)) return array;
+    uint16_t record = 0;
+    int elem = type_name(lexer, ast, &record);
+    if (elem == TYPE_NONE) {
+        lex_unget(lexer);
+        if (count == 0) {
+            PRINT_ERR("an empty array needs a length and an element type, as in '[0]int'\n");
+            return 0;
+        }
+        return array;
+    }
+    if (count != 1) {
+        PRINT_ERR("expected one length before '%s'\n", lexer->string);
+        return 0;
+    }
+    struct Node *node = AST_NODE(ast, array);
+    node->kind = NODE_ARRAY_NEW;
+    node->elem = elem;
+    node->record = record;
+    return array;
+}
+
+// 'vec[T]' or 'map[K]V' as a value: a new empty container, optionally
+// followed by '(reserve)' or '(reserve, policy)'. The policy, a literal,
+// is a vec's growth factor or a map's maximum load.
+static NodeId parse_container_new(struct Lexer *lexer, struct Ast *ast) {
+    uint8_t elem = TYPE_NONE;
+    uint16_t record = 0;
+    int type = parse_container(lexer, ast, &elem, &record);
+    if (type == TYPE_NONE) return 0;
+
+    NodeId reserve = 0;
+    double policy = 0;
+    if (lex_next(lexer)) {
+        if (lexer->token != '(') {
+            lex_unget(lexer);
+        } else {
+            NodeId args = parse_call_args(lexer, ast, 0);
+            if (!args) return 0;
+            reserve = AST_NODE(ast, args)->lhs;
+            NodeId knob = reserve ? AST_NODE(ast, reserve)->next : 0;
+            if (knob && AST_NODE(ast, knob)->next) {
+                PRINT_ERR("a new %s takes at most a reserve and a policy\n", type == TYPE_VEC ? "vec" : "map");
+                return 0;
+            }
+            if (knob) {
+                struct Node *value = AST_NODE(ast, knob);
+                policy = value->kind == NODE_FLOAT ? value->float_value
+                         : value->kind == NODE_INT ? (double)value->int_value : -1;
+                if (type == TYPE_VEC && !(policy > 1 && policy <= 16)) {
+                    PRINT_ERR("a vec's growth factor is a literal above 1 and up to 16\n");
+                    return 0;
+                }
+                if (type == TYPE_MAP && !(policy > 0 && policy <= 0.9375)) {
+                    PRINT_ERR("a map's maximum load is a literal above 0 and up to 0.9375\n");
+                    return 0;
+                }
+                AST_NODE(ast, reserve)->next = 0;
+            }
+        }
+    }
+    if (!reserve) reserve = ast_new(ast, NODE_INT);
+
+    NodeId made = ast_new(ast, NODE_ARRAY_NEW);
+    struct Node *node = AST_NODE(ast, made);
+    node->type = type;
+    node->elem = elem;
+    node->record = record;
+    node->lhs = reserve;
+    node->float_value = policy;
+    return made;
+}
+
+static bool lex_in_brackets(struct Lexer *lexer) {
+    if (lex_next(lexer)) return true;
+    PRINT_ERR("unexpected end of input, expected ']'\n");
+    return false;
+}
 
-        if (strcmp(lexer->string, "return") == 0) {
-            parse_return(lexer, out, func_name);
-        } else if (strcmp(lexer->string, "end") == 0) {
-            fprintf(out, "}\n");
+// Any number of '.field', '[index]' and '[start:end]' after `node`; either
+// bound of a slice may be left out.
+static NodeId parse_postfix(struct Lexer *lexer, struct Ast *ast, NodeId node) {
+    while (lex_next(lexer)) {
+        if (lexer->token == '.') {
+            if (!expect_clex(lexer, CLEX_id)) return 0;
+            NodeId member = ast_new(ast, NODE_MEMBER);
+            AST_NODE(ast, member)->name = intern(lexer->string, lexer->string_len);
+            AST_NODE(ast, member)->lhs = node;
+            node = member;
+            continue;
+        }
+        if (lexer->token != '[') {
+            lex_unget(lexer);
             break;
-        } else if (strcmp(lexer->string, "gvar") == 0) {
-            parse_variable(lexer, out, true);
-        } else if (strcmp(lexer->string, "gvar") == 0) {
-            parse_variable(lexer, out, false);
+        }
+        NodeId start = 0, end = 0;
+        bool slice = false;
+        if (!lex_in_brackets(lexer)) return 0;
+        if (lexer->token != ':') {
+            lex_unget(lexer);
+            start = parse_expression(lexer, ast);
+            if (!start) return 0;
+            if (!lex_in_brackets(lexer)) return 0;
+        }
+        if (lexer->token == ':') {
+            slice = true;
+            if (!lex_in_brackets(lexer)) return 0;
+            if (lexer->token != ']') {
+                lex_unget(lexer);
+                end = parse_expression(lexer, ast);
+                if (!end) return 0;
+                if (!lex_in_brackets(lexer)) return 0;
+            }
+        }
+        if (lexer->token != ']') {
+            PRINT_ERR("expected ']' after %s\n", slice ? "slice bounds" : "index");
+            return 0;
+        }
+
+        NodeId access = ast_new(ast, slice ? NODE_SLICE : NODE_INDEX);
+        if (slice && !start) start = ast_new(ast, NODE_INT);
+        AST_NODE(ast, access)->lhs = node;
+        AST_NODE(ast, access)->rhs = start;
+        if (slice) AST_NODE(ast, access)->alt = end;
+        node = access;
+    }
+    return node;
+}
+
+// 'Name(a, b, ...)' of a struct builds a value of it from one value per
+// field, in declaration order, or with every field zero when empty.
+static bool make_construct(struct Ast *ast, NodeId call, uint16_t record) {
+    int fields = 0, values = 0;
+    for (NodeId f = AST_NODE(ast, ast->records[record])->lhs; f; f = AST_NODE(ast, f)->next) fields++;
+    for (NodeId v = AST_NODE(ast, call)->lhs; v; v = AST_NODE(ast, v)->next) values++;
+    if (values != 0 && values != fields) {
+        PRINT_ERR("struct '%s' has %d field%s, %d value%s given\n", sym_str(AST_NODE(ast, call)->name),
+                  fields, fields == 1 ? "" : "s", values, values == 1 ? "" : "s");
+        return false;
+    }
+    AST_NODE(ast, call)->kind = NODE_CONSTRUCT;
+    AST_NODE(ast, call)->record = record;
+    return true;
+}
+
+static NodeId parse_unary(struct Lexer *lexer, struct Ast *ast) {
+    if (!lex_next(lexer)) {
+        PRINT_ERR("unexpected end of input, expected an expression\n");
+        return 0;
+    }
+
+    NodeId node;
+    switch (lexer->token) {
+        case CLEX_intlit:
+            node = ast_new(ast, NODE_INT);
+            AST_NODE(ast, node)->int_value = lexer->int_number;
+            break;
+        case CLEX_floatlit:
+            node = ast_new(ast, NODE_FLOAT);
+            AST_NODE(ast, node)->float_value = lexer->real_number;
+            break;
+        case CLEX_dqstring:
+            node = ast_new(ast, NODE_STRING);
+            AST_NODE(ast, node)->str = intern(lexer->string, lexer->string_len);
+            break;
+        case KW_true:
+        case KW_false:
+            node = ast_new(ast, NODE_BOOL);
+            AST_NODE(ast, node)->int_value = lexer->token == KW_true;
+            break;
+        case KW_null:
+            node = ast_new(ast, NODE_NULL);
+            break;
+        case CLEX_id: {
+            Sym name = intern(lexer->string, lexer->string_len);
+            if (lex_next(lexer)) {
+                if (lexer->token == '(') {
+                    node = parse_call_args(lexer, ast, name);
+                    if (!node) return 0;
+                    uint16_t record = ast_find_record(ast, name);
+                    if (record && !make_construct(ast, node, record)) return 0;
+                    break;
+                }
+                lex_unget(lexer);
+            }
+            node = ast_new(ast, NODE_IDENT);
+            AST_NODE(ast, node)->name = name;
+            break;
+        }
+        case '(':
+            node = parse_expression(lexer, ast);
+            if (!node || !expect_clex(lexer, ')')) return 0;
+            break;
+        case '[':
+            node = parse_array(lexer, ast);
+            if (!node) return 0;
+            break;
+        case KW_vec:
+        case KW_map:
+            node = parse_container_new(lexer, ast);
+            if (!node) return 0;
+            break;
+        case KW_len: {
+            if (!expect_clex(lexer, '(')) return 0;
+            NodeId array = parse_expression(lexer, ast);
+            if (!array || !expect_clex(lexer, ')')) return 0;
+            node = ast_new(ast, NODE_LEN);
+            AST_NODE(ast, node)->lhs = array;
+            break;
+        }
+        case '-':
+        case '!':
+        case '~': {
+            int op = lexer->token == '-' ? OP_NEG : lexer->token == '!' ? OP_NOT : OP_BITNOT;
+            NodeId operand = parse_unary(lexer, ast);
+            if (!operand) return 0;
+            node = ast_new(ast, NODE_UNARY);
+            AST_NODE(ast, node)->op = op;
+            AST_NODE(ast, node)->lhs = operand;
+            return node;
+        }
+        default:
+            PRINT_ERR("expected an expression, got '%s'\n",
+                      lexer->token < 256 ? (char[]){ (char)lexer->token, '\0' } : lexer->string);
+            return 0;
+    }
+    return parse_postfix(lexer, ast, node);
+}
+
+// Binary operator for `token` and its precedence, C's order; OP_NONE if
+// the token doesn't continue an expression.
+static int binary_op(long token, int *prec) {
+    switch (token) {
+        case '*':            *prec = 10; return OP_MUL;
+        case '/':            *prec = 10; return OP_DIV;
+        case '%':            *prec = 10; return OP_MOD;
+        case '+':            *prec = 9;  return OP_ADD;
+        case '-':            *prec = 9;  return OP_SUB;
+        case CLEX_shl:       *prec = 8;  return OP_SHL;
+        case CLEX_shr:       *prec = 8;  return OP_SHR;
+        case '<':            *prec = 7;  return OP_LT;
+        case CLEX_lesseq:    *prec = 7;  return OP_LE;
+        case '>':            *prec = 7;  return OP_GT;
+        case CLEX_greatereq: *prec = 7;  return OP_GE;
+        case CLEX_eq:        *prec = 6;  return OP_EQ;
+        case CLEX_noteq:     *prec = 6;  return OP_NE;
+        case '&':            *prec = 5;  return OP_BITAND;
+        case '^':            *prec = 4;  return OP_BITXOR;
+        case '|':            *prec = 3;  return OP_BITOR;
+        case CLEX_andand:    *prec = 2;  return OP_AND;
+        case CLEX_oror:      *prec = 1;  return OP_OR;
+    }
+    return OP_NONE;
+}
+
+// Precedence climbing: operators binding at least as tight as `min_prec`
+// are folded into the left operand, all of them left associative.
+static NodeId parse_binary(struct Lexer *lexer, struct Ast *ast, int min_prec) {
+    NodeId lhs = parse_unary(lexer, ast);
+    if (!lhs) return 0;
+
+    while (lex_next(lexer)) {
+        int prec;
+        int op = binary_op(lexer->token, &prec);
+        if (op == OP_NONE || prec < min_prec) {
+            lex_unget(lexer);
+            break;
+        }
+        NodeId rhs = parse_binary(lexer, ast, prec + 1);
+        if (!rhs) return 0;
+
+        NodeId node = ast_new(ast, NODE_BINARY);
+        AST_NODE(ast, node)->op = op;
+        AST_NODE(ast, node)->lhs = lhs;
+        AST_NODE(ast, node)->rhs = rhs;
+        lhs = node;
+    }
+    return lhs;
+}
+
+// Leaves the token after the expression for the caller's next lex_next.
+static NodeId parse_expression(struct Lexer *lexer, struct Ast *ast) {
+    return parse_binary(lexer, ast, 1);
+}
+
+extern NodeId parse_variable(struct Lexer *lexer, struct Ast *ast, bool global);
+
+// '(' name: type, ... ')' ['->' type], after the function name.
+static bool parse_signature(struct Lexer *lexer, struct Ast *ast, NodeId func) {
+    if (!expect_clex(lexer, '(')) return false;
+
+    NodeId last = 0;
+    if (!lex_next(lexer)) return false;
+    while (lexer->token != ')') {
+        if (lexer->token != CLEX_id) {
+            PRINT_ERR("expected a parameter name in '%s'\n", sym_str(AST_NODE(ast, func)->name));
+            return false;
+        }
+        NodeId param = ast_new(ast, NODE_PARAM);
+        AST_NODE(ast, param)->name = intern(lexer->string, lexer->string_len);
+        if (!expect_clex(lexer, ':')) return false;
+        uint8_t elem = TYPE_NONE;
+        uint16_t record = 0;
+        int type = parse_type(lexer, ast, &elem, &record);
+        if (type == TYPE_NONE) return false;
+        AST_NODE(ast, param)->type = type;
+        AST_NODE(ast, param)->elem = elem;
+        AST_NODE(ast, param)->record = record;
+
+        if (last) {
+            AST_NODE(ast, last)->next = param;
+        } else {
+            AST_NODE(ast, func)->rhs = param;
+        }
+        last = param;
+
+        if (!lex_next(lexer)) return false;
+        if (lexer->token == ',') {
+            if (!lex_next(lexer)) return false;
+        } else if (lexer->token != ')') {
+            PRINT_ERR("expected ',' or ')' after parameter\n");
+            return false;
+        }
+    }
+
+    AST_NODE(ast, func)->type = TYPE_INT;
+    if (!lex_next(lexer)) return true;
+    if (lexer->token != CLEX_arrow) {
+        lex_unget(lexer);
+        return true;
+    }
+    uint8_t elem = TYPE_NONE;
+    uint16_t record = 0;
+    int type = parse_type(lexer, ast, &elem, &record);
+    if (type == TYPE_NONE) return false;
+    AST_NODE(ast, func)->type = type;
+    AST_NODE(ast, func)->elem = elem;
+    AST_NODE(ast, func)->record = record;
+    return true;
+}
+
+static int assign_op(long token) {
+    switch (token) {
+        case '=':         return OP_NONE;
+        case CLEX_pluseq:  return OP_ADD;
+        case CLEX_minuseq: return OP_SUB;
+        case CLEX_muleq:   return OP_MUL;
+        case CLEX_diveq:   return OP_DIV;
+        case CLEX_modeq:   return OP_MOD;
+        case CLEX_andeq:   return OP_BITAND;
+        case CLEX_oreq:    return OP_BITOR;
+        case CLEX_xoreq:   return OP_BITXOR;
+        case CLEX_shleq:   return OP_SHL;
+        case CLEX_shreq:   return OP_SHR;
+    }
+    return -1;
+}
+
+// A statement starting with a name: a call or an assignment.
+static NodeId parse_call_or_assign(struct Lexer *lexer, struct Ast *ast) {
+    Sym name = intern(lexer->string, lexer->string_len);
+    if (!lex_next(lexer)) {
+        PRINT_ERR("unexpected end of input after '%s'\n", sym_str(name));
+        return 0;
+    }
+    if (lexer->token == '(') return parse_call_args(lexer, ast, name);
+
+    // 'a[i] = v' and 'p.x = v' assign to an element or a field
+    NodeId target = ast_new(ast, NODE_IDENT);
+    AST_NODE(ast, target)->name = name;
+    if (lexer->token == '[' || lexer->token == '.') {
+        lex_unget(lexer);
+        target = parse_postfix(lexer, ast, target);
+        if (!target || !lex_next(lexer)) return 0;
+        if (AST_NODE(ast, target)->kind == NODE_SLICE) {
+            PRINT_ERR("cannot assign to a slice of '%s'\n", sym_str(name));
+            return 0;
+        }
+    }
+
+    int op = assign_op(lexer->token);
+    if (op < 0) {
+        PRINT_ERR("expected a call or an assignment after '%s'\n", sym_str(name));
+        return 0;
+    }
+    NodeId value = op == OP_NONE ? parse_value(lexer, ast) : parse_expression(lexer, ast);
+    if (!value) return 0;
+    if ((AST_NODE(ast, value)->flags & NODE_SPAWN) && AST_NODE(ast, target)->kind != NODE_IDENT) {
+        PRINT_ERR("'spawn' can only store into a variable, not into an element or field of '%s'\n", sym_str(name));
+        return 0;
+    }
+
+    NodeId assign = ast_new(ast, NODE_ASSIGN);
+    AST_NODE(ast, assign)->op = op;
+    AST_NODE(ast, assign)->lhs = target;
+    AST_NODE(ast, assign)->rhs = value;
+    return assign;
+}
+
+static int parse_block(struct Lexer *lexer, struct Ast *ast, NodeId block, Sym func_name, bool branches);
+
+static NodeId new_block(struct Ast *ast) {
+    return ast_new(ast, NODE_BLOCK);
+}
+
+// After 'if' or 'elif'; consumes everything up to the closing 'end'.
+static NodeId parse_if(struct Lexer *lexer, struct Ast *ast, Sym func_name) {
+    NodeId cond = parse_expression(lexer, ast);
+    if (!cond) return 0;
+    NodeId then = new_block(ast);
+    int closing = parse_block(lexer, ast, then, func_name, true);
+    if (!closing) return 0;
+
+    NodeId alt = 0;
+    if (closing == KW_elif) {
+        alt = parse_if(lexer, ast, func_name);
+        if (!alt) return 0;
+    } else if (closing == KW_else) {
+        alt = new_block(ast);
+        if (parse_block(lexer, ast, alt, func_name, false) != KW_end) return 0;
+    }
+
+    NodeId node = ast_new(ast, NODE_IF);
+    AST_NODE(ast, node)->lhs = cond;
+    AST_NODE(ast, node)->rhs = then;
+    AST_NODE(ast, node)->alt = alt;
+    return node;
+}
+
+static NodeId parse_while(struct Lexer *lexer, struct Ast *ast, Sym func_name) {
+    NodeId cond = parse_expression(lexer, ast);
+    if (!cond) return 0;
+    NodeId body = new_block(ast);
+    if (parse_block(lexer, ast, body, func_name, false) != KW_end) return 0;
+
+    NodeId node = ast_new(ast, NODE_WHILE);
+    AST_NODE(ast, node)->lhs = cond;
+    AST_NODE(ast, node)->rhs = body;
+    return node;
+}
+
+// for name = start, end [, step]: counts from start up to (or, with a
+// negative step, down to) end, which is included.
+static NodeId parse_for(struct Lexer *lexer, struct Ast *ast, Sym func_name) {
+    if (!expect_clex(lexer, CLEX_id)) return 0;
+    NodeId var = ast_new(ast, NODE_VARIABLE);
+    AST_NODE(ast, var)->name = intern(lexer->string, lexer->string_len);
+    if (!expect_clex(lexer, '=')) return 0;
+    NodeId start = parse_expression(lexer, ast);
+    if (!start) return 0;
+    AST_NODE(ast, var)->lhs = start;
+
+    if (!expect_clex(lexer, ',')) return 0;
+    NodeId end = parse_expression(lexer, ast);
+    if (!end) return 0;
+    if (lex_next(lexer)) {
+        if (lexer->token == ',') {
+            NodeId step = parse_expression(lexer, ast);
+            if (!step) return 0;
+            AST_NODE(ast, end)->next = step;
         } else {
-            parse_call(lexer, out);
+            lex_unget(lexer);
         }
     }
+
+    NodeId body = new_block(ast);
+    if (parse_block(lexer, ast, body, func_name, false) != KW_end) return 0;
+
+    NodeId node = ast_new(ast, NODE_FOR);
+    AST_NODE(ast, node)->lhs = var;
+    AST_NODE(ast, node)->rhs = body;
+    AST_NODE(ast, node)->alt = end;
+    return node;
 }
 
-void parse_variable(stb_lexer *lexer, FILE *out, bool global) {
-    if (!expect_clex(lexer, CLEX_id)) return;
-    char *variable_name = strdup(lexer->string);
-    if (!expect_clex(lexer, '=')) return;
-    if (!stb_c_lexer_get_token(lexer)) return;
+// Statements up to the 'end' closing a block, or an 'elif'/'else' when
+// `branches` allows them; returns the closing keyword, 0 after an error.
+static int parse_block(struct Lexer *lexer, struct Ast *ast, NodeId block, Sym func_name, bool branches) {
+    NodeId last = 0;
+
+    while (true) {
+        if (!lex_next(lexer)) {
+            PRINT_ERR("unexpected end of input in function '%s'\n", sym_str(func_name));
+            return 0;
+        }
 
-    if (global) {
-        switch(lexer->token) {
-            case CLEX_intlit:
-                fprintf(out, "int %s = %ld;\n", variable_name, lexer->int_number);
+        NodeId stmt;
+        switch (lexer->token) {
+            case KW_return:
+                stmt = parse_return(lexer, ast);
+                break;
+            case KW_end:
+                return KW_end;
+            case KW_elif:
+            case KW_else:
+                if (!branches) {
+                    PRINT_ERR("'%s' without 'if' in function '%s'\n", lexer->string, sym_str(func_name));
+                    return 0;
+                }
+                return lexer->token;
+            case KW_gvar:
+                stmt = parse_variable(lexer, ast, true);
                 break;
-            case CLEX_floatlit:;
-                fprintf(out, "float %s = %f;\n", variable_name, lexer->real_number);
+            case KW_svar:
+                stmt = parse_variable(lexer, ast, false);
                 break;
-            case CLEX_dqstring:
-                fprintf(out, "char *%s = \"%s\";\n", variable_name, escape_string(lexer->string));
+            case KW_if:
+                stmt = parse_if(lexer, ast, func_name);
                 break;
-            case CLEX_id:
-                if (strcmp(lexer->string, "false") == 0 || strcmp(lexer->string, "true") == 0) {
-                    fprintf(out, "bool %s = %s;\n", variable_name, lexer->string);
-                } else if (strcmp(lexer->string, "null") == 0) {
-                    fprintf(out, "int *%s = NULL;\n", variable_name);
-                } else {
-                    fprintf(out, "int %s = ", variable_name);
-                    parse_call(lexer, out);
+            case KW_while:
+                stmt = parse_while(lexer, ast, func_name);
+                break;
+            case KW_for:
+                stmt = parse_for(lexer, ast, func_name);
+                break;
+            case KW_simd:
+            case KW_parallel: {
+                const char *word = lexer->token == KW_simd ? "simd" : "parallel";
+                int flag = lexer->token == KW_simd ? NODE_SIMD : NODE_PARALLEL;
+                if (!lex_next(lexer) || lexer->token != KW_for) {
+                    PRINT_ERR("expected 'for' after '%s' in function '%s'\n", word, sym_str(func_name));
+                    return 0;
                 }
+                stmt = parse_for(lexer, ast, func_name);
+                if (stmt) AST_NODE(ast, stmt)->flags |= flag;
                 break;
-            default:
+            }
+            case KW_spawn:
+                stmt = parse_spawn(lexer, ast);
+                break;
+            case KW_sync:
+                stmt = ast_new(ast, NODE_SYNC);
                 break;
+            case KW_break:
+            case KW_continue:
+                stmt = ast_new(ast, lexer->token == KW_break ? NODE_BREAK : NODE_CONTINUE);
+                break;
+            case CLEX_id:
+                stmt = parse_call_or_assign(lexer, ast);
+                break;
+            default:
+                PRINT_ERR("expected a statement in function '%s', got '%s'\n", sym_str(func_name), lexer->string);
+                return 0;
         }
-    } else {
+        if (!stmt) return 0;
+        ast_append(ast, block, &last, stmt);
+    }
+}
+
+NodeId parse_function(struct Lexer *lexer, struct Ast *ast) {
+    // expect function name after 'fn'
+    if (!expect_clex(lexer, CLEX_id)) return 0;
+    NodeId func = ast_new(ast, NODE_FUNCTION);
+    Sym func_name = intern(lexer->string, lexer->string_len);
+    AST_NODE(ast, func)->name = func_name;
+
+    if (!parse_signature(lexer, ast, func)) return 0;
+
+    if (parse_block(lexer, ast, func, func_name, false) != KW_end) return 0;
+    return func;
+}
 
+NodeId parse_variable(struct Lexer *lexer, struct Ast *ast, bool global) {
+    if (!expect_clex(lexer, CLEX_id)) return 0;
+    NodeId var = ast_new(ast, NODE_VARIABLE);
+    AST_NODE(ast, var)->name = intern(lexer->string, lexer->string_len);
+    AST_NODE(ast, var)->flags = global ? NODE_GLOBAL : 0;
+    if (!expect_clex(lexer, '=')) return 0;
+    NodeId init = global ? parse_expression(lexer, ast) : parse_value(lexer, ast);
+    if (!init) return 0;
+    AST_NODE(ast, var)->lhs = init;
+    return var;
+}
+
+// '(N)' after 'align': a power of two, in bytes.
+static bool parse_align(struct Lexer *lexer, NodeId *align) {
+    if (!expect_clex(lexer, '(') || !expect_clex(lexer, CLEX_intlit)) return false;
+    long n = lexer->int_number;
+    if (n <= 0 || n > 4096 || (n & (n - 1)) != 0) {
+        PRINT_ERR("align(%ld) is not a power of two up to 4096\n", n);
+        return false;
     }
+    *align = (NodeId)n;
+    return expect_clex(lexer, ')');
 }
 
-void parse_program(stb_lexer *lexer, FILE *out) {
-    while (stb_c_lexer_get_token(lexer)) {
-        if (lexer->token == CLEX_id) {
-            if (strcmp(lexer->string, "fn") == 0) parse_function(lexer, out);
-            if (strcmp(lexer->string, "gvar") == 0) parse_variable(lexer, out, true);
-            if (strcmp(lexer->string, "svar") == 0) parse_variable(lexer, out, false);
+// True after consuming 'align' when it is the next token.
+static bool at_align(struct Lexer *lexer) {
+    if (!lex_next(lexer)) return false;
+    if (lexer->token == CLEX_id && strcmp(lexer->string, "align") == 0) return true;
+    lex_unget(lexer);
+    return false;
+}
+
+// struct Name [align(N)], then 'field: type [align(N)]' up to 'end'. The
+// struct can be used as a type from here on.
+static NodeId parse_struct(struct Lexer *lexer, struct Ast *ast, bool soa) {
+    if (!expect_clex(lexer, CLEX_id)) return 0;
+    Sym name = intern(lexer->string, lexer->string_len);
+    if (ast_find_record(ast, name)) {
+        PRINT_ERR("struct '%s' is already defined\n", sym_str(name));
+        return 0;
+    }
+    NodeId decl = ast_new(ast, NODE_STRUCT);
+    AST_NODE(ast, decl)->name = name;
+    AST_NODE(ast, decl)->flags = soa ? NODE_SOA : 0;
+    NodeId align = 0;
+    if (at_align(lexer) && !parse_align(lexer, &align)) return 0;
+    AST_NODE(ast, decl)->rhs = align;
+
+    NodeId last = 0;
+    while (true) {
+        if (!lex_next(lexer)) {
+            PRINT_ERR("unexpected end of input in struct '%s'\n", sym_str(name));
+            return 0;
         }
+        if (lexer->token == KW_end) break;
+        if (lexer->token != CLEX_id) {
+            PRINT_ERR("expected a field name in struct '%s'\n", sym_str(name));
+            return 0;
+        }
+        Sym field_name = intern(lexer->string, lexer->string_len);
+        for (NodeId f = AST_NODE(ast, decl)->lhs; f; f = AST_NODE(ast, f)->next) {
+            if (AST_NODE(ast, f)->name == field_name) {
+                PRINT_ERR("struct '%s' has two fields named '%s'\n", sym_str(name), sym_str(field_name));
+                return 0;
+            }
+        }
+        if (!expect_clex(lexer, ':')) return 0;
+        uint8_t elem = TYPE_NONE;
+        uint16_t record = 0;
+        int type = parse_type(lexer, ast, &elem, &record);
+        if (type == TYPE_NONE) return 0;
+        if (type == TYPE_VEC || type == TYPE_MAP) {
+            PRINT_ERR("field '%s' of struct '%s' can't be a vec or map\n", sym_str(field_name), sym_str(name));
+            return 0;
+        }
+        align = 0;
+        if (at_align(lexer) && !parse_align(lexer, &align)) return 0;
+
+        NodeId field = ast_new(ast, NODE_FIELD);
+        struct Node *node = AST_NODE(ast, field);
+        node->name = field_name;
+        node->type = type;
+        node->elem = elem;
+        node->record = record;
+        node->rhs = align;
+        ast_append(ast, decl, &last, field);
+
+        if (lex_next(lexer) && lexer->token != ',') lex_unget(lexer);
     }
-}
\ No newline at end of file
+    if (!last) {
+        PRINT_ERR("struct '%s' has no fields\n", sym_str(name));
+        return 0;
+    }
+    if (!ast_add_record(ast, decl)) {
+        PRINT_ERR("too many structs in one module\n");
+        return 0;
+    }
+    return decl;
+}
+
+int parse_program(struct Lexer *lexer, struct Ast *ast) {
+    NodeId last = 0;
+    while (lex_next(lexer)) {
+        NodeId decl;
+        switch (lexer->token) {
+            case KW_fn:   decl = parse_function(lexer, ast); break;
+            case KW_inline:
+            case KW_noinline: {
+                int flag = lexer->token == KW_inline ? NODE_INLINE : NODE_NOINLINE;
+                if (!expect_clex(lexer, KW_fn)) {
+                    decl = 0;
+                    break;
+                }
+                decl = parse_function(lexer, ast);
+                if (decl) AST_NODE(ast, decl)->flags |= flag;
+                break;
+            }
+            case KW_gvar: decl = parse_variable(lexer, ast, true); break;
+            case KW_svar: decl = parse_variable(lexer, ast, false); break;
+            case KW_struct: decl = parse_struct(lexer, ast, false); break;
+            case KW_soa:
+                decl = expect_clex(lexer, KW_struct) ? parse_struct(lexer, ast, true) : 0;
+                break;
+            default: continue;
+        }
+
+        if (!decl) {
+            ast->error_count++;
+            continue;
+        }
+        if (last) {
+            AST_NODE(ast, last)->next = decl;
+        } else {
+            ast->first = decl;
+        }
+        last = decl;
+    }
+    return ast->error_count;
+}
@@ -1,8 +1,16 @@
 #ifndef CLEXER_H
 #define CLEXER_H
 
+#include <stdbool.h>
+
+#include "lexer.h"
+#include "ast.h"
+
 extern int float_pc;
 extern int str_pc;
 extern bool write_code;
-extern int func_countextern ;
-#endif // CLEXER_H
\ No newline at end of file
+
+// Parses the whole token stream into `ast`, returns the number of errors.
+int parse_program(struct Lexer *lexer, struct Ast *ast);
+
+#endif // CLEXER_H
@@ -0,0 +1,11 @@
+#ifndef COMMON_H
+#define COMMON_H
+
+#include <stdio.h>
+
+#define GART_VERSION "0.1.0"
+
+#define PRINT_ERR(fmt, ...) { printf("\x1b[1;31m"); printf("Error: "); printf("\x1b[0m"); printf(fmt, ##__VA_ARGS__); }
+#define PRINT_ERR2(fmt, ...) printf("\x1b[1;31m"); printf("Error: "); printf("\x1b[0m"); printf(fmt, ##__VA_ARGS__);
+
+#endif // COMMON_H
@@ -0,0 +1,341 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dce.h"
+#include "hash.h"
+
+static void *xrealloc(void *ptr, size_t size) {
+    ptr = realloc(ptr, size);
+    if (!ptr) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    return ptr;
+}
+
+void summary_add_fn(struct Summary *summary, Sym name, int type, int elem) {
+    if (summary->fn_count == summary->fn_cap) {
+        summary->fn_cap = summary->fn_cap ? summary->fn_cap * 2 : 16;
+        summary->fns = xrealloc(summary->fns, summary->fn_cap * sizeof(struct FnSummary));
+    }
+    struct FnSummary *fn = &summary->fns[summary->fn_count++];
+    fn->name = name;
+    fn->type = type;
+    fn->elem = elem;
+    fn->first_call = summary->call_count;
+    fn->call_count = 0;
+}
+
+void summary_add_call(struct Summary *summary, Sym callee) {
+    if (summary->call_count == summary->call_cap) {
+        summary->call_cap = summary->call_cap ? summary->call_cap * 2 : 64;
+        summary->calls = xrealloc(summary->calls, summary->call_cap * sizeof(Sym));
+    }
+    summary->calls[summary->call_count++] = callee;
+    summary->fns[summary->fn_count - 1].call_count++;
+}
+
+void summary_free(struct Summary *summary) {
+    free(summary->fns);
+    free(summary->calls);
+    memset(summary, 0, sizeof(*summary));
+}
+
+void summary_copy(struct Summary *dst, const struct Summary *src) {
+    memset(dst, 0, sizeof(*dst));
+    for (uint32_t i = 0; i < src->fn_count; i++) {
+        const struct FnSummary *fn = &src->fns[i];
+        summary_add_fn(dst, fn->name, fn->type, fn->elem);
+        for (uint32_t c = 0; c < fn->call_count; c++) {
+            summary_add_call(dst, src->calls[fn->first_call + c]);
+        }
+    }
+}
+
+static void add_call(struct Summary *summary, struct Scope *seen, Sym name) {
+    if (scope_define(seen, name, SYMBOL_FUNCTION, 0)) summary_add_call(summary, name);
+}
+
+// Whether `id` may name a function: one of this module, or a name that
+// doesn't resolve here, which may be a function of another module.
+static bool names_function(struct Ast *ast, NodeId id) {
+    struct Node *node = AST_NODE(ast, id);
+    return node->kind == NODE_FUNC_REF || (node->kind == NODE_IDENT && !node->rhs);
+}
+
+// Every name called inside the expression `id`, or whose address it
+// takes, each recorded once per function.
+static void collect_calls(struct Ast *ast, NodeId id, struct Summary *summary, struct Scope *seen) {
+    struct Node *node = AST_NODE(ast, id);
+    switch (node->kind) {
+        case NODE_IDENT:
+            if (names_function(ast, id)) {
+                add_call(summary, seen, node->name);
+            } else if (AST_NODE(ast, node->rhs)->lhs && names_function(ast, AST_NODE(ast, node->rhs)->lhs)) {
+                // a variable holding a function, which may be module-level
+                add_call(summary, seen, AST_NODE(ast, AST_NODE(ast, node->rhs)->lhs)->name);
+            }
+            break;
+        case NODE_FUNC_REF:
+            add_call(summary, seen, node->name);
+            break;
+        case NODE_CALL:
+            add_call(summary, seen, node->name);
+            for (NodeId arg = node->lhs; arg; arg = AST_NODE(ast, arg)->next) {
+                collect_calls(ast, arg, summary, seen);
+            }
+            break;
+        case NODE_UNARY:
+        case NODE_CAST:
+        case NODE_LEN:
+        case NODE_ARRAY_NEW:
+        case NODE_MEMBER:
+            collect_calls(ast, node->lhs, summary, seen);
+            break;
+        case NODE_BINARY:
+        case NODE_INDEX:
+            collect_calls(ast, node->lhs, summary, seen);
+            collect_calls(ast, node->rhs, summary, seen);
+            break;
+        case NODE_SLICE:
+            collect_calls(ast, node->lhs, summary, seen);
+            collect_calls(ast, node->rhs, summary, seen);
+            if (node->alt) collect_calls(ast, node->alt, summary, seen);
+            break;
+        case NODE_ARRAY:
+        case NODE_CONSTRUCT:
+            for (NodeId element = node->lhs; element; element = AST_NODE(ast, element)->next) {
+                collect_calls(ast, element, summary, seen);
+            }
+            break;
+    }
+}
+
+static void collect_statements(struct Ast *ast, NodeId first, struct Summary *summary, struct Scope *seen) {
+    for (NodeId stmt = first; stmt; stmt = AST_NODE(ast, stmt)->next) {
+        struct Node *node = AST_NODE(ast, stmt);
+        switch (node->kind) {
+            case NODE_CALL:
+                collect_calls(ast, stmt, summary, seen);
+                break;
+            case NODE_VARIABLE:
+            case NODE_RETURN:
+                if (node->lhs) collect_calls(ast, node->lhs, summary, seen);
+                break;
+            case NODE_ASSIGN:
+                collect_calls(ast, node->lhs, summary, seen);
+                collect_calls(ast, node->rhs, summary, seen);
+                break;
+            case NODE_BLOCK:
+                collect_statements(ast, node->lhs, summary, seen);
+                break;
+            case NODE_IF:
+            case NODE_WHILE:
+                collect_calls(ast, node->lhs, summary, seen);
+                collect_statements(ast, AST_NODE(ast, stmt)->rhs, summary, seen);
+                // an elif is an if alone in the else branch, it has no next
+                if (AST_NODE(ast, stmt)->kind == NODE_IF && AST_NODE(ast, stmt)->alt) {
+                    collect_statements(ast, AST_NODE(ast, stmt)->alt, summary, seen);
+                }
+                break;
+            case NODE_FOR:
+                collect_calls(ast, AST_NODE(ast, node->lhs)->lhs, summary, seen);
+                for (NodeId bound = AST_NODE(ast, stmt)->alt; bound; bound = AST_NODE(ast, bound)->next) {
+                    collect_calls(ast, bound, summary, seen);
+                }
+                collect_statements(ast, AST_NODE(ast, stmt)->rhs, summary, seen);
+                break;
+        }
+    }
+}
+
+// Module-level initializers are constants in C, so only function bodies
+// can call anything; a variable holding a function is followed where a
+// function uses it.
+void summary_build(struct Summary *summary, struct Ast *ast) {
+    memset(summary, 0, sizeof(*summary));
+    for (NodeId decl = ast->first; decl; decl = AST_NODE(ast, decl)->next) {
+        if (AST_NODE(ast, decl)->kind != NODE_FUNCTION) continue;
+        struct Node *func = AST_NODE(ast, decl);
+        summary_add_fn(summary, func->name, func->type, func->elem);
+
+        struct Scope seen;
+        scope_init(&seen, NULL);
+        collect_statements(ast, AST_NODE(ast, decl)->lhs, summary, &seen);
+        scope_free(&seen);
+    }
+}
+
+// Functions are numbered across the program as (module, index) packed
+// into the symbol table's decl field.
+#define FN_ID(module, index) (((uint32_t)(module) << 20) | (uint32_t)(index))
+#define FN_MODULE(id)        ((id) >> 20)
+#define FN_INDEX(id)         ((id) & 0xfffff)
+
+void dce_reachable(const struct Summary **summaries, int count, bool **live) {
+    // names are unique across modules, which main checks first
+    struct Scope functions;
+    scope_init(&functions, NULL);
+    for (int m = 0; m < count; m++) {
+        for (uint32_t f = 0; f < summaries[m]->fn_count; f++) {
+            scope_define(&functions, summaries[m]->fns[f].name, SYMBOL_FUNCTION, FN_ID(m, f));
+        }
+    }
+
+    struct Symbol *root = scope_lookup(&functions, sym_main);
+    if (!root) {
+        for (int m = 0; m < count; m++) {
+            memset(live[m], 1, summaries[m]->fn_count * sizeof(bool));
+        }
+        scope_free(&functions);
+        return;
+    }
+
+    uint32_t *work = malloc((functions.count + 1) * sizeof(uint32_t));
+    int top = 0;
+    work[top++] = root->decl;
+    live[FN_MODULE(root->decl)][FN_INDEX(root->decl)] = true;
+    while (top > 0) {
+        uint32_t id = work[--top];
+        const struct Summary *summary = summaries[FN_MODULE(id)];
+        const struct FnSummary *fn = &summary->fns[FN_INDEX(id)];
+        for (uint32_t c = 0; c < fn->call_count; c++) {
+            // names defined nowhere are libc's
+            struct Symbol *callee = scope_lookup(&functions, summary->calls[fn->first_call + c]);
+            if (!callee || live[FN_MODULE(callee->decl)][FN_INDEX(callee->decl)]) continue;
+            live[FN_MODULE(callee->decl)][FN_INDEX(callee->decl)] = true;
+            work[top++] = callee->decl;
+        }
+    }
+
+    free(work);
+    scope_free(&functions);
+}
+
+uint64_t dce_live_hash(const struct Summary *summary, const bool *live) {
+    uint64_t hash = summary->fn_count;
+    for (uint32_t f = 0; f < summary->fn_count; f++) {
+        hash = hash_combine(hash, live[f]);
+    }
+    return hash;
+}
+
+struct Marks {
+    struct Ast *ast;
+    bool       *used;   // per node, for variable declarations
+    NodeId     *work;   // used variables whose initializer isn't walked yet
+    uint32_t    top;
+};
+
+static void mark_used(struct Marks *m, NodeId id) {
+    struct Node *node = AST_NODE(m->ast, id);
+    switch (node->kind) {
+        case NODE_IDENT:
+            if (node->rhs && !m->used[node->rhs]) {
+                m->used[node->rhs] = true;
+                m->work[m->top++] = node->rhs;
+            }
+            break;
+        case NODE_CALL:
+            for (NodeId arg = node->lhs; arg; arg = AST_NODE(m->ast, arg)->next) {
+                mark_used(m, arg);
+            }
+            break;
+        case NODE_UNARY:
+        case NODE_CAST:
+        case NODE_LEN:
+        case NODE_ARRAY_NEW:
+        case NODE_MEMBER:
+            mark_used(m, node->lhs);
+            break;
+        case NODE_BINARY:
+        case NODE_INDEX:
+            mark_used(m, node->lhs);
+            mark_used(m, node->rhs);
+            break;
+        case NODE_SLICE:
+            mark_used(m, node->lhs);
+            mark_used(m, node->rhs);
+            if (node->alt) mark_used(m, node->alt);
+            break;
+        case NODE_ARRAY:
+        case NODE_CONSTRUCT:
+            for (NodeId element = node->lhs; element; element = AST_NODE(m->ast, element)->next) {
+                mark_used(m, element);
+            }
+            break;
+    }
+}
+
+static void mark_statements(struct Marks *m, NodeId first) {
+    struct Ast *ast = m->ast;
+    for (NodeId stmt = first; stmt; stmt = AST_NODE(ast, stmt)->next) {
+        struct Node *node = AST_NODE(ast, stmt);
+        switch (node->kind) {
+            case NODE_CALL:
+                mark_used(m, stmt);
+                break;
+            case NODE_VARIABLE:
+            case NODE_RETURN:
+                if (node->lhs) mark_used(m, node->lhs);
+                break;
+            case NODE_ASSIGN:
+                mark_used(m, node->lhs);
+                mark_used(m, node->rhs);
+                break;
+            case NODE_BLOCK:
+                mark_statements(m, node->lhs);
+                break;
+            case NODE_IF:
+            case NODE_WHILE:
+                mark_used(m, node->lhs);
+                mark_statements(m, node->rhs);
+                if (node->kind == NODE_IF && node->alt) mark_statements(m, node->alt);
+                break;
+            case NODE_FOR:
+                mark_used(m, AST_NODE(ast, node->lhs)->lhs);
+                for (NodeId bound = node->alt; bound; bound = AST_NODE(ast, bound)->next) {
+                    mark_used(m, bound);
+                }
+                mark_statements(m, node->rhs);
+                break;
+        }
+    }
+}
+
+void dce_apply(struct Ast *ast, const bool *live) {
+    struct Marks m = { .ast = ast };
+    m.used = calloc(ast->node_count, sizeof(bool));
+    m.work = malloc(ast->node_count * sizeof(NodeId));
+    if (!m.used || !m.work) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    uint32_t f = 0;
+    for (NodeId decl = ast->first; decl; decl = AST_NODE(ast, decl)->next) {
+        struct Node *func = AST_NODE(ast, decl);
+        if (func->kind != NODE_FUNCTION) continue;
+        if (!live[f++]) {
+            func->flags |= NODE_DEAD;
+            continue;
+        }
+        mark_statements(&m, func->lhs);
+    }
+
+    // whatever a used variable's initializer refers to is used as well
+    while (m.top > 0) {
+        NodeId var = m.work[--m.top];
+        if (AST_NODE(ast, var)->lhs) mark_used(&m, AST_NODE(ast, var)->lhs);
+    }
+
+    for (NodeId decl = ast->first; decl; decl = AST_NODE(ast, decl)->next) {
+        if (AST_NODE(ast, decl)->kind == NODE_VARIABLE && !m.used[decl]) {
+            AST_NODE(ast, decl)->flags |= NODE_DEAD;
+        }
+    }
+
+    free(m.work);
+    free(m.used);
+}
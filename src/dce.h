@@ -0,0 +1,46 @@
+#ifndef DCE_H
+#define DCE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ast.h"
+
+// What a module's functions return and call, by name. It is all the whole-program
+// reachability needs to know about a module, so it is kept in the build
+// cache and unchanged modules don't have to be parsed to take part.
+struct FnSummary {
+    Sym      name;
+    uint8_t  type;          // return type
+    uint8_t  elem;          // element type of a returned slice
+    uint32_t first_call;    // into Summary.calls
+    uint32_t call_count;
+};
+
+struct Summary {
+    struct FnSummary *fns;      // in declaration order
+    uint32_t          fn_count;
+    uint32_t          fn_cap;
+    Sym              *calls;
+    uint32_t          call_count;
+    uint32_t          call_cap;
+};
+
+void summary_build(struct Summary *summary, struct Ast *ast);
+void summary_free(struct Summary *summary);
+void summary_copy(struct Summary *dst, const struct Summary *src);
+void summary_add_fn(struct Summary *summary, Sym name, int type, int elem);
+void summary_add_call(struct Summary *summary, Sym callee);
+
+// Marks live[m][f] for every function reachable from main across all
+// modules. Without a main anywhere, everything is kept.
+void dce_reachable(const struct Summary **summaries, int count, bool **live);
+
+// Identifies a module's live set, to tell when its output must change.
+uint64_t dce_live_hash(const struct Summary *summary, const bool *live);
+
+// Flags the module's dead functions, and the module-level variables only
+// they (or nothing) use, NODE_DEAD so the backend skips them.
+void dce_apply(struct Ast *ast, const bool *live);
+
+#endif // DCE_H
@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "common.h"
+#include "driver.h"
+
+#if defined(_WIN32)
+    #include <process.h>
+#else
+    #include <spawn.h>
+    #include <sys/wait.h>
+    extern char **environ;
+#endif
+
+struct ArgList {
+    const char **items;
+    int count;
+    int cap;
+};
+
+static void args_push(struct ArgList *args, const char *arg) {
+    if (args->count + 1 >= args->cap) {
+        args->cap = args->cap ? args->cap * 2 : 16;
+        args->items = realloc(args->items, args->cap * sizeof(char *));
+    }
+    args->items[args->count++] = arg;
+    args->items[args->count] = NULL;
+}
+
+static void push_flags(const char ***list, int *count, const char *flag) {
+    *list = realloc(*list, (*count + 1) * sizeof(char *));
+    (*list)[(*count)++] = flag;
+}
+
+void cc_options_init(struct CcOptions *opts) {
+    memset(opts, 0, sizeof(*opts));
+    opts->cc = "gcc";
+    opts->jobs = 1;
+}
+
+void cc_add_flag(struct CcOptions *opts, const char *flag) {
+    push_flags(&opts->flags, &opts->flag_count, flag);
+}
+
+void cc_add_ldflag(struct CcOptions *opts, const char *flag) {
+    push_flags(&opts->ldflags, &opts->ldflag_count, flag);
+}
+
+static void print_command(const char **argv) {
+    for (int i = 0; argv[i]; i++) {
+        printf(i ? " %s" : "%s", argv[i]);
+    }
+    printf("\n");
+}
+
+// Starts argv[0] searching PATH; returns the process handle or -1.
+static intptr_t proc_spawn(const char **argv) {
+#if defined(_WIN32)
+    return _spawnvp(_P_NOWAIT, argv[0], argv);
+#else
+    pid_t pid;
+    int err = posix_spawnp(&pid, argv[0], NULL, NULL, (char *const *)argv, environ);
+    if (err != 0) {
+        PRINT_ERR("failed to start '%s': %s\n", argv[0], strerror(err));
+        return -1;
+    }
+    return pid;
+#endif
+}
+
+// Waits for one of the running processes, returns its slot and exit status.
+static int proc_wait_any(const intptr_t *procs, int count, int *status) {
+#if defined(_WIN32)
+    // no portable wait-any, so reap in start order
+    for (int i = 0; i < count; i++) {
+        if (procs[i] == -1) continue;
+        int code = 0;
+        if (_cwait(&code, procs[i], _WAIT_CHILD) == -1) code = -1;
+        *status = code;
+        return i;
+    }
+    return -1;
+#else
+    for (;;) {
+        int wstatus;
+        pid_t pid = waitpid(-1, &wstatus, 0);
+        if (pid == -1) return -1;
+        for (int i = 0; i < count; i++) {
+            if (procs[i] == pid) {
+                if (WIFEXITED(wstatus)) {
+                    *status = WEXITSTATUS(wstatus);
+                } else {
+                    *status = 128 + (WIFSIGNALED(wstatus) ? WTERMSIG(wstatus) : 0);
+                }
+                return i;
+            }
+        }
+    }
+#endif
+}
+
+// Runs every command, at most `jobs` at once. Stops starting new commands
+// after the first failure but still reaps the ones already running.
+static int run_commands(const struct CcOptions *opts, struct ArgList *commands, int count) {
+    int jobs = opts->jobs > 0 ? opts->jobs : 1;
+    intptr_t *running = malloc(jobs * sizeof(intptr_t));
+    int *owner = malloc(jobs * sizeof(int));
+    for (int i = 0; i < jobs; i++) running[i] = -1;
+
+    int next = 0, active = 0, failed = 0;
+    while (next < count || active > 0) {
+        while (!failed && next < count && active < jobs) {
+            int slot = 0;
+            while (running[slot] != -1) slot++;
+            if (opts->verbose) print_command(commands[next].items);
+            running[slot] = proc_spawn(commands[next].items);
+            if (running[slot] == -1) {
+                failed = 1;
+                break;
+            }
+            owner[slot] = next++;
+            active++;
+        }
+        if (active == 0) break;
+
+        int status = 0;
+        int slot = proc_wait_any(running, jobs, &status);
+        if (slot < 0) {
+            PRINT_ERR("lost track of child processes\n");
+            failed = 1;
+            break;
+        }
+        if (status != 0) {
+            PRINT_ERR("'%s' exited with status %d\n", commands[owner[slot]].items[0], status);
+            failed = 1;
+        }
+        running[slot] = -1;
+        active--;
+    }
+
+    free(running);
+    free(owner);
+    return failed;
+}
+
+int cc_compile(const struct CcOptions *opts, const char **sources, const char **objects, int count) {
+    struct ArgList *commands = calloc(count ? count : 1, sizeof(struct ArgList));
+    for (int i = 0; i < count; i++) {
+        args_push(&commands[i], opts->cc);
+        for (int f = 0; f < opts->flag_count; f++) args_push(&commands[i], opts->flags[f]);
+        args_push(&commands[i], "-c");
+        args_push(&commands[i], sources[i]);
+        args_push(&commands[i], "-o");
+        args_push(&commands[i], objects[i]);
+    }
+
+    int result = run_commands(opts, commands, count);
+
+    for (int i = 0; i < count; i++) free(commands[i].items);
+    free(commands);
+    return result;
+}
+
+int cc_link(const struct CcOptions *opts, const char **objects, int count, const char *exe) {
+    struct ArgList command = {0};
+    args_push(&command, opts->cc);
+    for (int f = 0; f < opts->flag_count; f++) args_push(&command, opts->flags[f]);
+    for (int i = 0; i < count; i++) args_push(&command, objects[i]);
+    for (int f = 0; f < opts->ldflag_count; f++) args_push(&command, opts->ldflags[f]);
+    args_push(&command, "-o");
+    args_push(&command, exe);
+
+    int result = run_commands(opts, &command, 1);
+    free(command.items);
+    return result;
+}
@@ -0,0 +1,26 @@
+#ifndef DRIVER_H
+#define DRIVER_H
+
+#include <stdbool.h>
+
+// Drives the backend C compiler. Commands are spawned directly (no shell)
+// and up to `jobs` of them run at the same time.
+struct CcOptions {
+    const char  *cc;
+    const char **flags;     // passed to every compile and to the link
+    int          flag_count;
+    const char **ldflags;   // link only
+    int          ldflag_count;
+    int          jobs;
+    bool         verbose;
+};
+
+void cc_options_init(struct CcOptions *opts);
+void cc_add_flag(struct CcOptions *opts, const char *flag);
+void cc_add_ldflag(struct CcOptions *opts, const char *flag);
+
+// Compiles sources[i] to objects[i]; returns 0 when every compile succeeded.
+int cc_compile(const struct CcOptions *opts, const char **sources, const char **objects, int count);
+int cc_link(const struct CcOptions *opts, const char **objects, int count, const char *exe);
+
+#endif // DRIVER_H
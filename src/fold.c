@@ -0,0 +1,398 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdbool.h>
+
+#include "common.h"
+#include "fold.h"
+
+enum {
+    VAR_UNSEEN,
+    VAR_FOLDING,
+    VAR_DONE,
+};
+
+struct Folder {
+    struct Ast *ast;
+    uint8_t    *var_state;  // per node, for variable declarations
+    int         errors;
+};
+
+static bool is_literal(const struct Node *node) {
+    switch (node->kind) {
+        case NODE_INT:
+        case NODE_FLOAT:
+        case NODE_STRING:
+        case NODE_BOOL:
+        case NODE_NULL:
+            return true;
+    }
+    return false;
+}
+
+static bool is_number(const struct Node *node) {
+    return node->kind == NODE_INT || node->kind == NODE_FLOAT || node->kind == NODE_BOOL;
+}
+
+static bool truthy(const struct Node *node) {
+    switch (node->kind) {
+        case NODE_FLOAT:  return node->float_value != 0.0;
+        case NODE_STRING: return true;
+        case NODE_NULL:   return false;
+    }
+    return node->int_value != 0;
+}
+
+static double as_double(const struct Node *node) {
+    return node->kind == NODE_FLOAT ? node->float_value : (double)node->int_value;
+}
+
+// Turns `node` into a literal in place; it keeps its place in its list.
+static void set_int(struct Node *node, int kind, long value) {
+    NodeId next = node->next;
+    memset(node, 0, sizeof(*node));
+    node->kind = kind;
+    node->next = next;
+    node->int_value = value;
+}
+
+static void set_float(struct Node *node, double value) {
+    set_int(node, NODE_FLOAT, 0);
+    node->float_value = value;
+}
+
+static void set_string(struct Node *node, Sym str) {
+    set_int(node, NODE_STRING, 0);
+    node->str = str;
+}
+
+static void fold_value(struct Folder *f, NodeId id);
+
+static void fold_variable(struct Folder *f, NodeId decl) {
+    // a cycle through initializers is left for the C compiler to report
+    if (f->var_state[decl] != VAR_UNSEEN) return;
+    f->var_state[decl] = VAR_FOLDING;
+    if (AST_NODE(f->ast, decl)->lhs) fold_value(f, AST_NODE(f->ast, decl)->lhs);
+    f->var_state[decl] = VAR_DONE;
+}
+
+// A variable never assigned after its declaration whose initializer is
+// a literal always holds that literal, and is typed to hold it exactly.
+static void propagate(struct Folder *f, struct Node *use) {
+    fold_variable(f, use->rhs);
+    if (AST_NODE(f->ast, use->rhs)->flags & NODE_ASSIGNED) return;
+    NodeId init = AST_NODE(f->ast, use->rhs)->lhs;
+    if (!init || !is_literal(AST_NODE(f->ast, init))) return;
+
+    NodeId next = use->next;
+    *use = *AST_NODE(f->ast, init);
+    use->next = next;
+}
+
+static void fold_unary(struct Node *node, const struct Node *operand) {
+    switch (node->op) {
+        case OP_NOT:
+            set_int(node, NODE_BOOL, !truthy(operand));
+            break;
+        case OP_NEG:
+            if (operand->kind == NODE_FLOAT) {
+                set_float(node, -operand->float_value);
+            } else if (is_number(operand)) {
+                set_int(node, NODE_INT, (long)(0UL - (unsigned long)operand->int_value));
+            }
+            break;
+        case OP_BITNOT:
+            if (operand->kind == NODE_INT || operand->kind == NODE_BOOL) {
+                set_int(node, NODE_INT, ~operand->int_value);
+            }
+            break;
+    }
+}
+
+// Conversions C defines for a constant; out of range float to integer
+// conversions are left alone.
+static void fold_cast(struct Node *node, const struct Node *operand) {
+    switch (node->type) {
+        case TYPE_INT:
+        case TYPE_INT64: {
+            bool narrow = node->type == TYPE_INT;
+            if (operand->kind == NODE_FLOAT) {
+                double v = operand->float_value;
+                bool fits = narrow ? v > -2147483649.0 && v < 2147483648.0
+                                   : v >= -9223372036854775808.0 && v < 9223372036854775808.0;
+                if (fits) set_int(node, NODE_INT, (long)v);
+            } else if (is_number(operand)) {
+                long v = operand->int_value;
+                set_int(node, NODE_INT, narrow ? (int)v : v);
+            }
+            break;
+        }
+        case TYPE_FLOAT:
+            if (is_number(operand)) set_float(node, (float)as_double(operand));
+            break;
+        case TYPE_DOUBLE:
+            if (is_number(operand)) set_float(node, as_double(operand));
+            break;
+        case TYPE_BOOL:
+            set_int(node, NODE_BOOL, truthy(operand));
+            break;
+        case TYPE_STR:
+        case TYPE_POINTER:
+            // a null string is still a string, made from C's NULL
+            if (operand->kind == NODE_NULL && node->type == TYPE_POINTER) {
+                set_int(node, NODE_NULL, 0);
+            } else if (operand->kind == NODE_STRING && node->type == TYPE_STR) {
+                set_string(node, operand->str);
+            }
+            break;
+    }
+}
+
+static void fold_float_binary(struct Node *node, double a, double b) {
+    switch (node->op) {
+        case OP_MUL: set_float(node, a * b); break;
+        case OP_DIV: set_float(node, a / b); break;
+        case OP_ADD: set_float(node, a + b); break;
+        case OP_SUB: set_float(node, a - b); break;
+        case OP_LT:  set_int(node, NODE_BOOL, a < b); break;
+        case OP_LE:  set_int(node, NODE_BOOL, a <= b); break;
+        case OP_GT:  set_int(node, NODE_BOOL, a > b); break;
+        case OP_GE:  set_int(node, NODE_BOOL, a >= b); break;
+        case OP_EQ:  set_int(node, NODE_BOOL, a == b); break;
+        case OP_NE:  set_int(node, NODE_BOOL, a != b); break;
+        // %, shifts and bit operations on floats are left for C to reject
+    }
+}
+
+// Integers are 64 bit and wrap; anything C leaves undefined (division by
+// zero, oversized shifts) is left unfolded.
+static void fold_int_binary(struct Node *node, long a, long b) {
+    unsigned long ua = a, ub = b;
+    switch (node->op) {
+        case OP_MUL: set_int(node, NODE_INT, (long)(ua * ub)); break;
+        case OP_ADD: set_int(node, NODE_INT, (long)(ua + ub)); break;
+        case OP_SUB: set_int(node, NODE_INT, (long)(ua - ub)); break;
+        case OP_DIV:
+        case OP_MOD:
+            if (b == 0 || (a == LONG_MIN && b == -1)) break;
+            set_int(node, NODE_INT, node->op == OP_DIV ? a / b : a % b);
+            break;
+        case OP_SHL:
+        case OP_SHR:
+            if (b < 0 || b >= 64) break;
+            set_int(node, NODE_INT, node->op == OP_SHL ? (long)(ua << b) : a >> b);
+            break;
+        case OP_LT:     set_int(node, NODE_BOOL, a < b); break;
+        case OP_LE:     set_int(node, NODE_BOOL, a <= b); break;
+        case OP_GT:     set_int(node, NODE_BOOL, a > b); break;
+        case OP_GE:     set_int(node, NODE_BOOL, a >= b); break;
+        case OP_EQ:     set_int(node, NODE_BOOL, a == b); break;
+        case OP_NE:     set_int(node, NODE_BOOL, a != b); break;
+        case OP_BITAND: set_int(node, NODE_INT, a & b); break;
+        case OP_BITXOR: set_int(node, NODE_INT, a ^ b); break;
+        case OP_BITOR:  set_int(node, NODE_INT, a | b); break;
+    }
+}
+
+static void fold_binary(struct Folder *f, struct Node *node) {
+    struct Node *lhs = AST_NODE(f->ast, node->lhs);
+    struct Node *rhs = AST_NODE(f->ast, node->rhs);
+
+    // the right operand is never evaluated once the left decides
+    if ((node->op == OP_AND || node->op == OP_OR) && is_literal(lhs)) {
+        bool left = truthy(lhs);
+        if (node->op == OP_AND ? !left : left) {
+            set_int(node, NODE_BOOL, left);
+        } else if (is_literal(rhs)) {
+            set_int(node, NODE_BOOL, truthy(rhs));
+        }
+        return;
+    }
+
+    if (lhs->kind == NODE_STRING || rhs->kind == NODE_STRING) {
+        // the rest is joined and compared at run time
+        if (lhs->kind != NODE_STRING || rhs->kind != NODE_STRING) return;
+        if (node->op == OP_EQ || node->op == OP_NE) {
+            set_int(node, NODE_BOOL, (lhs->str == rhs->str) == (node->op == OP_EQ));
+            return;
+        }
+        if (node->op != OP_ADD) return;
+        size_t a = sym_len(lhs->str), b = sym_len(rhs->str);
+        char *joined = malloc(a + b + 1);
+        if (!joined) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        memcpy(joined, sym_str(lhs->str), a);
+        memcpy(joined + a, sym_str(rhs->str), b);
+        set_string(node, intern(joined, a + b));
+        free(joined);
+        return;
+    }
+
+    if (!is_number(lhs) || !is_number(rhs)) return;
+    if (lhs->kind == NODE_FLOAT || rhs->kind == NODE_FLOAT) {
+        fold_float_binary(node, as_double(lhs), as_double(rhs));
+    } else {
+        fold_int_binary(node, lhs->int_value, rhs->int_value);
+    }
+}
+
+static void fold_value(struct Folder *f, NodeId id) {
+    struct Node *node = AST_NODE(f->ast, id);
+    switch (node->kind) {
+        case NODE_IDENT:
+            if (node->rhs) propagate(f, node);
+            break;
+        case NODE_CALL:
+            for (NodeId arg = node->lhs; arg; arg = AST_NODE(f->ast, arg)->next) {
+                fold_value(f, arg);
+            }
+            break;
+        case NODE_UNARY:
+            fold_value(f, node->lhs);
+            if (is_literal(AST_NODE(f->ast, node->lhs))) {
+                fold_unary(node, AST_NODE(f->ast, node->lhs));
+            }
+            break;
+        case NODE_BINARY:
+            fold_value(f, node->lhs);
+            fold_value(f, node->rhs);
+            fold_binary(f, node);
+            break;
+        case NODE_CAST:
+            fold_value(f, node->lhs);
+            if (is_literal(AST_NODE(f->ast, node->lhs))) {
+                fold_cast(node, AST_NODE(f->ast, node->lhs));
+            }
+            break;
+        case NODE_INDEX:
+            fold_value(f, node->lhs);
+            fold_value(f, AST_NODE(f->ast, id)->rhs);
+            break;
+        case NODE_SLICE:
+            fold_value(f, node->lhs);
+            fold_value(f, AST_NODE(f->ast, id)->rhs);
+            if (AST_NODE(f->ast, id)->alt) fold_value(f, AST_NODE(f->ast, id)->alt);
+            break;
+        case NODE_ARRAY:
+        case NODE_CONSTRUCT:
+            for (NodeId element = node->lhs; element; element = AST_NODE(f->ast, element)->next) {
+                fold_value(f, element);
+            }
+            break;
+        case NODE_MEMBER:
+            fold_value(f, node->lhs);
+            break;
+        case NODE_ARRAY_NEW: {
+            fold_value(f, node->lhs);
+            struct Node *len = AST_NODE(f->ast, AST_NODE(f->ast, id)->lhs);
+            if (len->kind == NODE_INT && len->int_value < 0) {
+                PRINT_ERR("%s %ld is negative\n", AST_NODE(f->ast, id)->type == TYPE_VEC || AST_NODE(f->ast, id)->type == TYPE_MAP
+                          ? "reserve" : "array length", len->int_value);
+                f->errors++;
+            }
+            break;
+        }
+        case NODE_LEN: {
+            fold_value(f, node->lhs);
+            long len;
+            struct Node *of = AST_NODE(f->ast, AST_NODE(f->ast, id)->lhs);
+            if (of->kind == NODE_STRING) {
+                set_int(AST_NODE(f->ast, id), NODE_INT, sym_len(of->str));
+            } else if (ast_array_length(f->ast, AST_NODE(f->ast, id)->lhs, &len)) {
+                set_int(AST_NODE(f->ast, id), NODE_INT, len);
+            }
+            break;
+        }
+    }
+}
+
+// Puts statement `src` (or nothing) in the place of `dst` in its list.
+static void replace_statement(struct Ast *ast, NodeId dst, NodeId src) {
+    NodeId next = AST_NODE(ast, dst)->next;
+    if (src) {
+        *AST_NODE(ast, dst) = *AST_NODE(ast, src);
+    } else {
+        memset(AST_NODE(ast, dst), 0, sizeof(struct Node));
+    }
+    AST_NODE(ast, dst)->next = next;
+}
+
+static void fold_statements(struct Folder *f, NodeId first) {
+    struct Ast *ast = f->ast;
+    NodeId stmt = first;
+    while (stmt) {
+        struct Node *s = AST_NODE(ast, stmt);
+        switch (s->kind) {
+            case NODE_VARIABLE:
+                fold_variable(f, stmt);
+                break;
+            case NODE_CALL:
+                fold_value(f, stmt);
+                break;
+            case NODE_RETURN:
+                if (s->lhs) fold_value(f, s->lhs);
+                break;
+            case NODE_ASSIGN:
+                if (AST_NODE(ast, s->lhs)->kind != NODE_IDENT) fold_value(f, s->lhs);
+                fold_value(f, AST_NODE(ast, stmt)->rhs);
+                break;
+            case NODE_BLOCK:
+                fold_statements(f, s->lhs);
+                break;
+            case NODE_IF: {
+                fold_value(f, s->lhs);
+                struct Node *cond = AST_NODE(ast, s->lhs);
+                // a constant condition leaves just the branch it picks,
+                // which is looked at again in the if's place
+                if (is_literal(cond)) {
+                    replace_statement(ast, stmt, truthy(cond) ? s->rhs : s->alt);
+                    continue;
+                }
+                fold_statements(f, s->rhs);
+                if (s->alt) fold_statements(f, s->alt);
+                break;
+            }
+            case NODE_WHILE:
+                fold_value(f, s->lhs);
+                if (is_literal(AST_NODE(ast, s->lhs)) && !truthy(AST_NODE(ast, s->lhs))) {
+                    replace_statement(ast, stmt, 0);
+                    break;
+                }
+                fold_statements(f, s->rhs);
+                break;
+            case NODE_FOR:
+                fold_variable(f, s->lhs);
+                for (NodeId bound = s->alt; bound; bound = AST_NODE(ast, bound)->next) {
+                    fold_value(f, bound);
+                }
+                fold_statements(f, AST_NODE(ast, stmt)->rhs);
+                break;
+        }
+        stmt = AST_NODE(ast, stmt)->next;
+    }
+}
+
+int fold_module(struct Ast *ast) {
+    struct Folder f = { .ast = ast };
+    f.var_state = calloc(ast->node_count, 1);
+    if (!f.var_state) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    for (NodeId decl = ast->first; decl; decl = AST_NODE(ast, decl)->next) {
+        struct Node *node = AST_NODE(ast, decl);
+        if (node->kind == NODE_VARIABLE) {
+            fold_variable(&f, decl);
+        } else if (node->kind == NODE_FUNCTION) {
+            fold_statements(&f, node->lhs);
+        }
+    }
+
+    free(f.var_state);
+    ast->error_count += f.errors;
+    return f.errors;
+}
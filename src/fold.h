@@ -0,0 +1,12 @@
+#ifndef FOLD_H
+#define FOLD_H
+
+#include "ast.h"
+
+// Evaluates constant arithmetic, logic and string concatenation at
+// transpile time, and substitutes the value of every variable whose
+// initializer folds to a literal into its uses. Runs on a resolved module;
+// returns the number of errors.
+int fold_module(struct Ast *ast);
+
+#endif // FOLD_H
@@ -0,0 +1,275 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "common.h"
+#include "format.h"
+
+static bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+bool format_spec(const char *format, int len, int at, struct FormatSpec *spec) {
+    *spec = (struct FormatSpec){ .offset = at, .precision = -1 };
+    int i = at + 1;
+    bool flags = false, width = false;
+    while (i < len && format[i] && strchr("-+ #0'", format[i])) {
+        flags = true;
+        i++;
+    }
+    if (i < len && format[i] == '*') {
+        spec->stars++;
+        width = true;
+        i++;
+    }
+    while (i < len && is_digit(format[i])) {
+        width = true;
+        i++;
+    }
+    if (i < len && format[i] == '.') {
+        i++;
+        if (i < len && format[i] == '*') {
+            spec->stars++;
+            i++;
+        } else {
+            spec->precision = 0;
+            while (i < len && is_digit(format[i])) {
+                if (spec->precision < 1000) spec->precision = spec->precision * 10 + (format[i] - '0');
+                i++;
+            }
+        }
+    }
+    if (i + 1 < len && format[i] == 'h' && format[i + 1] == 'h') {
+        spec->length = LENGTH_HH;
+        i += 2;
+    } else if (i + 1 < len && format[i] == 'l' && format[i + 1] == 'l') {
+        spec->length = LENGTH_LL;
+        i += 2;
+    } else if (i < len && format[i] && strchr("hljztL", format[i])) {
+        static const char letters[] = "hljztL";
+        static const int lengths[] = { LENGTH_H, LENGTH_L, LENGTH_J, LENGTH_Z, LENGTH_T, LENGTH_LONG_DOUBLE };
+        spec->length = lengths[strchr(letters, format[i]) - letters];
+        i++;
+    }
+    if (i >= len) {
+        PRINT_ERR("println: the format ends inside '%.*s'\n", len - at, format + at);
+        return false;
+    }
+    spec->conv = format[i];
+    spec->len = i + 1 - at;
+    if (!spec->conv || !strchr("diouxXcsfFeEgGaAp%", spec->conv)) {
+        PRINT_ERR("println: '%.*s' is not a conversion gart can check\n", spec->len, format + at);
+        return false;
+    }
+    spec->plain = !flags && !width && spec->stars == 0 && strchr("diuxXcsf%", spec->conv)
+                  && (spec->precision < 0 || spec->conv == 'f') && spec->length != LENGTH_LONG_DOUBLE;
+    return true;
+}
+
+static const char *type_names[] = {
+    [TYPE_NONE] = "int", [TYPE_INT] = "int", [TYPE_INT64] = "int64", [TYPE_FLOAT] = "float",
+    [TYPE_DOUBLE] = "double", [TYPE_BOOL] = "bool", [TYPE_STR] = "string", [TYPE_POINTER] = "pointer",
+    [TYPE_SLICE] = "an array", [TYPE_STRUCT] = "a struct", [TYPE_VEC] = "a vec", [TYPE_MAP] = "a map",
+};
+
+static bool is_integer(int type) {
+    return type == TYPE_NONE || type == TYPE_INT || type == TYPE_INT64 || type == TYPE_BOOL;
+}
+
+// The value of an argument as written: infer_types hands a string to C
+// as a char *, wrapping it in a cast to pointer.
+static NodeId written(struct Ast *ast, NodeId arg) {
+    struct Node *node = AST_NODE(ast, arg);
+    if (node->kind == NODE_CAST && node->type == TYPE_POINTER && AST_NODE(ast, node->lhs)->type == TYPE_STR) {
+        return node->lhs;
+    }
+    return arg;
+}
+
+// `number` counts the format as argument 1, as C compilers do.
+static int check_arg(const char *format, const struct FormatSpec *spec, int type, int number) {
+    const char *takes = NULL;
+    switch (spec->conv) {
+        case 'd': case 'i': case 'o': case 'u': case 'x': case 'X': case 'c':
+            if (!is_integer(type)) {
+                takes = "an integer";
+            } else if (spec->conv == 'c' && spec->length != LENGTH_NONE) {
+                takes = "a char, no wide one";
+            } else if (type == TYPE_INT64 && spec->length <= LENGTH_H) {
+                PRINT_ERR("println: argument %d is int64, too wide for '%.*s' (use 'l' or 'll')\n", number,
+                          spec->len, format + spec->offset);
+                return 1;
+            }
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            if (type != TYPE_FLOAT && type != TYPE_DOUBLE) {
+                takes = "a float or double";
+            } else if (spec->length == LENGTH_LONG_DOUBLE) {
+                takes = "a long double, which gart doesn't have";
+            }
+            break;
+        case 's':
+            if (type != TYPE_STR || spec->length != LENGTH_NONE) takes = "a string";
+            break;
+        case 'p':
+            if (type != TYPE_POINTER && type != TYPE_STR) takes = "a pointer";
+            break;
+    }
+    if (!takes) return 0;
+    PRINT_ERR("println: '%.*s' takes %s, argument %d is %s\n", spec->len, format + spec->offset, takes, number,
+              type_names[type]);
+    return 1;
+}
+
+// Errors in the call, with `*checked` set when the format was a literal
+// that checked out.
+static int check_call(struct Ast *ast, NodeId call, bool *checked) {
+    struct Node *node = AST_NODE(ast, call);
+    *checked = false;
+    if (node->rhs || node->name != intern_cstr("println") || !node->lhs
+        || AST_NODE(ast, written(ast, node->lhs))->kind != NODE_STRING) {
+        return 0;
+    }
+    Sym str = AST_NODE(ast, written(ast, node->lhs))->str;
+    const char *format = sym_str(str);
+    int len = sym_len(str);
+    NodeId arg = AST_NODE(ast, node->lhs)->next;
+    int number = 2, errors = 0;
+    for (int at = 0; at < len; at++) {
+        if (format[at] != '%') continue;
+        struct FormatSpec spec;
+        if (!format_spec(format, len, at, &spec)) return errors + 1;
+        at += spec.len - 1;
+        if (spec.conv == '%') continue;
+        for (int c = 0; c <= spec.stars; c++) {
+            if (!arg) {
+                PRINT_ERR("println: no argument left for '%.*s'\n", spec.len, format + spec.offset);
+                return errors + 1;
+            }
+            int type = AST_NODE(ast, written(ast, arg))->type;
+            if (c < spec.stars && !is_integer(type)) {
+                PRINT_ERR("println: '*' in '%.*s' takes an int, argument %d is %s\n", spec.len,
+                          format + spec.offset, number, type_names[type]);
+                errors++;
+            } else if (c == spec.stars) {
+                errors += check_arg(format, &spec, type, number);
+            }
+            arg = AST_NODE(ast, arg)->next;
+            number++;
+        }
+    }
+    if (arg) {
+        int extra = 0;
+        for (; arg; arg = AST_NODE(ast, arg)->next) extra++;
+        PRINT_ERR("println: %d argument%s more than the format converts\n", extra, extra == 1 ? "" : "s");
+        errors++;
+    }
+    *checked = errors == 0;
+    return errors;
+}
+
+static int check_expr(struct Ast *ast, NodeId id) {
+    struct Node *node = AST_NODE(ast, id);
+    int errors = 0;
+    bool checked;
+    switch (node->kind) {
+        case NODE_CALL:
+            errors += check_call(ast, id, &checked);
+            // fall through
+        case NODE_ARRAY:
+        case NODE_CONSTRUCT:
+            for (NodeId arg = AST_NODE(ast, id)->lhs; arg; arg = AST_NODE(ast, arg)->next) {
+                errors += check_expr(ast, arg);
+            }
+            break;
+        case NODE_UNARY:
+        case NODE_CAST:
+        case NODE_LEN:
+        case NODE_MEMBER:
+        case NODE_ARRAY_NEW:
+            errors += check_expr(ast, node->lhs);
+            break;
+        case NODE_INDEX:
+        case NODE_BINARY:
+            errors += check_expr(ast, node->lhs);
+            errors += check_expr(ast, AST_NODE(ast, id)->rhs);
+            break;
+        case NODE_SLICE:
+            errors += check_expr(ast, node->lhs);
+            errors += check_expr(ast, AST_NODE(ast, id)->rhs);
+            if (AST_NODE(ast, id)->alt) errors += check_expr(ast, AST_NODE(ast, id)->alt);
+            break;
+    }
+    return errors;
+}
+
+static int check_statements(struct Ast *ast, NodeId first) {
+    int errors = 0;
+    for (NodeId stmt = first; stmt; stmt = AST_NODE(ast, stmt)->next) {
+        struct Node *node = AST_NODE(ast, stmt);
+        switch (node->kind) {
+            case NODE_CALL: {
+                // a spawned println stays a call, which its task makes
+                bool checked;
+                errors += check_call(ast, stmt, &checked);
+                if (checked && !(AST_NODE(ast, stmt)->flags & NODE_SPAWN)) {
+                    // its writers take strings as they are
+                    AST_NODE(ast, stmt)->flags |= NODE_FORMAT;
+                    for (NodeId arg = AST_NODE(ast, stmt)->lhs; arg; arg = AST_NODE(ast, arg)->next) {
+                        NodeId value = written(ast, arg);
+                        if (value == arg) continue;
+                        NodeId next = AST_NODE(ast, arg)->next;
+                        *AST_NODE(ast, arg) = *AST_NODE(ast, value);
+                        AST_NODE(ast, arg)->next = next;
+                    }
+                }
+                for (NodeId arg = AST_NODE(ast, stmt)->lhs; arg; arg = AST_NODE(ast, arg)->next) {
+                    errors += check_expr(ast, arg);
+                }
+                break;
+            }
+            case NODE_VARIABLE:
+            case NODE_RETURN:
+                if (node->lhs) errors += check_expr(ast, node->lhs);
+                break;
+            case NODE_ASSIGN:
+                errors += check_expr(ast, node->lhs);
+                errors += check_expr(ast, AST_NODE(ast, stmt)->rhs);
+                break;
+            case NODE_BLOCK:
+                errors += check_statements(ast, node->lhs);
+                break;
+            case NODE_IF:
+            case NODE_WHILE:
+                errors += check_expr(ast, node->lhs);
+                errors += check_statements(ast, AST_NODE(ast, stmt)->rhs);
+                if (AST_NODE(ast, stmt)->kind == NODE_IF && AST_NODE(ast, stmt)->alt) {
+                    errors += check_statements(ast, AST_NODE(ast, stmt)->alt);
+                }
+                break;
+            case NODE_FOR:
+                errors += check_expr(ast, AST_NODE(ast, node->lhs)->lhs);
+                for (NodeId bound = node->alt; bound; bound = AST_NODE(ast, bound)->next) {
+                    errors += check_expr(ast, bound);
+                }
+                errors += check_statements(ast, AST_NODE(ast, stmt)->rhs);
+                break;
+        }
+    }
+    return errors;
+}
+
+int check_formats(struct Ast *ast) {
+    int errors = 0;
+    for (NodeId decl = ast->first; decl; decl = AST_NODE(ast, decl)->next) {
+        struct Node *node = AST_NODE(ast, decl);
+        if (node->kind == NODE_FUNCTION && !(node->flags & NODE_DEAD)) {
+            errors += check_statements(ast, node->lhs);
+        } else if (node->kind == NODE_VARIABLE && node->lhs) {
+            errors += check_expr(ast, node->lhs);
+        }
+    }
+    ast->error_count += errors;
+    return errors;
+}
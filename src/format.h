@@ -0,0 +1,37 @@
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include <stdbool.h>
+
+#include "ast.h"
+
+enum FormatLength {
+    LENGTH_NONE, LENGTH_HH, LENGTH_H, LENGTH_L, LENGTH_LL, LENGTH_J, LENGTH_Z, LENGTH_T, LENGTH_LONG_DOUBLE,
+};
+
+// One printf conversion, from its '%' to its conversion character.
+struct FormatSpec {
+    int  offset;    // of the '%' in the format
+    int  len;
+    char conv;      // 'd', 'f', 's', ... or '%'
+    int  length;    // enum FormatLength
+    int  precision; // -1 when not given
+    int  stars;     // '*' width and precision, each taking an int argument
+    bool plain;     // no flags or width, and a precision only on 'f': the runtime has a writer for it
+};
+
+// Parses the conversion starting at format[at], a '%'. False, with an
+// error printed, for one gart can't check.
+bool format_spec(const char *format, int len, int at, struct FormatSpec *spec);
+
+// Checks every println whose format is a string literal against the
+// types of its arguments: the number of them, numbers for numeric
+// conversions, floating point for 'f', 'e', 'g' and 'a', a string for 's',
+// and no 64-bit integer where the conversion takes an int. Those called
+// as a statement are flagged NODE_FORMAT, for cgen to write piece by
+// piece instead of calling printf.
+//
+// Needs the types, so runs after infer_types; returns the number of errors.
+int check_formats(struct Ast *ast);
+
+#endif // FORMAT_H
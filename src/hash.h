@@ -0,0 +1,44 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Fast non-cryptographic 64-bit hash, 8 bytes per step.
+static inline uint64_t hash_mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static inline uint64_t hash_bytes(const void *data, size_t len, uint64_t seed) {
+    const unsigned char *p = data;
+    uint64_t h = seed ^ (len * 0x9e3779b97f4a7c15ULL);
+
+    while (len >= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        h = (h ^ hash_mix(word)) * 0x9e3779b97f4a7c15ULL;
+        p += 8;
+        len -= 8;
+    }
+
+    uint64_t tail = 0;
+    memcpy(&tail, p, len);
+    h = (h ^ hash_mix(tail)) * 0x9e3779b97f4a7c15ULL;
+    return hash_mix(h);
+}
+
+static inline uint64_t hash_str(const char *str, uint64_t seed) {
+    return hash_bytes(str, strlen(str), seed);
+}
+
+static inline uint64_t hash_combine(uint64_t h, uint64_t value) {
+    return hash_mix(h ^ (value + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2)));
+}
+
+#endif // HASH_H
@@ -0,0 +1,405 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "inline.h"
+
+// Size limit, in nodes, for bodies inlined without being asked to.
+#define INLINE_BUDGET 16
+
+struct Candidate {
+    bool     ok;
+    bool     has_value;     // body is a single 'return <expr>'
+    uint32_t size;
+};
+
+static uint32_t expr_size(struct Ast *ast, NodeId id) {
+    struct Node *node = AST_NODE(ast, id);
+    uint32_t size = 1;
+    switch (node->kind) {
+        case NODE_CALL:
+            for (NodeId arg = node->lhs; arg; arg = AST_NODE(ast, arg)->next) {
+                size += expr_size(ast, arg);
+            }
+            break;
+        case NODE_UNARY:
+        case NODE_CAST:
+        case NODE_LEN:
+        case NODE_ARRAY_NEW:
+        case NODE_MEMBER:
+            size += expr_size(ast, node->lhs);
+            break;
+        case NODE_BINARY:
+        case NODE_INDEX:
+            size += expr_size(ast, node->lhs) + expr_size(ast, node->rhs);
+            break;
+        case NODE_SLICE:
+            size += expr_size(ast, node->lhs) + expr_size(ast, node->rhs);
+            if (node->alt) size += expr_size(ast, node->alt);
+            break;
+        case NODE_ARRAY:
+        case NODE_CONSTRUCT:
+            for (NodeId element = node->lhs; element; element = AST_NODE(ast, element)->next) {
+                size += expr_size(ast, element);
+            }
+            break;
+    }
+    return size;
+}
+
+// What an expression contains that limits where a copy of it may go.
+struct ExprUses {
+    bool calls;         // has side effects
+    bool module_calls;  // calls a function of this module, so not a leaf
+    bool globals;       // reads a module-level variable
+};
+
+static void expr_uses(struct Ast *ast, NodeId id, struct ExprUses *uses) {
+    struct Node *node = AST_NODE(ast, id);
+    switch (node->kind) {
+        case NODE_IDENT:
+            // inlinable bodies have no locals, so this is a parameter or a global
+            if (node->rhs && AST_NODE(ast, node->rhs)->kind == NODE_VARIABLE) uses->globals = true;
+            break;
+        case NODE_CALL:
+            uses->calls = true;
+            if (node->rhs) uses->module_calls = true;
+            for (NodeId arg = node->lhs; arg; arg = AST_NODE(ast, arg)->next) {
+                expr_uses(ast, arg, uses);
+            }
+            break;
+        case NODE_ARRAY_NEW:
+            uses->calls = true;     // allocates
+            expr_uses(ast, node->lhs, uses);
+            break;
+        case NODE_UNARY:
+        case NODE_CAST:
+        case NODE_LEN:
+        case NODE_MEMBER:
+            expr_uses(ast, node->lhs, uses);
+            break;
+        case NODE_BINARY:
+        case NODE_INDEX:
+            expr_uses(ast, node->lhs, uses);
+            expr_uses(ast, node->rhs, uses);
+            break;
+        case NODE_SLICE:
+            expr_uses(ast, node->lhs, uses);
+            expr_uses(ast, node->rhs, uses);
+            if (node->alt) expr_uses(ast, node->alt, uses);
+            break;
+        case NODE_ARRAY:
+            uses->calls = true;     // a fresh array each time
+            for (NodeId element = node->lhs; element; element = AST_NODE(ast, element)->next) {
+                expr_uses(ast, element, uses);
+            }
+            break;
+        case NODE_CONSTRUCT:
+            for (NodeId element = node->lhs; element; element = AST_NODE(ast, element)->next) {
+                expr_uses(ast, element, uses);
+            }
+            break;
+    }
+}
+
+// Inlinable bodies are a run of calls with an optional final return, no
+// local variables (their names could clash at the call site) and no calls
+// into this module, so inlining never has to look at more than one level.
+static struct Candidate classify(struct Ast *ast, NodeId func, bool *exportable) {
+    struct Candidate c = {0};
+    struct Node *fn = AST_NODE(ast, func);
+    *exportable = false;
+    if (fn->name == sym_main || (fn->flags & NODE_NOINLINE)) return c;
+
+    struct ExprUses uses = {0};
+    int statements = 0;
+    for (NodeId stmt = fn->lhs; stmt; stmt = AST_NODE(ast, stmt)->next) {
+        struct Node *node = AST_NODE(ast, stmt);
+        statements++;
+        // a spawn's task is synced when its own function returns
+        if (node->kind == NODE_CALL && (node->flags & NODE_SPAWN)) return c;
+        if (node->kind == NODE_CALL) {
+            expr_uses(ast, stmt, &uses);
+            c.size += expr_size(ast, stmt);
+        } else if (node->kind == NODE_RETURN && !node->next) {
+            expr_uses(ast, node->lhs, &uses);
+            c.size += expr_size(ast, node->lhs) + 1;
+            c.has_value = statements == 1;
+        } else if (node->kind != NODE_NONE) {
+            return c;
+        }
+    }
+    if (uses.module_calls) return c;
+    if (c.size > INLINE_BUDGET && !(fn->flags & NODE_INLINE)) return c;
+
+    c.ok = true;
+    // the header copy is compiled in other modules, which can't see this
+    // module's variables
+    *exportable = !uses.globals;
+    return c;
+}
+
+// The call whose callee body is being copied: parameters in the body
+// are replaced by the matching argument, converted to the parameter type.
+struct Binding {
+    NodeId func;
+    NodeId call;
+};
+
+static NodeId new_cast(struct Ast *ast, int type, NodeId operand) {
+    NodeId cast = ast_new(ast, NODE_CAST);
+    AST_NODE(ast, cast)->type = type;
+    AST_NODE(ast, cast)->lhs = operand;
+    return cast;
+}
+
+static NodeId clone_expr(struct Ast *ast, NodeId id, const struct Binding *bind) {
+    NodeId decl = AST_NODE(ast, id)->kind == NODE_IDENT ? AST_NODE(ast, id)->rhs : 0;
+    if (bind && decl && AST_NODE(ast, decl)->kind == NODE_PARAM) {
+        NodeId param = AST_NODE(ast, bind->func)->rhs;
+        NodeId arg = AST_NODE(ast, bind->call)->lhs;
+        while (param != decl) {
+            param = AST_NODE(ast, param)->next;
+            arg = AST_NODE(ast, arg)->next;
+        }
+        // slices, structs, vecs and maps are passed as they are, C has no
+        // conversions for them
+        NodeId value = clone_expr(ast, arg, NULL);
+        int type = AST_NODE(ast, param)->type;
+        return type >= TYPE_SLICE ? value : new_cast(ast, type, value);
+    }
+
+    NodeId copy = ast_new(ast, NODE_NONE);
+    *AST_NODE(ast, copy) = *AST_NODE(ast, id);
+    AST_NODE(ast, copy)->next = 0;
+
+    switch (AST_NODE(ast, id)->kind) {
+        case NODE_CALL:
+        case NODE_ARRAY:
+        case NODE_CONSTRUCT: {
+            AST_NODE(ast, copy)->lhs = 0;
+            NodeId last = 0;
+            for (NodeId arg = AST_NODE(ast, id)->lhs; arg; arg = AST_NODE(ast, arg)->next) {
+                ast_append(ast, copy, &last, clone_expr(ast, arg, bind));
+            }
+            break;
+        }
+        case NODE_UNARY:
+        case NODE_CAST:
+        case NODE_LEN:
+        case NODE_ARRAY_NEW:
+        case NODE_MEMBER: {
+            NodeId lhs = clone_expr(ast, AST_NODE(ast, id)->lhs, bind);
+            AST_NODE(ast, copy)->lhs = lhs;
+            break;
+        }
+        case NODE_BINARY:
+        case NODE_INDEX:
+        case NODE_SLICE: {
+            NodeId lhs = clone_expr(ast, AST_NODE(ast, id)->lhs, bind);
+            NodeId rhs = clone_expr(ast, AST_NODE(ast, id)->rhs, bind);
+            AST_NODE(ast, copy)->lhs = lhs;
+            AST_NODE(ast, copy)->rhs = rhs;
+            if (AST_NODE(ast, id)->kind == NODE_SLICE && AST_NODE(ast, id)->alt) {
+                NodeId end = clone_expr(ast, AST_NODE(ast, id)->alt, bind);
+                AST_NODE(ast, copy)->alt = end;
+            }
+            break;
+        }
+    }
+    return copy;
+}
+
+// Puts node `src` in the place of `dst`, which keeps its list position.
+static void replace(struct Ast *ast, NodeId dst, NodeId src) {
+    NodeId next = AST_NODE(ast, dst)->next;
+    *AST_NODE(ast, dst) = *AST_NODE(ast, src);
+    AST_NODE(ast, dst)->next = next;
+}
+
+struct Inliner {
+    struct Ast       *ast;
+    struct Candidate *candidates;   // per node, for functions
+    int               replaced;
+};
+
+// Arguments are substituted for every use of their parameter, so only
+// ones that are free to evaluate any number of times qualify.
+static struct Candidate *callee(struct Inliner *in, NodeId call) {
+    NodeId func = AST_NODE(in->ast, call)->rhs;
+    if (!func || !in->candidates[func].ok || (AST_NODE(in->ast, call)->flags & NODE_SPAWN)) return NULL;
+    for (NodeId arg = AST_NODE(in->ast, call)->lhs; arg; arg = AST_NODE(in->ast, arg)->next) {
+        switch (AST_NODE(in->ast, arg)->kind) {
+            case NODE_INT: case NODE_FLOAT: case NODE_STRING: case NODE_BOOL:
+            case NODE_NULL: case NODE_IDENT: case NODE_FUNC_REF:
+                break;
+            default:
+                return NULL;
+        }
+    }
+    return &in->candidates[func];
+}
+
+// Calls used for their value are replaced by the returned expression.
+static void inline_expr(struct Inliner *in, NodeId id) {
+    struct Ast *ast = in->ast;
+    struct Node *node = AST_NODE(ast, id);
+    switch (node->kind) {
+        case NODE_CALL: {
+            for (NodeId arg = node->lhs; arg; arg = AST_NODE(ast, arg)->next) {
+                inline_expr(in, arg);
+            }
+            struct Candidate *c = callee(in, id);
+            if (c && c->has_value) {
+                struct Binding bind = { AST_NODE(ast, id)->rhs, id };
+                NodeId ret = AST_NODE(ast, bind.func)->lhs;
+                NodeId value = clone_expr(ast, AST_NODE(ast, ret)->lhs, &bind);
+                int type = AST_NODE(ast, bind.func)->type;
+                replace(ast, id, type >= TYPE_SLICE ? value : new_cast(ast, type, value));
+                in->replaced++;
+            }
+            break;
+        }
+        case NODE_UNARY:
+        case NODE_CAST:
+        case NODE_LEN:
+        case NODE_ARRAY_NEW:
+        case NODE_MEMBER:
+            inline_expr(in, node->lhs);
+            break;
+        case NODE_BINARY:
+        case NODE_INDEX:
+            inline_expr(in, node->lhs);
+            inline_expr(in, AST_NODE(ast, id)->rhs);
+            break;
+        case NODE_SLICE:
+            inline_expr(in, node->lhs);
+            inline_expr(in, AST_NODE(ast, id)->rhs);
+            if (AST_NODE(ast, id)->alt) inline_expr(in, AST_NODE(ast, id)->alt);
+            break;
+        case NODE_ARRAY:
+        case NODE_CONSTRUCT:
+            for (NodeId element = node->lhs; element; element = AST_NODE(ast, element)->next) {
+                inline_expr(in, element);
+            }
+            break;
+    }
+}
+
+// A call statement becomes the calls of the body; a returned value is
+// kept only if it is itself a call, and dropped if it has no effects.
+static void inline_statement(struct Inliner *in, NodeId stmt) {
+    struct Ast *ast = in->ast;
+    for (NodeId arg = AST_NODE(ast, stmt)->lhs; arg; arg = AST_NODE(ast, arg)->next) {
+        inline_expr(in, arg);
+    }
+    if (!callee(in, stmt)) return;
+
+    NodeId func = AST_NODE(ast, stmt)->rhs;
+    struct Binding bind = { func, stmt };
+    NodeId first = 0, last = 0;
+    for (NodeId body = AST_NODE(ast, func)->lhs; body; body = AST_NODE(ast, body)->next) {
+        NodeId copy;
+        if (AST_NODE(ast, body)->kind == NODE_CALL) {
+            copy = clone_expr(ast, body, &bind);
+        } else if (AST_NODE(ast, body)->kind == NODE_RETURN) {
+            NodeId value = AST_NODE(ast, body)->lhs;
+            struct ExprUses uses = {0};
+            expr_uses(ast, value, &uses);
+            if (AST_NODE(ast, value)->kind == NODE_CALL) {
+                copy = clone_expr(ast, value, &bind);
+            } else if (uses.calls) {
+                return;     // a value with effects can't stand as a statement
+            } else {
+                continue;
+            }
+        } else {
+            continue;
+        }
+        if (last) {
+            AST_NODE(ast, last)->next = copy;
+        } else {
+            first = copy;
+        }
+        last = copy;
+    }
+
+    in->replaced++;
+    if (!first) {
+        AST_NODE(ast, stmt)->kind = NODE_NONE;
+        return;
+    }
+    AST_NODE(ast, last)->next = AST_NODE(ast, stmt)->next;
+    NodeId next = AST_NODE(ast, first)->next;
+    replace(ast, stmt, first);
+    AST_NODE(ast, stmt)->next = next;
+}
+
+static void inline_statements(struct Inliner *in, NodeId first) {
+    struct Ast *ast = in->ast;
+    for (NodeId stmt = first; stmt; stmt = AST_NODE(ast, stmt)->next) {
+        struct Node *s = AST_NODE(ast, stmt);
+        switch (s->kind) {
+            case NODE_CALL:
+                inline_statement(in, stmt);
+                break;
+            case NODE_VARIABLE:
+            case NODE_RETURN:
+                if (s->lhs) inline_expr(in, s->lhs);
+                break;
+            case NODE_ASSIGN:
+                if (AST_NODE(ast, s->lhs)->kind != NODE_IDENT) inline_expr(in, s->lhs);
+                inline_expr(in, AST_NODE(ast, stmt)->rhs);
+                break;
+            case NODE_BLOCK:
+                inline_statements(in, s->lhs);
+                break;
+            case NODE_IF:
+            case NODE_WHILE: {
+                NodeId body = s->rhs, alt = s->kind == NODE_IF ? s->alt : 0;
+                inline_expr(in, s->lhs);
+                inline_statements(in, body);
+                if (alt) inline_statements(in, alt);
+                break;
+            }
+            case NODE_FOR: {
+                NodeId body = s->rhs, bound = s->alt;
+                inline_expr(in, AST_NODE(ast, s->lhs)->lhs);
+                for (; bound; bound = AST_NODE(ast, bound)->next) {
+                    inline_expr(in, bound);
+                }
+                inline_statements(in, body);
+                break;
+            }
+        }
+    }
+}
+
+int inline_module(struct Ast *ast) {
+    struct Inliner in = { .ast = ast };
+    in.candidates = calloc(ast->node_count, sizeof(struct Candidate));
+    if (!in.candidates) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    for (NodeId decl = ast->first; decl; decl = AST_NODE(ast, decl)->next) {
+        if (AST_NODE(ast, decl)->kind != NODE_FUNCTION) continue;
+        bool exportable;
+        in.candidates[decl] = classify(ast, decl, &exportable);
+        if (exportable) AST_NODE(ast, decl)->flags |= NODE_IN_HEADER;
+    }
+
+    for (NodeId decl = ast->first; decl; decl = AST_NODE(ast, decl)->next) {
+        struct Node *node = AST_NODE(ast, decl);
+        if (node->kind == NODE_VARIABLE && node->lhs) {
+            inline_expr(&in, node->lhs);
+            continue;
+        }
+        if (node->kind == NODE_FUNCTION) inline_statements(&in, node->lhs);
+    }
+
+    free(in.candidates);
+    return in.replaced;
+}
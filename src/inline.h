@@ -0,0 +1,13 @@
+#ifndef INLINE_H
+#define INLINE_H
+
+#include "ast.h"
+
+// Gart-level inliner. Small leaf functions (or any marked 'inline' whose
+// body allows it) are substituted at their call sites in the module, and
+// flagged NODE_IN_HEADER when other modules can take their definition
+// from the module header as well. Returns the number of call sites
+// replaced.
+int inline_module(struct Ast *ast);
+
+#endif // INLINE_H
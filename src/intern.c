@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "intern.h"
+#include "arena.h"
+#include "hash.h"
+
+// The table is split into shards, each behind its own lock, so threads
+// parsing different modules rarely wait for each other. A symbol encodes
+// its shard in the low bits and its index within the shard above them.
+#define SHARD_BITS 6
+#define SHARD_COUNT (1 << SHARD_BITS)
+
+// Entries live in fixed-size pages that never move, so sym_str can read
+// them without taking the lock.
+#define PAGE_BITS 12
+#define PAGE_SIZE (1 << PAGE_BITS)
+#define MAX_PAGES 4096
+
+struct SymEntry {
+    const char *str;
+    uint32_t    len;
+    uint32_t    hash;
+};
+
+struct Shard {
+    pthread_mutex_t  lock;
+    struct SymEntry *pages[MAX_PAGES];
+    uint32_t         count;
+    uint32_t        *slots;     // open addressing, index + 1 of an entry, 0 = empty
+    uint32_t         slot_mask;
+    struct Arena     arena;
+};
+
+static struct Shard shards[SHARD_COUNT];
+
+Sym sym_main;
+
+static struct SymEntry *shard_entry(struct Shard *shard, uint32_t index) {
+    return &shard->pages[index >> PAGE_BITS][index & (PAGE_SIZE - 1)];
+}
+
+static void shard_grow(struct Shard *shard) {
+    uint32_t cap = shard->slots ? (shard->slot_mask + 1) * 2 : 256;
+    uint32_t *slots = calloc(cap, sizeof(uint32_t));
+    if (!slots) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    for (uint32_t i = 0; i < shard->count; i++) {
+        uint32_t pos = shard_entry(shard, i)->hash & (cap - 1);
+        while (slots[pos]) pos = (pos + 1) & (cap - 1);
+        slots[pos] = i + 1;
+    }
+    free(shard->slots);
+    shard->slots = slots;
+    shard->slot_mask = cap - 1;
+}
+
+void intern_init(void) {
+    for (int i = 0; i < SHARD_COUNT; i++) {
+        pthread_mutex_init(&shards[i].lock, NULL);
+    }
+    sym_main = intern_cstr("main");
+}
+
+Sym intern(const char *str, int len) {
+    uint64_t hash = hash_bytes(str, len, 0);
+    uint32_t shard_index = hash & (SHARD_COUNT - 1);
+    uint32_t slot_hash = (uint32_t)(hash >> 32);
+    struct Shard *shard = &shards[shard_index];
+
+    pthread_mutex_lock(&shard->lock);
+    if (!shard->slots || (shard->count + 1) * 4 > (shard->slot_mask + 1) * 3) {
+        shard_grow(shard);
+    }
+
+    uint32_t pos = slot_hash & shard->slot_mask;
+    while (shard->slots[pos]) {
+        uint32_t index = shard->slots[pos] - 1;
+        struct SymEntry *entry = shard_entry(shard, index);
+        if (entry->hash == slot_hash && entry->len == (uint32_t)len && memcmp(entry->str, str, len) == 0) {
+            pthread_mutex_unlock(&shard->lock);
+            return ((index + 1) << SHARD_BITS) | shard_index;
+        }
+        pos = (pos + 1) & shard->slot_mask;
+    }
+
+    uint32_t index = shard->count;
+    if ((index >> PAGE_BITS) >= MAX_PAGES) {
+        fprintf(stderr, "too many symbols\n");
+        exit(1);
+    }
+    if (!shard->pages[index >> PAGE_BITS]) {
+        shard->pages[index >> PAGE_BITS] = malloc(PAGE_SIZE * sizeof(struct SymEntry));
+        if (!shard->pages[index >> PAGE_BITS]) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+    struct SymEntry *entry = shard_entry(shard, index);
+    entry->str = arena_strndup(&shard->arena, str, len);
+    entry->len = len;
+    entry->hash = slot_hash;
+    shard->slots[pos] = index + 1;
+    shard->count++;
+    pthread_mutex_unlock(&shard->lock);
+
+    return ((index + 1) << SHARD_BITS) | shard_index;
+}
+
+Sym intern_cstr(const char *str) {
+    return intern(str, (int)strlen(str));
+}
+
+const char *sym_str(Sym sym) {
+    if (!sym) return "";
+    return shard_entry(&shards[sym & (SHARD_COUNT - 1)], (sym >> SHARD_BITS) - 1)->str;
+}
+
+int sym_len(Sym sym) {
+    if (!sym) return 0;
+    return shard_entry(&shards[sym & (SHARD_COUNT - 1)], (sym >> SHARD_BITS) - 1)->len;
+}
@@ -0,0 +1,20 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stdint.h>
+
+// Program-wide string interning. Every identifier and literal is stored
+// once and referred to by a 32-bit symbol, so comparing names is comparing
+// integers. Safe to use from several threads at once.
+typedef uint32_t Sym;   // 0 is "no symbol"
+
+void intern_init(void);
+Sym intern(const char *str, int len);
+Sym intern_cstr(const char *str);
+const char *sym_str(Sym sym);
+int sym_len(Sym sym);
+
+// Names the compiler itself needs to recognise, set up by intern_init.
+extern Sym sym_main;
+
+#endif // INTERN_H
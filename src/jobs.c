@@ -0,0 +1,60 @@
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "jobs.h"
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <unistd.h>
+#endif
+
+struct Jobs {
+    void (*fn)(void *ctx, int index);
+    void *ctx;
+    int count;
+    atomic_int next;
+};
+
+static void *worker(void *arg) {
+    struct Jobs *jobs = arg;
+    for (;;) {
+        int index = atomic_fetch_add(&jobs->next, 1);
+        if (index >= jobs->count) break;
+        jobs->fn(jobs->ctx, index);
+    }
+    return NULL;
+}
+
+void parallel_for(int count, int threads, void (*fn)(void *ctx, int index), void *ctx) {
+    struct Jobs jobs = { fn, ctx, count, 0 };
+    if (threads > count) threads = count;
+    if (threads <= 1) {
+        worker(&jobs);
+        return;
+    }
+
+    // the calling thread works too
+    pthread_t *ids = malloc((threads - 1) * sizeof(pthread_t));
+    int started = 0;
+    for (int i = 0; i < threads - 1; i++) {
+        if (pthread_create(&ids[started], NULL, worker, &jobs) == 0) started++;
+    }
+    worker(&jobs);
+    for (int i = 0; i < started; i++) {
+        pthread_join(ids[i], NULL);
+    }
+    free(ids);
+}
+
+int cpu_count(void) {
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
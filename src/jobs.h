@@ -0,0 +1,11 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+// Calls fn(ctx, i) for every i in [0, count) on up to `threads` threads.
+// Indices are handed out dynamically, so uneven work balances itself.
+void parallel_for(int count, int threads, void (*fn)(void *ctx, int index), void *ctx);
+
+// Number of online processors, at least 1.
+int cpu_count(void);
+
+#endif // JOBS_H
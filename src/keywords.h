@@ -0,0 +1,105 @@
+#ifndef KEYWORDS_H
+#define KEYWORDS_H
+
+#include <string.h>
+
+#include "stb_c_lexer.h"
+
+// Keyword token kinds, handed out by the lexer in place of CLEX_id so the
+// parser can switch on an integer instead of comparing strings.
+enum Keyword {
+    KW_fn = CLEX_first_unused_token,
+    KW_end,
+    KW_return,
+    KW_gvar,
+    KW_svar,
+    KW_true,
+    KW_false,
+    KW_null,
+    KW_inline,
+    KW_noinline,
+    KW_if,
+    KW_elif,
+    KW_else,
+    KW_while,
+    KW_for,
+    KW_break,
+    KW_continue,
+    KW_len,
+    KW_struct,
+    KW_soa,
+    KW_simd,
+    KW_parallel,
+    KW_spawn,
+    KW_sync,
+    KW_vec,
+    KW_map,
+
+    KW_first_unused_token
+};
+
+#define KW_MATCH(str, lit, kw) (memcmp((str), (lit), sizeof(lit) - 1) == 0 ? (kw) : CLEX_id)
+
+// Resolved by length and first character, so every identifier costs at
+// most one short memcmp.
+static inline int keyword_lookup(const char *str, int len) {
+    switch (len) {
+        case 2:
+            switch (str[0]) {
+                case 'f': return KW_MATCH(str, "fn", KW_fn);
+                case 'i': return KW_MATCH(str, "if", KW_if);
+            }
+            break;
+        case 3:
+            switch (str[0]) {
+                case 'e': return KW_MATCH(str, "end", KW_end);
+                case 'f': return KW_MATCH(str, "for", KW_for);
+                case 'l': return KW_MATCH(str, "len", KW_len);
+                case 'm': return KW_MATCH(str, "map", KW_map);
+                case 's': return KW_MATCH(str, "soa", KW_soa);
+                case 'v': return KW_MATCH(str, "vec", KW_vec);
+            }
+            break;
+        case 4:
+            switch (str[0]) {
+                case 'g': return KW_MATCH(str, "gvar", KW_gvar);
+                case 's':
+                    if (str[1] == 'i') return KW_MATCH(str, "simd", KW_simd);
+                    if (str[1] == 'y') return KW_MATCH(str, "sync", KW_sync);
+                    return KW_MATCH(str, "svar", KW_svar);
+                case 't': return KW_MATCH(str, "true", KW_true);
+                case 'n': return KW_MATCH(str, "null", KW_null);
+                case 'e':
+                    if (str[2] == 'i') return KW_MATCH(str, "elif", KW_elif);
+                    return KW_MATCH(str, "else", KW_else);
+            }
+            break;
+        case 5:
+            switch (str[0]) {
+                case 'f': return KW_MATCH(str, "false", KW_false);
+                case 'w': return KW_MATCH(str, "while", KW_while);
+                case 'b': return KW_MATCH(str, "break", KW_break);
+                case 's': return KW_MATCH(str, "spawn", KW_spawn);
+            }
+            break;
+        case 6:
+            switch (str[0]) {
+                case 'r': return KW_MATCH(str, "return", KW_return);
+                case 'i': return KW_MATCH(str, "inline", KW_inline);
+                case 's': return KW_MATCH(str, "struct", KW_struct);
+            }
+            break;
+        case 8:
+            switch (str[0]) {
+                case 'n': return KW_MATCH(str, "noinline", KW_noinline);
+                case 'c': return KW_MATCH(str, "continue", KW_continue);
+                case 'p': return KW_MATCH(str, "parallel", KW_parallel);
+            }
+            break;
+    }
+    return CLEX_id;
+}
+
+#undef KW_MATCH
+
+#endif // KEYWORDS_H
@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lexer.h"
+#include "keywords.h"
+
+#define STB_C_LEXER_IMPLEMENTATION
+#include "stb_c_lexer.h"
+
+#if defined(_WIN32)
+    #include <io.h>
+    #define read _read
+#else
+    #include <unistd.h>
+#endif
+
+#define LEXER_CHUNK      0x10000
+#define LEXER_STORE_INIT 0x1000
+
+static void *xrealloc(void *ptr, size_t size) {
+    ptr = realloc(ptr, size);
+    if (!ptr) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    return ptr;
+}
+
+static void lexer_init_common(struct Lexer *lexer) {
+    memset(lexer, 0, sizeof(*lexer));
+    lexer->fd = -1;
+    lexer->store_cap = LEXER_STORE_INIT;
+    lexer->store = xrealloc(NULL, lexer->store_cap);
+}
+
+void lexer_init_memory(struct Lexer *lexer, const char *data, size_t len) {
+    lexer_init_common(lexer);
+    lexer->at_eof = true;
+    stb_c_lexer_init(&lexer->stb, data, data + len, lexer->store, lexer->store_cap);
+}
+
+void lexer_init_stream(struct Lexer *lexer, int fd) {
+    lexer_init_common(lexer);
+    lexer->fd = fd;
+    lexer->buffer_cap = LEXER_CHUNK;
+    lexer->buffer = xrealloc(NULL, lexer->buffer_cap);
+    stb_c_lexer_init(&lexer->stb, lexer->buffer, lexer->buffer, lexer->store, lexer->store_cap);
+}
+
+void lexer_free(struct Lexer *lexer) {
+    free(lexer->store);
+    free(lexer->buffer);
+    memset(lexer, 0, sizeof(*lexer));
+    lexer->fd = -1;
+}
+
+// Drops everything before `keep`, then reads the next chunk behind what is
+// left. The window grows when a single token fills all of it.
+static void refill(struct Lexer *lexer, char *keep) {
+    size_t kept = lexer->buffer + lexer->buffer_len - keep;
+    memmove(lexer->buffer, keep, kept);
+    lexer->buffer_len = kept;
+
+    if (lexer->buffer_cap - lexer->buffer_len < LEXER_CHUNK / 2) {
+        lexer->buffer_cap *= 2;
+        lexer->buffer = xrealloc(lexer->buffer, lexer->buffer_cap);
+    }
+
+    long n = read(lexer->fd, lexer->buffer + lexer->buffer_len, (unsigned)(lexer->buffer_cap - lexer->buffer_len));
+    if (n <= 0) {
+        lexer->at_eof = true;
+    } else {
+        lexer->buffer_len += n;
+    }
+
+    stb_c_lexer_init(&lexer->stb, lexer->buffer, lexer->buffer + lexer->buffer_len, lexer->store, lexer->store_cap);
+}
+
+int lex_next(struct Lexer *lexer) {
+    stb_lexer *stb = &lexer->stb;
+    int got;
+
+    if (lexer->pushed_back) {
+        lexer->pushed_back = false;
+        return 1;
+    }
+
+    for (;;) {
+        char *start = stb->parse_point;
+        got = stb_c_lexer_get_token(stb);
+
+        // a token (or whitespace) running into the end of the window may
+        // continue in the next chunk, so lex it again with more input
+        bool at_window_end = !got || stb->where_lastchar + 1 >= stb->eof;
+        if (!lexer->at_eof && at_window_end) {
+            refill(lexer, start);
+            continue;
+        }
+
+        // the text of an identifier or literal didn't fit: grow and retry
+        if (got && stb->token == CLEX_parse_error
+            && stb->where_lastchar - stb->where_firstchar + 2 >= lexer->store_cap) {
+            lexer->store_cap *= 2;
+            lexer->store = xrealloc(lexer->store, lexer->store_cap);
+            stb->string_storage = lexer->store;
+            stb->string_storage_len = lexer->store_cap;
+            stb->parse_point = start;
+            continue;
+        }
+        break;
+    }
+
+    lexer->token = stb->token;
+    lexer->int_number = stb->int_number;
+    lexer->real_number = stb->real_number;
+    lexer->string = stb->string;
+    lexer->string_len = stb->string_len;
+    if (!got) return 0;
+
+    if (lexer->token == CLEX_id) {
+        lexer->token = keyword_lookup(lexer->string, lexer->string_len);
+    }
+    return 1;
+}
+
+void lex_unget(struct Lexer *lexer) {
+    lexer->pushed_back = true;
+}
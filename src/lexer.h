@@ -0,0 +1,47 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "stb_c_lexer.h"
+
+// Front end over stb_c_lexer. Input is either one block already in memory
+// or a file descriptor read in chunks; a token that straddles the end of a
+// chunk is lexed again once more input has arrived. The storage for the
+// text of identifiers and string literals grows to fit the longest token.
+struct Lexer {
+    // current token, same meaning as the stb_lexer fields of the same name
+    long   token;
+    long   int_number;
+    double real_number;
+    char  *string;
+    int    string_len;
+    bool   pushed_back;     // lex_next hands out the current token again
+
+    stb_lexer stb;
+
+    char  *store;
+    int    store_cap;
+
+    // streamed input only
+    int    fd;
+    char  *buffer;
+    size_t buffer_len;
+    size_t buffer_cap;
+    bool   at_eof;
+};
+
+void lexer_init_memory(struct Lexer *lexer, const char *data, size_t len);
+void lexer_init_stream(struct Lexer *lexer, int fd);
+void lexer_free(struct Lexer *lexer);
+
+// Next token, with keywords reported as KW_* instead of CLEX_id.
+// Returns 0 at end of input.
+int lex_next(struct Lexer *lexer);
+
+// Makes the next lex_next return the current token once more, for parsers
+// that need to look one token past what they consume.
+void lex_unget(struct Lexer *lexer);
+
+#endif // LEXER_H
@@ -2,20 +2,39 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <errno.h>
 #include "clexer.h"
+#include "sema.h"
+#include "fold.h"
+#include "dce.h"
+#include "inline.h"
+#include "bounds.h"
+#include "parallel.h"
+#include "regions.h"
+#include "format.h"
+#include "types.h"
+#include "cgen.h"
+#include "outbuf.h"
+#include "driver.h"
+#include "jobs.h"
+#include "cache.h"
+#include "hash.h"
+#include "source.h"
+#include "common.h"
 
-#include "stb_c_lexer.h"
 
-extern void parse_program(stb_lexer *lexer, FILE *out);
-
-void write_c_header(FILE *out) {
-    fprintf(out,
+// The runtime header brings the slice, vec and map templates; each
+// module's header instantiates them for the types it uses.
+void write_c_header(struct OutBuf *out) {
+    ob_lit(out,
         "#include <stdio.h>\n"
+        "#include <stddef.h>\n"
         "#include <stdint.h>\n"
         "#include <stdbool.h>\n"
         "#include <stdlib.h>\n"
         "#include <time.h>\n"
-        "#include <string.h>\n\n"
+        "#include <string.h>\n"
+        "#include \"gart_rt.h\"\n\n"
 
         "#define println printf\n"
     );
@@ -23,10 +42,12 @@ void write_c_header(FILE *out) {
 
 #if defined(_WIN32)
     #include <direct.h>
+    #include <sys/stat.h>
     #define mkdir_crossp(path) _mkdir(path)
 #else
     #include <sys/stat.h>
     #include <sys/types.h>
+    #include <unistd.h>
     #define mkdir_crossp(path) mkdir(path, 0755)
 #endif
 
@@ -38,35 +59,524 @@ int make_dir(const char *path) {
     return -1;
 }
 
-char *read_file(const char *path) {
-    FILE *f = fopen(path, "rb");
+bool file_exists(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0;
+}
+
+// Hash of a file's contents, 0 when it cannot be read.
+uint64_t hash_file(const char *path) {
+    struct Source src;
+    if (!source_open(&src, path)) return 0;
+    if (src.fd >= 0) {
+        source_close(&src);
+        return 0;
+    }
+    uint64_t hash = hash_bytes(src.data, src.len, 0);
+    source_close(&src);
+    return hash;
+}
+
+// Path of the running gart, malloc'd.
+char *exe_path(const char *argv0) {
+#if !defined(_WIN32)
+    char path[4096];
+    ssize_t len = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (len > 0) {
+        path[len] = '\0';
+        return strdup(path);
+    }
+#endif
+    return strdup(argv0);
+}
+
+// Directory of the running gart, where make puts the runtime next to it.
+char *exe_dir(const char *argv0) {
+    char *exe = exe_path(argv0);
+    const char *slash = strrchr(exe, '/');
+    char *dir = slash ? strndup(exe, slash - exe) : strdup(".");
+    free(exe);
+    return dir;
+}
+
+// "dir/name", malloc'd.
+char *path_join(const char *dir, const char *name) {
+    size_t len = strlen(dir) + 1 + strlen(name) + 1;
+    char *path = malloc(len);
+    if (!path) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    snprintf(path, len, "%s/%s", dir, name);
+    return path;
+}
+
+// One .gl input and everything derived from it.
+struct Module {
+    const char *path;
+    char       *c_path;
+    char       *h_path;     // prototypes this module exports
+    char       *inl_path;   // functions it lets other modules inline
+    char       *o_path;
+    uint64_t    src_hash;
+    uint64_t    emit_hash;
+    uint64_t    obj_key;
+    bool        parsed;     // ast holds the module
+    bool        emit;       // .c/.h have to be (re)written
+    bool        generated;  // .c/.h were written by this run
+    bool        compile;
+    struct Ast  ast;
+    struct Summary summary;
+    bool       *live;       // per function, reachable from main
+    bool        ok;
+};
+
+#define CACHE_PATH "out/.gartcache"
+
+struct Build {
+    struct Module *modules;
+    int            count;
+    const char    *header_path;
+    struct Cache   cache;
+    bool           use_cache;
+    struct Scope   signatures;  // return types of every callable function
+};
+
+// "dir/name.gl" -> "out/name<suffix>", with a counter appended when two
+// inputs share a file name.
+char *module_output_path(struct Build *build, int index, const char *suffix) {
+    const char *path = build->modules[index].path;
+    if (strcmp(path, "-") == 0) path = "stdin";
+    const char *base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    const char *dot = strrchr(base, '.');
+    int stem_len = dot ? (int)(dot - base) : (int)strlen(base);
+
+    int clashes = 0;
+    for (int i = 0; i < index; i++) {
+        const char *other = build->modules[i].path;
+        if (strcmp(other, "-") == 0) other = "stdin";
+        const char *other_base = strrchr(other, '/');
+        other_base = other_base ? other_base + 1 : other;
+        if (strncmp(other_base, base, stem_len) == 0 && (other_base[stem_len] == '.' || other_base[stem_len] == '\0')) {
+            clashes++;
+        }
+    }
+
+    char *out = malloc(stem_len + strlen(suffix) + 32);
+    if (clashes) {
+        sprintf(out, "out/%.*s_%d%s", stem_len, base, clashes, suffix);
+    } else {
+        sprintf(out, "out/%.*s%s", stem_len, base, suffix);
+    }
+    return out;
+}
+
+static bool parse_module(struct Module *module, struct Source *source) {
+    struct Lexer lex;
+    if (source->fd >= 0) {
+        lexer_init_stream(&lex, source->fd);
+    } else {
+        lexer_init_memory(&lex, source->data, source->len);
+    }
+
+    ast_init(&module->ast);
+    module->parsed = parse_program(&lex, &module->ast) == 0 && resolve_module(&module->ast) == 0
+                     && fold_module(&module->ast) == 0;
+    lexer_free(&lex);
+    // inlined bodies may fold further at their call sites
+    if (module->parsed && inline_module(&module->ast) > 0) {
+        module->parsed = fold_module(&module->ast) == 0;
+    }
+    return module->parsed;
+}
+
+// Reads and hashes one module and gets the summary of what its functions
+// call: from the cache when it holds this exact source, otherwise by
+// parsing it.
+void scan_module(void *ctx, int index) {
+    struct Build *build = ctx;
+    struct Module *module = &build->modules[index];
+
+    struct Source source;
+    if (!source_open(&source, module->path)) {
+        PRINT_ERR("could not read '%s'\n", module->path);
+        return;
+    }
+    // streamed input is only seen once, while parsing, so it is never cached
+    bool streamed = source.fd >= 0;
+    if (!streamed) {
+        module->src_hash = hash_bytes(source.data, source.len, 0);
+    }
+
+    struct CacheEntry *entry = build->use_cache && !streamed ? cache_find(&build->cache, module->c_path) : NULL;
+    if (entry && entry->src_hash == module->src_hash
+        && file_exists(module->c_path) && file_exists(module->h_path) && file_exists(module->inl_path)) {
+        summary_copy(&module->summary, &entry->summary);
+        module->ok = true;
+        source_close(&source);
+        return;
+    }
+
+    module->ok = parse_module(module, &source);
+    source_close(&source);
+    if (module->ok) {
+        summary_build(&module->summary, &module->ast);
+    }
+}
+
+// Writes a module's .c and .h, keeping only what is reachable. A cached
+// module is parsed here after all if the set of live functions changed.
+void emit_module(void *ctx, int index) {
+    struct Build *build = ctx;
+    struct Module *module = &build->modules[index];
+    if (!module->emit) return;
+
+    if (!module->parsed) {
+        struct Source source;
+        if (!source_open(&source, module->path)) {
+            PRINT_ERR("could not read '%s'\n", module->path);
+            module->ok = false;
+            return;
+        }
+        module->ok = parse_module(module, &source);
+        source_close(&source);
+        if (!module->ok) return;
+    }
+    dce_apply(&module->ast, module->live);
+    if (infer_types(&module->ast, &build->signatures) > 0) {
+        module->ok = false;
+        return;
+    }
+    elide_bounds_checks(&module->ast);
+    if (prepare_parallel(&module->ast) > 0 || check_formats(&module->ast) > 0) {
+        module->ok = false;
+        return;
+    }
+    plan_regions(&module->ast);
+
+    // the include line, the string literals and the body are separate
+    // buffers, joined by writev
+    struct OutBuf parts[3], header, inl[2];
+    ob_init(&parts[0]);
+    ob_init(&parts[1]);
+    ob_init(&parts[2]);
+    ob_init(&header);
+    ob_init(&inl[0]);
+    ob_init(&inl[1]);
+    ob_lit(&parts[0], "#include \"");
+    ob_puts(&parts[0], strrchr(build->header_path, '/') + 1);
+    ob_lit(&parts[0], "\"\n\n");
+    cgen_program(&module->ast, &parts[2]);
+    cgen_literals(&module->ast, &parts[1]);
+    cgen_prototypes(&module->ast, &header);
+    cgen_inline_definitions(&module->ast, &inl[1]);
+    cgen_literals(&module->ast, &inl[0]);
+
+    if (!ob_write_file(module->c_path, parts, 3)) {
+        PRINT_ERR("could not write '%s'\n", module->c_path);
+        module->ok = false;
+    } else if (!ob_write_file(module->h_path, &header, 1)) {
+        PRINT_ERR("could not write '%s'\n", module->h_path);
+        module->ok = false;
+    } else if (!ob_write_file(module->inl_path, inl, 2)) {
+        PRINT_ERR("could not write '%s'\n", module->inl_path);
+        module->ok = false;
+    } else {
+        module->generated = true;
+    }
+    ob_free(&parts[0]);
+    ob_free(&parts[1]);
+    ob_free(&parts[2]);
+    ob_free(&header);
+    ob_free(&inl[0]);
+    ob_free(&inl[1]);
+}
+
+// Functions are visible to every module, so a name may be defined in only
+// one of them. Works from the summaries, so cached modules are checked too.
+// Returns the number of names defined twice.
+int check_duplicate_functions(struct Build *build) {
+    struct Scope functions;
+    scope_init(&functions, NULL);
+    int errors = 0;
+    for (int m = 0; m < build->count; m++) {
+        const struct Summary *summary = &build->modules[m].summary;
+        for (uint32_t f = 0; f < summary->fn_count; f++) {
+            Sym name = summary->fns[f].name;
+            struct Symbol *first = scope_lookup(&functions, name);
+            if (!first) {
+                scope_define(&functions, name, SYMBOL_FUNCTION, m);
+            } else if ((int)first->decl != m) {
+                // within one module sema has reported it already
+                PRINT_ERR("function '%s' is defined in both '%s' and '%s'\n", sym_str(name),
+                          build->modules[first->decl].path, build->modules[m].path);
+                errors++;
+            }
+        }
+    }
+    scope_free(&functions);
+    return errors;
+}
 
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f);
-    rewind(f);
+// The header every module includes: C runtime includes plus the
+// prototypes of every module. Returns a hash of everything it pulls in,
+// or 0 on failure.
+uint64_t write_program_header(struct Build *build) {
+    struct OutBuf out;
+    ob_init(&out);
+    write_c_header(&out);
+    ob_putc(&out, '\n');
+    for (int i = 0; i < build->count; i++) {
+        ob_lit(&out, "#include \"");
+        ob_puts(&out, strrchr(build->modules[i].h_path, '/') + 1);
+        ob_lit(&out, "\"\n");
+    }
+    // inline bodies come after all prototypes, so they can call anything
+    for (int i = 0; i < build->count; i++) {
+        ob_lit(&out, "#include \"");
+        ob_puts(&out, strrchr(build->modules[i].inl_path, '/') + 1);
+        ob_lit(&out, "\"\n");
+    }
+    bool written = ob_write_file(build->header_path, &out, 1);
+    ob_free(&out);
+    if (!written) {
+        PRINT_ERR("could not write '%s'\n", build->header_path);
+        return 0;
+    }
 
-    char *buf = malloc(size + 1);
+    uint64_t hash = hash_file(build->header_path);
+    for (int i = 0; i < build->count; i++) {
+        hash = hash_combine(hash, hash_file(build->modules[i].h_path));
+        hash = hash_combine(hash, hash_file(build->modules[i].inl_path));
+    }
+    return hash ? hash : 1;
+}
 
-    fread(buf, 1, size, f);
-    buf[size] = '\0';
-    fclose(f);
-    return buf;
+void usage(const char *prog) {
+    printf(
+        "usage: %s [options] file.gl... (- reads standard input)\n"
+        "  -O0 -O1 -O2 -O3 -Os   optimization level for the C compiler (default -O0)\n"
+        "  --release             build with -O2 -march=native -flto\n"
+        "  --no-bounds-check     leave out the array bounds checks gart can't prove away\n"
+        "  --cc <compiler>       C compiler to use (default $CC or gcc)\n"
+        "  --cflag <flag>        extra flag for the C compiler, may be repeated\n"
+        "  -j <n>                number of threads and C compiler jobs (default: all cores)\n"
+        "  -o <file>             executable to produce (default out/out.exe)\n"
+        "  -v                    print the C compiler commands\n"
+        "  --rebuild             ignore the build cache and rebuild everything\n",
+        prog
+    );
 }
 
 int main(int argc, char *argv[]) {
-    char *source = read_file(argv[1]);
-    if (!source) return 1;
+    intern_init();
+
+    struct CcOptions cc;
+    cc_options_init(&cc);
+    cc.jobs = cpu_count();
+    if (getenv("CC") && *getenv("CC")) cc.cc = getenv("CC");
+
+    struct Build build = {0};
+    build.modules = calloc(argc, sizeof(struct Module));
+    build.header_path = "out/gart_program.h";
+    build.use_cache = true;
+    const char *exe = "out/out.exe";
+    const char *opt_level = "-O0";
+    bool release = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg[0] == '-' && arg[1] == 'O') {
+            opt_level = arg;
+        } else if (strcmp(arg, "--release") == 0) {
+            release = true;
+        } else if (strcmp(arg, "--no-bounds-check") == 0) {
+            // a compile flag, so it takes part in the cache key like any other
+            cc_add_flag(&cc, "-DGART_NO_BOUNDS_CHECK");
+        } else if (strcmp(arg, "--cc") == 0 && has_value) {
+            cc.cc = argv[++i];
+        } else if (strcmp(arg, "--cflag") == 0 && has_value) {
+            cc_add_flag(&cc, argv[++i]);
+        } else if (strcmp(arg, "-j") == 0 && has_value) {
+            cc.jobs = atoi(argv[++i]);
+        } else if (strncmp(arg, "-j", 2) == 0 && arg[2]) {
+            cc.jobs = atoi(arg + 2);
+        } else if (strcmp(arg, "-o") == 0 && has_value) {
+            exe = argv[++i];
+        } else if (strcmp(arg, "-v") == 0) {
+            cc.verbose = true;
+        } else if (strcmp(arg, "--rebuild") == 0) {
+            build.use_cache = false;
+        } else if (arg[0] == '-' && arg[1]) {
+            PRINT_ERR("unknown option '%s'\n", arg);
+            usage(argv[0]);
+            return 1;
+        } else {
+            build.modules[build.count++].path = arg;
+        }
+    }
+    if (build.count == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (cc.jobs < 1) cc.jobs = 1;
+
+    if (release) {
+        cc_add_flag(&cc, "-O2");
+        cc_add_flag(&cc, "-march=native");
+        cc_add_flag(&cc, "-flto");
+    } else {
+        cc_add_flag(&cc, opt_level);
+    }
+    // the 'omp simd' pragmas of 'simd for' loops, without the OpenMP runtime
+    cc_add_flag(&cc, "-fopenmp-simd");
+
+    // the scheduler behind 'spawn' and 'parallel for' is linked into every program
+    char *runtime_dir = exe_dir(argv[0]);
+    char *runtime_header = path_join(runtime_dir, "gart_rt.h");
+    char *runtime_lib = path_join(runtime_dir, "libgart_rt.a");
+    if (!file_exists(runtime_header) || !file_exists(runtime_lib)) {
+        PRINT_ERR("runtime not found: '%s' and '%s' are built by make\n", runtime_header, runtime_lib);
+        return 1;
+    }
+    char *include_flag = malloc(strlen(runtime_dir) + 3);
+    sprintf(include_flag, "-I%s", runtime_dir);
+    cc_add_flag(&cc, include_flag);
+    cc_add_ldflag(&cc, runtime_lib);
+    cc_add_ldflag(&cc, "-pthread");
+
     make_dir("out");
-    FILE *out = fopen("out/out.c", "w");
-    char *string_store = malloc(0x10000);
-    stb_lexer lex;
-    stb_c_lexer_init(&lex, source, source + strlen(source), string_store, 0x10000);
-
-    write_c_header(out);
-    parse_program(&lex, out);
-    fclose(out);
-    /*int status = */system("gcc out/out.c -o out/out.exe");
-    free(string_store);
-    free(source);
-    return 0;
-}
\ No newline at end of file
+    for (int i = 0; i < build.count; i++) {
+        build.modules[i].c_path = module_output_path(&build, i, ".c");
+        build.modules[i].h_path = module_output_path(&build, i, ".h");
+        build.modules[i].inl_path = module_output_path(&build, i, ".inl");
+        build.modules[i].o_path = module_output_path(&build, i, ".o");
+    }
+    // what gart emits and links against changes with every rebuild of gart
+    // or its runtime, so the cache is keyed by their contents as well as
+    // the version
+    char *gart_exe = exe_path(argv[0]);
+    uint64_t runtime_hash = hash_combine(hash_file(runtime_header), hash_file(runtime_lib));
+    char version[64];
+    snprintf(version, sizeof(version), "%s-%016llx", GART_VERSION,
+             (unsigned long long)hash_combine(hash_file(gart_exe), runtime_hash));
+    free(gart_exe);
+    if (build.use_cache) {
+        cache_load(&build.cache, CACHE_PATH, version);
+    }
+
+    // front end: every module is read, hashed and (if needed) parsed on
+    // its own thread
+    parallel_for(build.count, cc.jobs, scan_module, &build);
+    int status = 0;
+    for (int i = 0; i < build.count; i++) {
+        if (!build.modules[i].ok) status = 1;
+    }
+    if (status == 0 && check_duplicate_functions(&build) > 0) status = 1;
+
+    // what main can reach decides what each module emits
+    if (status == 0) {
+        const struct Summary **summaries = malloc(build.count * sizeof(struct Summary *));
+        bool **live = malloc(build.count * sizeof(bool *));
+        for (int i = 0; i < build.count; i++) {
+            build.modules[i].live = calloc(build.modules[i].summary.fn_count + 1, sizeof(bool));
+            summaries[i] = &build.modules[i].summary;
+            live[i] = build.modules[i].live;
+        }
+        dce_reachable(summaries, build.count, live);
+        free(summaries);
+        free(live);
+
+        scope_init(&build.signatures, NULL);
+        for (int i = 0; i < build.count; i++) {
+            types_add_module(&build.signatures, &build.modules[i].summary);
+        }
+        types_add_libc(&build.signatures);
+
+        for (int i = 0; i < build.count; i++) {
+            struct Module *module = &build.modules[i];
+            module->emit_hash = hash_combine(dce_live_hash(&module->summary, module->live),
+                                             types_callee_hash(&module->summary, &build.signatures));
+            struct CacheEntry *entry = build.use_cache ? cache_find(&build.cache, module->c_path) : NULL;
+            module->emit = module->parsed || !entry || entry->emit_hash != module->emit_hash;
+        }
+        parallel_for(build.count, cc.jobs, emit_module, &build);
+        for (int i = 0; i < build.count; i++) {
+            if (!build.modules[i].ok) status = 1;
+        }
+    }
+
+    uint64_t program_hash = 0;
+    if (status == 0) {
+        program_hash = write_program_header(&build);
+        if (program_hash == 0) status = 1;
+    }
+
+    // an object is current when its source, every prototype it can see
+    // and the compiler configuration are unchanged
+    uint64_t config_hash = hash_str(cc.cc, hash_str(version, 0));
+    for (int f = 0; f < cc.flag_count; f++) {
+        config_hash = hash_str(cc.flags[f], config_hash);
+    }
+
+    const char **sources = malloc(build.count * sizeof(char *));
+    const char **objects = malloc(build.count * sizeof(char *));
+    int compile_count = 0;
+    uint64_t link_key = hash_str(exe, config_hash);
+    for (int i = 0; i < build.count; i++) {
+        struct Module *module = &build.modules[i];
+        module->obj_key = hash_combine(hash_combine(hash_combine(module->src_hash, module->emit_hash), program_hash),
+                                       config_hash);
+        link_key = hash_combine(link_key, module->obj_key);
+
+        struct CacheEntry *entry = build.use_cache ? cache_find(&build.cache, module->c_path) : NULL;
+        module->compile = module->generated || !entry || entry->obj_key != module->obj_key
+                          || !file_exists(module->o_path);
+        if (module->compile) {
+            sources[compile_count] = module->c_path;
+            objects[compile_count] = module->o_path;
+            compile_count++;
+        }
+    }
+    if (status == 0 && compile_count > 0 && cc_compile(&cc, sources, objects, compile_count) != 0) status = 1;
+
+    for (int i = 0; i < build.count; i++) {
+        objects[i] = build.modules[i].o_path;
+    }
+    bool relink = compile_count > 0 || !build.use_cache || build.cache.link_key != link_key || !file_exists(exe);
+    if (status == 0 && relink && cc_link(&cc, objects, build.count, exe) != 0) status = 1;
+
+    if (status == 0) {
+        for (int i = 0; i < build.count; i++) {
+            struct Module *module = &build.modules[i];
+            cache_put(&build.cache, module->c_path, module->src_hash, module->emit_hash, module->obj_key,
+                      &module->summary);
+        }
+        build.cache.link_key = link_key;
+        if (!cache_save(&build.cache, CACHE_PATH, version)) {
+            PRINT_ERR("could not write '%s'\n", CACHE_PATH);
+        }
+    }
+
+    for (int i = 0; i < build.count; i++) {
+        ast_free(&build.modules[i].ast);
+        summary_free(&build.modules[i].summary);
+        free(build.modules[i].live);
+        free(build.modules[i].c_path);
+        free(build.modules[i].h_path);
+        free(build.modules[i].inl_path);
+        free(build.modules[i].o_path);
+    }
+    cache_free(&build.cache);
+    scope_free(&build.signatures);
+    free(sources);
+    free(objects);
+    free(build.modules);
+    free(runtime_dir);
+    free(runtime_header);
+    free(runtime_lib);
+    free(include_flag);
+    return status;
+}
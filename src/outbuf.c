@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "outbuf.h"
+
+#if defined(_WIN32)
+    #include <io.h>
+    #include <fcntl.h>
+    #include <sys/stat.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/uio.h>
+#endif
+
+#define OB_INIT_CAP 0x10000
+
+void ob_init(struct OutBuf *ob) {
+    memset(ob, 0, sizeof(*ob));
+}
+
+void ob_free(struct OutBuf *ob) {
+    free(ob->data);
+    memset(ob, 0, sizeof(*ob));
+}
+
+void ob_grow(struct OutBuf *ob, size_t extra) {
+    size_t cap = ob->cap ? ob->cap : OB_INIT_CAP;
+    while (cap - ob->len < extra) cap *= 2;
+    ob->data = realloc(ob->data, cap);
+    if (!ob->data) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    ob->cap = cap;
+}
+
+void ob_uint(struct OutBuf *ob, uint64_t value) {
+    char digits[20];
+    int n = sizeof(digits);
+    do {
+        digits[--n] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    ob_write(ob, digits + n, sizeof(digits) - n);
+}
+
+void ob_int(struct OutBuf *ob, int64_t value) {
+    if (value < 0) {
+        ob_putc(ob, '-');
+        ob_uint(ob, -(uint64_t)value);
+    } else {
+        ob_uint(ob, value);
+    }
+}
+
+void ob_double(struct OutBuf *ob, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bool negative = bits >> 63;
+    int exponent = (int)((bits >> 52) & 0x7ff);
+    uint64_t mantissa = bits & ((1ULL << 52) - 1);
+
+    if (exponent == 0x7ff) {
+        if (mantissa) {
+            ob_lit(ob, "(0.0 / 0.0)");
+        } else {
+            if (negative) ob_lit(ob, "(-1.0 / 0.0)");
+            else ob_lit(ob, "(1.0 / 0.0)");
+        }
+        return;
+    }
+
+    if (negative) ob_putc(ob, '-');
+    double magnitude = negative ? -value : value;
+    if (magnitude < 9007199254740992.0 && magnitude == (double)(uint64_t)magnitude) {
+        ob_uint(ob, (uint64_t)magnitude);
+        ob_lit(ob, ".0");
+        return;
+    }
+
+    static const char hex[] = "0123456789abcdef";
+    if (exponent) ob_lit(ob, "0x1");
+    else ob_lit(ob, "0x0");
+    if (mantissa) {
+        ob_putc(ob, '.');
+        for (int shift = 48; shift >= 0 && mantissa; shift -= 4) {
+            ob_putc(ob, hex[(mantissa >> shift) & 0xf]);
+            mantissa &= (1ULL << shift) - 1;
+        }
+    }
+    ob_putc(ob, 'p');
+    ob_int(ob, exponent ? exponent - 1023 : -1022);
+}
+
+bool ob_write_file(const char *path, const struct OutBuf *parts, int count) {
+#if defined(_WIN32)
+    int fd = _open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+    if (fd < 0) return false;
+    for (int i = 0; i < count; i++) {
+        const char *p = parts[i].data;
+        size_t left = parts[i].len;
+        while (left > 0) {
+            int n = _write(fd, p, left > 0x40000000 ? 0x40000000 : (unsigned)left);
+            if (n <= 0) {
+                _close(fd);
+                return false;
+            }
+            p += n;
+            left -= n;
+        }
+    }
+    return _close(fd) == 0;
+#else
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+
+    struct iovec iov[16];
+    int done = 0;       // parts fully written
+    size_t offset = 0;  // bytes of parts[done] already written
+    for (;;) {
+        while (done < count && parts[done].len == offset) {
+            done++;
+            offset = 0;
+        }
+        if (done == count) break;
+
+        int n = 0;
+        for (int i = done; i < count && n < 16; i++) {
+            size_t skip = i == done ? offset : 0;
+            if (parts[i].len == skip) continue;
+            iov[n].iov_base = parts[i].data + skip;
+            iov[n].iov_len = parts[i].len - skip;
+            n++;
+        }
+        ssize_t written = writev(fd, iov, n);
+        if (written <= 0) {
+            close(fd);
+            return false;
+        }
+        while ((size_t)written > 0) {
+            size_t left = parts[done].len - offset;
+            if ((size_t)written < left) {
+                offset += written;
+                break;
+            }
+            written -= left;
+            done++;
+            offset = 0;
+        }
+    }
+    return close(fd) == 0;
+#endif
+}
@@ -0,0 +1,49 @@
+#ifndef OUTBUF_H
+#define OUTBUF_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Append-only byte buffer for generated code. Formatting is done by hand
+// (no format strings) and a finished file goes out in one writev.
+struct OutBuf {
+    char  *data;
+    size_t len;
+    size_t cap;
+};
+
+void ob_init(struct OutBuf *ob);
+void ob_free(struct OutBuf *ob);
+void ob_grow(struct OutBuf *ob, size_t extra);
+
+static inline void ob_write(struct OutBuf *ob, const char *str, size_t len) {
+    if (ob->cap - ob->len < len) ob_grow(ob, len);
+    memcpy(ob->data + ob->len, str, len);
+    ob->len += len;
+}
+
+static inline void ob_putc(struct OutBuf *ob, char c) {
+    if (ob->len == ob->cap) ob_grow(ob, 1);
+    ob->data[ob->len++] = c;
+}
+
+// String literals only: the length is taken at compile time.
+#define ob_lit(ob, lit) ob_write((ob), (lit), sizeof(lit) - 1)
+
+static inline void ob_puts(struct OutBuf *ob, const char *str) {
+    ob_write(ob, str, strlen(str));
+}
+
+void ob_int(struct OutBuf *ob, int64_t value);
+void ob_uint(struct OutBuf *ob, uint64_t value);
+
+// Exact C literal for `value`: integral values as "N.0", everything else
+// as a C99 hexadecimal float, so nothing is lost to decimal rounding.
+void ob_double(struct OutBuf *ob, double value);
+
+// Writes the concatenation of `parts` to `path`, replacing the file.
+bool ob_write_file(const char *path, const struct OutBuf *parts, int count);
+
+#endif // OUTBUF_H
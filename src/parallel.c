@@ -0,0 +1,498 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "common.h"
+#include "parallel.h"
+
+enum {
+    MARK_INSIDE = 1 << 0,   // variable declared in the loop
+    MARK_SHARED = 1 << 1,   // array reached other than by a proven index
+    MARK_READ   = 1 << 2,   // variable from outside the loop read in it
+    MARK_USED   = 1 << 3,   // variable from outside the loop named in it
+};
+
+// An element the body reaches by a proven index, maybe through its pointer.
+struct Access {
+    NodeId index;
+    Sym    field;   // the field taken of a soa array's element
+};
+
+struct Reduction {
+    NodeId decl;
+    int    op;
+};
+
+struct Loop {
+    struct Ast       *ast;
+    NodeId            counter;
+    bool              simd;
+    const char       *what;     // "simd for" or "parallel for"
+    uint8_t          *marks;    // MARK_ bits, by node
+    struct Access    *accesses;
+    int               access_count;
+    int               access_cap;
+    struct Reduction *reductions;
+    int               reduction_count;
+    int               reduction_cap;
+    int               errors;
+};
+
+// OpenMP reduces a variable by one operator; a subtraction adds the negation.
+static const int reduction_ops[] = {
+    [OP_ADD] = OP_ADD, [OP_SUB] = OP_ADD, [OP_MUL] = OP_MUL,
+    [OP_BITAND] = OP_BITAND, [OP_BITXOR] = OP_BITXOR, [OP_BITOR] = OP_BITOR,
+};
+
+static void *grow(void *items, int count, int *cap, size_t size) {
+    if (count < *cap) return items;
+    *cap = *cap ? *cap * 2 : 8;
+    items = realloc(items, *cap * size);
+    if (!items) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    return items;
+}
+
+// An index the bounds pass proved, into an array variable from outside the
+// loop. Strings keep their bytes inline or not, so have no pointer to hoist.
+static bool hoistable(struct Loop *l, NodeId index) {
+    struct Node *node = AST_NODE(l->ast, index);
+    struct Node *array = AST_NODE(l->ast, node->lhs);
+    return (node->flags & NODE_UNCHECKED) && array->type == TYPE_SLICE && array->kind == NODE_IDENT && array->rhs
+           && !(l->marks[array->rhs] & MARK_INSIDE);
+}
+
+static bool soa_array(struct Ast *ast, NodeId array) {
+    struct Node *node = AST_NODE(ast, array);
+    return node->elem == TYPE_STRUCT && (AST_NODE(ast, ast->records[node->record])->flags & NODE_SOA);
+}
+
+static void add_access(struct Loop *l, NodeId index, Sym field) {
+    l->marks[AST_NODE(l->ast, AST_NODE(l->ast, index)->lhs)->rhs] |= MARK_USED;
+    l->accesses = grow(l->accesses, l->access_count, &l->access_cap, sizeof(struct Access));
+    l->accesses[l->access_count++] = (struct Access){ index, field };
+}
+
+// A vec or map from outside the loop can't grow or shrink under the
+// iterations running beside this one.
+static void check_change(struct Loop *l, NodeId container) {
+    struct Node *node = AST_NODE(l->ast, container);
+    if (node->kind == NODE_IDENT && node->rhs && !(l->marks[node->rhs] & MARK_INSIDE)) {
+        PRINT_ERR("'%s' changes %s '%s', declared outside the loop\n", l->what,
+                  node->type == TYPE_VEC ? "vec" : "map", sym_str(node->name));
+        l->errors++;
+    }
+}
+
+static void loop_expr(struct Loop *l, NodeId id) {
+    struct Ast *ast = l->ast;
+    struct Node *node = AST_NODE(ast, id);
+    switch (node->kind) {
+        case NODE_IDENT:
+            if (node->rhs && !(l->marks[node->rhs] & MARK_INSIDE)) {
+                l->marks[node->rhs] |= MARK_USED;
+                l->marks[node->rhs] |= AST_NODE(ast, node->rhs)->type == TYPE_SLICE ? MARK_SHARED : MARK_READ;
+            }
+            break;
+        case NODE_CALL:
+            if (l->simd && (node->flags & NODE_SPAWN)) {
+                PRINT_ERR("'spawn' inside a 'simd for'\n");
+                l->errors++;
+            }
+            if (node->op == BUILTIN_PUSH || node->op == BUILTIN_POP || node->op == BUILTIN_DEL) {
+                check_change(l, node->lhs);
+                node = AST_NODE(ast, id);
+            }
+            // fall through
+        case NODE_ARRAY:
+        case NODE_CONSTRUCT:
+            for (NodeId arg = node->lhs; arg; arg = AST_NODE(ast, arg)->next) {
+                loop_expr(l, arg);
+            }
+            break;
+        case NODE_UNARY:
+        case NODE_CAST:
+        case NODE_ARRAY_NEW:
+            loop_expr(l, node->lhs);
+            break;
+        case NODE_LEN:
+            // the length travels with the slice, no element is reached
+            if (AST_NODE(ast, node->lhs)->kind == NODE_IDENT && AST_NODE(ast, node->lhs)->rhs) {
+                NodeId decl = AST_NODE(ast, node->lhs)->rhs;
+                if (!(l->marks[decl] & MARK_INSIDE)) l->marks[decl] |= MARK_USED;
+            } else {
+                loop_expr(l, node->lhs);
+            }
+            break;
+        case NODE_MEMBER: {
+            struct Node *element = AST_NODE(ast, node->lhs);
+            if (element->kind == NODE_INDEX && soa_array(ast, element->lhs) && hoistable(l, node->lhs)) {
+                add_access(l, node->lhs, node->name);
+                loop_expr(l, element->rhs);
+            } else {
+                loop_expr(l, node->lhs);
+            }
+            break;
+        }
+        case NODE_INDEX:
+            // a whole soa element is gathered from every field, through the array
+            if (!soa_array(ast, node->lhs) && hoistable(l, id)) {
+                add_access(l, id, 0);
+            } else {
+                loop_expr(l, node->lhs);
+            }
+            loop_expr(l, node->rhs);
+            break;
+        case NODE_BINARY:
+            loop_expr(l, node->lhs);
+            loop_expr(l, node->rhs);
+            break;
+        case NODE_SLICE:
+            loop_expr(l, node->lhs);
+            loop_expr(l, node->rhs);
+            if (node->alt) loop_expr(l, node->alt);
+            break;
+    }
+}
+
+static void add_reduction(struct Loop *l, NodeId decl, int op, bool field) {
+    Sym name = AST_NODE(l->ast, decl)->name;
+    int reduce = field || op >= (int)(sizeof(reduction_ops) / sizeof(reduction_ops[0])) ? OP_NONE : reduction_ops[op];
+    if (reduce == OP_NONE) {
+        PRINT_ERR("'%s' can only accumulate into '%s', declared outside the loop, with +=, -=, *=, &=, |= or ^=\n",
+                  l->what, sym_str(name));
+        l->errors++;
+        return;
+    }
+    // what C and OpenMP reduce: numbers, and for bitwise operators integers and bools
+    int type = AST_NODE(l->ast, decl)->type;
+    bool bitwise = reduce == OP_BITAND || reduce == OP_BITXOR || reduce == OP_BITOR;
+    bool integer = type == TYPE_INT || type == TYPE_INT64;
+    if (bitwise ? !integer && type != TYPE_BOOL : !integer && type != TYPE_FLOAT && type != TYPE_DOUBLE) {
+        PRINT_ERR("'%s' accumulates into '%s', which is not %s\n", l->what, sym_str(name),
+                  bitwise ? "an integer or bool" : "a number");
+        l->errors++;
+        return;
+    }
+    for (int r = 0; r < l->reduction_count; r++) {
+        if (l->reductions[r].decl != decl) continue;
+        if (l->reductions[r].op != reduce) {
+            PRINT_ERR("'%s' accumulates into '%s' with two different operators\n", l->what, sym_str(name));
+            l->errors++;
+        }
+        return;
+    }
+    l->reductions = grow(l->reductions, l->reduction_count, &l->reduction_cap, sizeof(struct Reduction));
+    l->reductions[l->reduction_count++] = (struct Reduction){ decl, reduce };
+}
+
+static void loop_assign(struct Loop *l, NodeId id) {
+    struct Ast *ast = l->ast;
+    struct Node *node = AST_NODE(ast, id);
+    NodeId base = node->lhs;
+    while (AST_NODE(ast, base)->kind == NODE_MEMBER) base = AST_NODE(ast, base)->lhs;
+    struct Node *target = AST_NODE(ast, base);
+    if (target->kind != NODE_IDENT) {
+        // an element, written through its index; a map's may be added
+        if (target->kind == NODE_INDEX && AST_NODE(ast, target->lhs)->type == TYPE_MAP) check_change(l, target->lhs);
+        loop_expr(l, node->lhs);
+    } else if (target->rhs == l->counter) {
+        PRINT_ERR("'%s' assigns its counter '%s'\n", l->what, sym_str(target->name));
+        l->errors++;
+    } else if (target->rhs && !(l->marks[target->rhs] & MARK_INSIDE)) {
+        add_reduction(l, target->rhs, node->op, base != node->lhs);
+    }
+    loop_expr(l, node->rhs);
+}
+
+// `depth` counts the loops nested in the checked one, which a 'break' may leave.
+static void loop_statements(struct Loop *l, NodeId first, int depth) {
+    struct Ast *ast = l->ast;
+    for (NodeId stmt = first; stmt; stmt = AST_NODE(ast, stmt)->next) {
+        struct Node *node = AST_NODE(ast, stmt);
+        switch (node->kind) {
+            case NODE_VARIABLE:
+                // static storage would be shared by the workers
+                if (!l->simd && (node->flags & NODE_GLOBAL)) {
+                    PRINT_ERR("gvar '%s' inside a 'parallel for'\n", sym_str(node->name));
+                    l->errors++;
+                }
+                l->marks[stmt] |= MARK_INSIDE;
+                if (node->lhs) loop_expr(l, node->lhs);
+                break;
+            case NODE_CALL:
+                loop_expr(l, stmt);
+                break;
+            case NODE_ASSIGN:
+                loop_assign(l, stmt);
+                break;
+            case NODE_RETURN:
+                PRINT_ERR("'return' inside a '%s'\n", l->what);
+                l->errors++;
+                break;
+            case NODE_BREAK:
+                if (depth == 0) {
+                    PRINT_ERR("'break' out of a '%s'\n", l->what);
+                    l->errors++;
+                }
+                break;
+            case NODE_SYNC:
+                if (l->simd) {
+                    PRINT_ERR("'sync' inside a 'simd for'\n");
+                    l->errors++;
+                }
+                break;
+            case NODE_BLOCK:
+                loop_statements(l, node->lhs, depth);
+                break;
+            case NODE_IF:
+                loop_expr(l, node->lhs);
+                loop_statements(l, node->rhs, depth);
+                if (node->alt) loop_statements(l, node->alt, depth);
+                break;
+            case NODE_WHILE:
+                loop_expr(l, node->lhs);
+                loop_statements(l, node->rhs, depth + 1);
+                break;
+            case NODE_FOR:
+                if (l->simd && (node->flags & (NODE_SIMD | NODE_PARALLEL))) {
+                    PRINT_ERR("'%s' inside a 'simd for'\n", node->flags & NODE_SIMD ? "simd for" : "parallel for");
+                    l->errors++;
+                }
+                l->marks[node->lhs] |= MARK_INSIDE;
+                loop_expr(l, AST_NODE(ast, node->lhs)->lhs);
+                for (NodeId bound = node->alt; bound; bound = AST_NODE(ast, bound)->next) {
+                    loop_expr(l, bound);
+                }
+                loop_statements(l, node->rhs, depth + 1);
+                break;
+        }
+    }
+}
+
+static bool listed(struct Ast *ast, NodeId first, NodeId decl, Sym field) {
+    for (NodeId clause = first; clause; clause = AST_NODE(ast, clause)->next) {
+        struct Node *node = AST_NODE(ast, clause);
+        if (node->kind == NODE_MEMBER) {
+            if (node->name == field && AST_NODE(ast, node->lhs)->rhs == decl) return true;
+        } else if (node->op == OP_NONE && !field && node->rhs == decl) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static NodeId new_ident(struct Ast *ast, NodeId decl) {
+    Sym name = AST_NODE(ast, decl)->name;
+    NodeId id = ast_new(ast, NODE_IDENT);
+    AST_NODE(ast, id)->name = name;
+    AST_NODE(ast, id)->rhs = decl;
+    return id;
+}
+
+static void append(struct Ast *ast, NodeId *first, NodeId *last, NodeId clause) {
+    if (*last) {
+        AST_NODE(ast, *last)->next = clause;
+    } else {
+        *first = clause;
+    }
+    *last = clause;
+}
+
+// Module-level variables are in reach of any C function, the rest is not.
+static bool module_level(struct Ast *ast, NodeId decl) {
+    struct Node *node = AST_NODE(ast, decl);
+    if (node->kind != NODE_VARIABLE || !(node->flags & NODE_GLOBAL)) return false;
+    struct Symbol *symbol = scope_lookup(&ast->globals, node->name);
+    return symbol && symbol->decl == decl;
+}
+
+static bool reduced(struct Loop *l, NodeId decl) {
+    for (int r = 0; r < l->reduction_count; r++) {
+        if (l->reductions[r].decl == decl) return true;
+    }
+    return false;
+}
+
+// Hoisted pointers or captured variables, then the reductions, once the
+// body checked out.
+static void list_clauses(struct Loop *l) {
+    struct Ast *ast = l->ast;
+    NodeId first = 0, last = 0;
+    if (l->simd) {
+        for (int a = 0; a < l->access_count; a++) {
+            NodeId index = l->accesses[a].index;
+            Sym field = l->accesses[a].field;
+            NodeId decl = AST_NODE(ast, AST_NODE(ast, index)->lhs)->rhs;
+            // writing an element behind the pointer's back breaks its restrict
+            if (l->marks[decl] & MARK_SHARED) continue;
+            AST_NODE(ast, index)->flags |= NODE_RESTRICT;
+            if (listed(ast, first, decl, field)) continue;
+            NodeId clause = new_ident(ast, decl);
+            if (field) {
+                NodeId member = ast_new(ast, NODE_MEMBER);
+                AST_NODE(ast, member)->name = field;
+                AST_NODE(ast, member)->lhs = clause;
+                clause = member;
+            }
+            append(ast, &first, &last, clause);
+        }
+    } else {
+        uint32_t count = ast->node_count;
+        for (NodeId decl = 1; decl < count; decl++) {
+            if ((l->marks[decl] & MARK_USED) && !module_level(ast, decl) && !reduced(l, decl)) {
+                append(ast, &first, &last, new_ident(ast, decl));
+            }
+        }
+    }
+    for (int r = 0; r < l->reduction_count; r++) {
+        NodeId clause = new_ident(ast, l->reductions[r].decl);
+        AST_NODE(ast, clause)->op = l->reductions[r].op;
+        append(ast, &first, &last, clause);
+    }
+    AST_NODE(ast, l->counter)->rhs = first;
+}
+
+static int prepare_loop(struct Ast *ast, NodeId loop) {
+    struct Node *node = AST_NODE(ast, loop);
+    struct Node *var = AST_NODE(ast, node->lhs);
+    NodeId step = AST_NODE(ast, node->alt)->next;
+    const char *what = node->flags & NODE_SIMD ? "simd for" : "parallel for";
+    if (var->type != TYPE_INT && var->type != TYPE_INT64) {
+        PRINT_ERR("'%s' needs an integer counter, '%s' is not one\n", what, sym_str(var->name));
+        return 1;
+    }
+    if (step && (AST_NODE(ast, step)->kind != NODE_INT || AST_NODE(ast, step)->int_value == 0)) {
+        PRINT_ERR("'%s' needs a constant step other than 0\n", what);
+        return 1;
+    }
+
+    struct Loop l = { .ast = ast, .counter = node->lhs, .simd = node->flags & NODE_SIMD, .what = what };
+    // the marks cover the nodes there are now; clauses added later are never looked up
+    l.marks = calloc(ast->node_count, 1);
+    if (!l.marks) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    l.marks[l.counter] |= MARK_INSIDE;
+    loop_statements(&l, node->rhs, 0);
+    // each lane or worker keeps a partial result, which the body must not look at
+    for (int r = 0; r < l.reduction_count; r++) {
+        if (l.marks[l.reductions[r].decl] & MARK_READ) {
+            PRINT_ERR("'%s' reads '%s', which it accumulates into\n", what,
+                      sym_str(AST_NODE(ast, l.reductions[r].decl)->name));
+            l.errors++;
+        }
+    }
+    if (l.errors == 0) list_clauses(&l);
+
+    free(l.marks);
+    free(l.accesses);
+    free(l.reductions);
+    return l.errors;
+}
+
+static bool spawned(struct Ast *ast, NodeId id) {
+    return id && AST_NODE(ast, id)->kind == NODE_CALL && (AST_NODE(ast, id)->flags & NODE_SPAWN);
+}
+
+// Whether `decl` lives until `func` syncs before returning.
+static bool outlives_tasks(struct Ast *ast, NodeId func, NodeId decl) {
+    struct Node *node = AST_NODE(ast, decl);
+    if (node->kind == NODE_PARAM || (node->flags & NODE_GLOBAL)) return true;
+    for (NodeId stmt = AST_NODE(ast, func)->lhs; stmt; stmt = AST_NODE(ast, stmt)->next) {
+        if (stmt == decl) return true;
+    }
+    return false;
+}
+
+static int check_spawn_target(struct Ast *ast, NodeId func, NodeId owner, NodeId decl) {
+    if (owner == func && outlives_tasks(ast, func, decl)) return 0;
+    PRINT_ERR("'spawn' stores into '%s', which may be gone before its task ends: "
+              "declare it at the top of the function\n", sym_str(AST_NODE(ast, decl)->name));
+    return 1;
+}
+
+// Finds the loops to prepare and the spawns in a function. `owner` is the
+// function or 'parallel for' whose C function the statements end up in.
+static int prepare_statements(struct Ast *ast, NodeId func, NodeId owner, NodeId first) {
+    int errors = 0;
+    for (NodeId stmt = first; stmt; stmt = AST_NODE(ast, stmt)->next) {
+        struct Node *node = AST_NODE(ast, stmt);
+        switch (node->kind) {
+            case NODE_CALL:
+                if (node->flags & NODE_SPAWN) AST_NODE(ast, owner)->flags |= NODE_TASKS;
+                break;
+            case NODE_VARIABLE:
+                if (spawned(ast, node->lhs)) {
+                    AST_NODE(ast, owner)->flags |= NODE_TASKS;
+                    errors += check_spawn_target(ast, func, owner, stmt);
+                }
+                break;
+            case NODE_ASSIGN:
+                if (spawned(ast, node->rhs)) {
+                    AST_NODE(ast, owner)->flags |= NODE_TASKS;
+                    errors += check_spawn_target(ast, func, owner, AST_NODE(ast, node->lhs)->rhs);
+                }
+                break;
+            case NODE_BLOCK:
+                errors += prepare_statements(ast, func, owner, node->lhs);
+                break;
+            case NODE_IF:
+                errors += prepare_statements(ast, func, owner, node->rhs);
+                if (node->alt) errors += prepare_statements(ast, func, owner, node->alt);
+                break;
+            case NODE_WHILE:
+                errors += prepare_statements(ast, func, owner, node->rhs);
+                break;
+            case NODE_FOR:
+                if (node->flags & (NODE_SIMD | NODE_PARALLEL)) errors += prepare_loop(ast, stmt);
+                node = AST_NODE(ast, stmt);
+                errors += prepare_statements(ast, func, node->flags & NODE_PARALLEL ? stmt : owner, node->rhs);
+                break;
+        }
+    }
+    return errors;
+}
+
+// Flags the returns and 'sync's that wait on the tasks of an owner that
+// has some; a 'parallel for' body belongs to the loop.
+static void flag_syncs(struct Ast *ast, NodeId first, bool tasks) {
+    for (NodeId stmt = first; stmt; stmt = AST_NODE(ast, stmt)->next) {
+        struct Node *node = AST_NODE(ast, stmt);
+        switch (node->kind) {
+            case NODE_RETURN:
+            case NODE_SYNC:
+                if (tasks) node->flags |= NODE_TASKS;
+                break;
+            case NODE_BLOCK:
+                flag_syncs(ast, node->lhs, tasks);
+                break;
+            case NODE_IF:
+                flag_syncs(ast, node->rhs, tasks);
+                if (node->alt) flag_syncs(ast, node->alt, tasks);
+                break;
+            case NODE_WHILE:
+                flag_syncs(ast, node->rhs, tasks);
+                break;
+            case NODE_FOR:
+                flag_syncs(ast, node->rhs, node->flags & NODE_PARALLEL ? (node->flags & NODE_TASKS) != 0 : tasks);
+                break;
+        }
+    }
+}
+
+int prepare_parallel(struct Ast *ast) {
+    int errors = 0;
+    for (NodeId decl = ast->first; decl; decl = AST_NODE(ast, decl)->next) {
+        struct Node *node = AST_NODE(ast, decl);
+        if (node->kind != NODE_FUNCTION || (node->flags & NODE_DEAD)) continue;
+        errors += prepare_statements(ast, decl, decl, node->lhs);
+        flag_syncs(ast, AST_NODE(ast, decl)->lhs, AST_NODE(ast, decl)->flags & NODE_TASKS);
+    }
+    ast->error_count += errors;
+    return errors;
+}
@@ -0,0 +1,33 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "ast.h"
+
+// Prepares the loops whose iterations run at the same time, and the
+// tasks started by 'spawn', for emission.
+//
+// A 'simd for' becomes an OpenMP simd loop, which gcc vectorizes without
+// proving the iterations independent, and a 'parallel for' is split into
+// ranges run by the workers of the runtime. The body of either may not
+// 'break' out of it or 'return', nor assign the counter, and may only
+// accumulate into variables from outside with one of += -= *= &= |= ^=,
+// without reading them. Nor may it push to, pop from or delete from a vec
+// or map from outside, or assign an element of such a map, which may add
+// it. What cgen needs is listed in the loop variable's rhs:
+//   IDENT, op OP_NONE   'simd for': an array whose elements the body only
+//                       reaches by proven indexes, read through a restrict
+//                       pointer; 'parallel for': a variable from outside
+//                       the body hands it by address
+//   MEMBER of an IDENT  'simd for': the same for one field of a soa array
+//   IDENT, op set       a reduction, with the operator it accumulates by
+// The indexes read through restrict pointers are flagged NODE_RESTRICT.
+//
+// A function, or a 'parallel for' body, that spawns is flagged NODE_TASKS,
+// and so are its 'sync's and returns, which wait for the tasks. A spawned call
+// may only store its result in a variable that outlives the function's
+// tasks: a parameter, a gvar, or one declared at the top of the function.
+//
+// Needs the types, so runs after infer_types; returns the number of errors.
+int prepare_parallel(struct Ast *ast);
+
+#endif // PARALLEL_H
@@ -0,0 +1,309 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "regions.h"
+#include "cgen.h"
+
+// Where the value of an expression goes: into a local variable, which
+// from then on may point wherever the value did; out of the function's
+// reach; or into a parameter, which takes it out only if the parameter
+// escapes its own function.
+enum { FLOW_INTO, FLOW_OUT, FLOW_PARAM };
+
+struct Edge {
+    NodeId param;
+    NodeId value;
+};
+
+struct Alloc {
+    NodeId func;
+    NodeId array;
+};
+
+struct Regions {
+    struct Ast   *ast;
+    NodeId       *parent;       // union-find over variables and arrays, by node
+    bool         *local;        // parameter or variable local to a function
+    bool         *escapes;      // by root of the union-find
+    struct Edge  *edges;
+    int           edge_count;
+    int           edge_cap;
+    struct Alloc *allocs;       // arrays allocated at run time, outside 'parallel for' bodies
+    int           alloc_count;
+    int           alloc_cap;
+    NodeId        func;
+    int           parallel;     // depth of 'parallel for' bodies
+};
+
+static void *grow(void *items, int count, int *cap, size_t size) {
+    if (count < *cap) return items;
+    *cap = *cap ? *cap * 2 : 16;
+    items = realloc(items, *cap * size);
+    if (!items) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    return items;
+}
+
+static NodeId find(struct Regions *r, NodeId id) {
+    while (r->parent[id] != id) {
+        r->parent[id] = r->parent[r->parent[id]];
+        id = r->parent[id];
+    }
+    return id;
+}
+
+static void unite(struct Regions *r, NodeId a, NodeId b) {
+    a = find(r, a);
+    b = find(r, b);
+    if (a == b) return;
+    r->parent[a] = b;
+    r->escapes[b] |= r->escapes[a];
+}
+
+static void reach(struct Regions *r, NodeId id, int how, NodeId to) {
+    switch (how) {
+        case FLOW_INTO:
+            unite(r, id, to);
+            break;
+        case FLOW_OUT:
+            r->escapes[find(r, id)] = true;
+            break;
+        case FLOW_PARAM:
+            r->edges = grow(r->edges, r->edge_count, &r->edge_cap, sizeof(struct Edge));
+            r->edges[r->edge_count++] = (struct Edge){ to, id };
+            break;
+    }
+}
+
+static bool holds_pointer(int type) {
+    return type == TYPE_SLICE || type == TYPE_STRUCT || type == TYPE_STR || type == TYPE_POINTER
+        || type == TYPE_VEC || type == TYPE_MAP;
+}
+
+// Sends the variables and arrays the value of `id` may point into where
+// `how` says. A number points nowhere, whatever it was computed from.
+static void flow(struct Regions *r, NodeId id, int how, NodeId to) {
+    struct Node *node = AST_NODE(r->ast, id);
+    if (!holds_pointer(node->type)) return;
+    switch (node->kind) {
+        case NODE_IDENT:
+            if (node->rhs && r->local[node->rhs]) reach(r, node->rhs, how, to);
+            break;
+        case NODE_ARRAY_NEW:
+            reach(r, id, how, to);
+            break;
+        case NODE_ARRAY:
+            reach(r, id, how, to);
+            // fall through
+        case NODE_CALL:
+        case NODE_CONSTRUCT:
+            // what a call returns may be one of its arguments
+            for (NodeId arg = node->lhs; arg; arg = AST_NODE(r->ast, arg)->next) {
+                flow(r, arg, how, to);
+            }
+            break;
+        case NODE_UNARY:
+        case NODE_CAST:
+        case NODE_INDEX:
+        case NODE_SLICE:
+        case NODE_MEMBER:
+            flow(r, node->lhs, how, to);
+            break;
+        case NODE_BINARY:
+            flow(r, node->lhs, how, to);
+            flow(r, node->rhs, how, to);
+            break;
+    }
+}
+
+// Finds the calls and the allocations in an expression.
+static void visit(struct Regions *r, NodeId id) {
+    struct Ast *ast = r->ast;
+    struct Node *node = AST_NODE(ast, id);
+    switch (node->kind) {
+        case NODE_CALL: {
+            if (node->op) {
+                // a builtin keeps what it pushes, and only that
+                for (NodeId arg = node->lhs; arg; arg = AST_NODE(ast, arg)->next) visit(r, arg);
+                if (AST_NODE(ast, id)->op == BUILTIN_PUSH) flow(r, AST_NODE(ast, AST_NODE(ast, id)->lhs)->next, FLOW_OUT, 0);
+                break;
+            }
+            // a function of another module, or C's, may keep anything, and
+            // a task may grow a vec or map on another thread
+            bool task = node->flags & NODE_SPAWN;
+            NodeId param = node->rhs ? AST_NODE(ast, node->rhs)->rhs : 0;
+            for (NodeId arg = node->lhs; arg; arg = AST_NODE(ast, arg)->next) {
+                visit(r, arg);
+                int type = AST_NODE(ast, arg)->type;
+                bool grows = task && (type == TYPE_VEC || type == TYPE_MAP);
+                flow(r, arg, param && !grows ? FLOW_PARAM : FLOW_OUT, param);
+                if (param) param = AST_NODE(ast, param)->next;
+            }
+            break;
+        }
+        case NODE_ARRAY:
+        case NODE_ARRAY_NEW:
+            if (r->parallel == 0 && cgen_allocates(ast, id)) {
+                r->allocs = grow(r->allocs, r->alloc_count, &r->alloc_cap, sizeof(struct Alloc));
+                r->allocs[r->alloc_count++] = (struct Alloc){ r->func, id };
+            }
+            if (node->kind == NODE_ARRAY_NEW) {
+                visit(r, node->lhs);
+                break;
+            }
+            // fall through
+        case NODE_CONSTRUCT:
+            for (NodeId element = AST_NODE(ast, id)->lhs; element; element = AST_NODE(ast, element)->next) {
+                visit(r, element);
+            }
+            break;
+        case NODE_UNARY:
+        case NODE_CAST:
+        case NODE_LEN:
+        case NODE_MEMBER:
+            visit(r, node->lhs);
+            break;
+        case NODE_INDEX:
+        case NODE_BINARY:
+            visit(r, node->lhs);
+            visit(r, AST_NODE(ast, id)->rhs);
+            break;
+        case NODE_SLICE:
+            visit(r, node->lhs);
+            visit(r, AST_NODE(ast, id)->rhs);
+            if (AST_NODE(ast, id)->alt) visit(r, AST_NODE(ast, id)->alt);
+            break;
+    }
+}
+
+// 'x = v' and 'x.f = v' keep v in the local x; anything stored in an
+// element lands in memory that may be the caller's, and so does the key
+// of a map element.
+static void assign(struct Regions *r, NodeId id) {
+    struct Ast *ast = r->ast;
+    struct Node *node = AST_NODE(ast, id);
+    NodeId value = node->rhs;
+    NodeId base = node->lhs;
+    visit(r, base);
+    visit(r, value);
+    while (AST_NODE(ast, base)->kind == NODE_MEMBER) base = AST_NODE(ast, base)->lhs;
+    struct Node *target = AST_NODE(ast, base);
+    if (target->kind == NODE_INDEX && AST_NODE(ast, target->lhs)->type == TYPE_MAP) {
+        flow(r, target->rhs, FLOW_OUT, 0);
+        target = AST_NODE(ast, base);
+    }
+    if (target->kind == NODE_IDENT && target->rhs && r->local[target->rhs]) {
+        flow(r, value, FLOW_INTO, target->rhs);
+    } else {
+        flow(r, value, FLOW_OUT, 0);
+    }
+}
+
+static void walk(struct Regions *r, NodeId first) {
+    struct Ast *ast = r->ast;
+    for (NodeId stmt = first; stmt; stmt = AST_NODE(ast, stmt)->next) {
+        struct Node *node = AST_NODE(ast, stmt);
+        switch (node->kind) {
+            case NODE_VARIABLE: {
+                // a gvar keeps its value after the function returns
+                bool global = node->flags & NODE_GLOBAL;
+                r->local[stmt] = !global;
+                if (node->lhs) {
+                    visit(r, node->lhs);
+                    flow(r, AST_NODE(ast, stmt)->lhs, global ? FLOW_OUT : FLOW_INTO, stmt);
+                }
+                break;
+            }
+            case NODE_CALL:
+                visit(r, stmt);
+                break;
+            case NODE_ASSIGN:
+                assign(r, stmt);
+                break;
+            case NODE_RETURN:
+                if (node->lhs) {
+                    visit(r, node->lhs);
+                    flow(r, AST_NODE(ast, stmt)->lhs, FLOW_OUT, 0);
+                }
+                break;
+            case NODE_BLOCK:
+                walk(r, node->lhs);
+                break;
+            case NODE_IF:
+                visit(r, node->lhs);
+                walk(r, AST_NODE(ast, stmt)->rhs);
+                if (AST_NODE(ast, stmt)->alt) walk(r, AST_NODE(ast, stmt)->alt);
+                break;
+            case NODE_WHILE:
+                visit(r, node->lhs);
+                walk(r, AST_NODE(ast, stmt)->rhs);
+                break;
+            case NODE_FOR: {
+                bool parallel = node->flags & NODE_PARALLEL;
+                r->local[node->lhs] = true;
+                visit(r, AST_NODE(ast, node->lhs)->lhs);
+                for (NodeId bound = node->alt; bound; bound = AST_NODE(ast, bound)->next) {
+                    visit(r, bound);
+                }
+                r->parallel += parallel;
+                walk(r, AST_NODE(ast, stmt)->rhs);
+                r->parallel -= parallel;
+                break;
+            }
+        }
+    }
+}
+
+void plan_regions(struct Ast *ast) {
+    struct Regions r = { .ast = ast };
+    uint32_t count = ast->node_count;
+    r.parent = malloc(count * sizeof(NodeId));
+    r.local = calloc(count, sizeof(bool));
+    r.escapes = calloc(count, sizeof(bool));
+    if (!r.parent || !r.local || !r.escapes) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    for (uint32_t id = 0; id < count; id++) r.parent[id] = id;
+
+    for (NodeId decl = ast->first; decl; decl = AST_NODE(ast, decl)->next) {
+        struct Node *node = AST_NODE(ast, decl);
+        if (node->kind != NODE_FUNCTION || (node->flags & NODE_DEAD)) continue;
+        for (NodeId param = node->rhs; param; param = AST_NODE(ast, param)->next) {
+            r.local[param] = true;
+        }
+        r.func = decl;
+        walk(&r, node->lhs);
+    }
+
+    // a parameter that escapes takes along whatever was passed for it
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int e = 0; e < r.edge_count; e++) {
+            NodeId value = find(&r, r.edges[e].value);
+            if (r.escapes[find(&r, r.edges[e].param)] && !r.escapes[value]) {
+                r.escapes[value] = true;
+                changed = true;
+            }
+        }
+    }
+
+    // functions defined in the header have no arena; gart_heap it is
+    for (int a = 0; a < r.alloc_count; a++) {
+        struct Alloc alloc = r.allocs[a];
+        if (r.escapes[find(&r, alloc.array)] || (AST_NODE(ast, alloc.func)->flags & NODE_IN_HEADER)) continue;
+        AST_NODE(ast, alloc.array)->flags |= NODE_REGION;
+        AST_NODE(ast, alloc.func)->flags |= NODE_REGION;
+    }
+
+    free(r.parent);
+    free(r.local);
+    free(r.escapes);
+    free(r.edges);
+    free(r.allocs);
+}
@@ -0,0 +1,23 @@
+#ifndef REGIONS_H
+#define REGIONS_H
+
+#include "ast.h"
+
+// Finds the arrays allocated at run time that never outlive the function
+// allocating them, and flags them and the function NODE_REGION: cgen
+// allocates them from an arena of the function's own, freed all at once
+// when it returns, and everything else from the thread's gart_heap.
+//
+// The same goes for vecs and maps, which grow in the arena they were made
+// from. An array outlives its function when anything that may point into
+// it is returned, stored in a gvar, a module-level variable, an element
+// of an array or a vec or map, or passed to a function of another module,
+// or of this one that lets that parameter outlive it the same way, or, a
+// vec or map, to a spawned call. Arrays allocated in a
+// 'parallel for' body, which the workers run at the same time, never use
+// the function's arena.
+//
+// Needs the types, so runs after infer_types.
+void plan_regions(struct Ast *ast);
+
+#endif // REGIONS_H
@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "common.h"
+#include "sema.h"
+
+static int resolve_value(struct Ast *ast, struct Scope *scope, NodeId id);
+
+static int resolve_call(struct Ast *ast, struct Scope *scope, NodeId id) {
+    int errors = 0;
+    struct Symbol *symbol = scope_lookup(scope, AST_NODE(ast, id)->name);
+    if (symbol && symbol->kind == SYMBOL_FUNCTION) {
+        AST_NODE(ast, id)->rhs = symbol->decl;
+        int params = 0, args = 0;
+        for (NodeId p = AST_NODE(ast, symbol->decl)->rhs; p; p = AST_NODE(ast, p)->next) params++;
+        for (NodeId a = AST_NODE(ast, id)->lhs; a; a = AST_NODE(ast, a)->next) args++;
+        if (args != params) {
+            PRINT_ERR("'%s' takes %d argument%s, %d given\n", sym_str(AST_NODE(ast, id)->name),
+                      params, params == 1 ? "" : "s", args);
+            errors++;
+        }
+    } else if (symbol && symbol->kind == SYMBOL_STRUCT) {
+        PRINT_ERR("struct '%s' is used before its declaration\n", sym_str(AST_NODE(ast, id)->name));
+        errors++;
+    } else if (symbol) {
+        PRINT_ERR("'%s' is a variable, not a function\n", sym_str(AST_NODE(ast, id)->name));
+        errors++;
+    }
+    for (NodeId arg = AST_NODE(ast, id)->lhs; arg; arg = AST_NODE(ast, arg)->next) {
+        errors += resolve_value(ast, scope, arg);
+    }
+    return errors;
+}
+
+static int resolve_value(struct Ast *ast, struct Scope *scope, NodeId id) {
+    struct Node *node = AST_NODE(ast, id);
+    switch (node->kind) {
+        case NODE_IDENT: {
+            struct Symbol *symbol = scope_lookup(scope, node->name);
+            if (symbol && symbol->kind == SYMBOL_VARIABLE) {
+                node->rhs = symbol->decl;
+            } else if (symbol && symbol->kind == SYMBOL_FUNCTION) {
+                // passed by name, to qsort and the like
+                node->kind = NODE_FUNC_REF;
+                node->rhs = symbol->decl;
+            }
+            return 0;
+        }
+        case NODE_CALL:
+            return resolve_call(ast, scope, id);
+        case NODE_UNARY:
+        case NODE_CAST:
+        case NODE_LEN:
+        case NODE_ARRAY_NEW:
+        case NODE_MEMBER:
+            return resolve_value(ast, scope, node->lhs);
+        case NODE_BINARY:
+        case NODE_INDEX:
+            return resolve_value(ast, scope, node->lhs) + resolve_value(ast, scope, node->rhs);
+        case NODE_SLICE: {
+            NodeId end = node->alt;
+            int errors = resolve_value(ast, scope, node->lhs) + resolve_value(ast, scope, node->rhs);
+            return end ? errors + resolve_value(ast, scope, end) : errors;
+        }
+        case NODE_ARRAY:
+        case NODE_CONSTRUCT: {
+            int errors = 0;
+            for (NodeId element = node->lhs; element; element = AST_NODE(ast, element)->next) {
+                errors += resolve_value(ast, scope, element);
+            }
+            return errors;
+        }
+    }
+    return 0;
+}
+
+static int define(struct Scope *scope, struct Ast *ast, NodeId decl, int kind) {
+    Sym name = AST_NODE(ast, decl)->name;
+    if (!scope_define(scope, name, kind, decl)) {
+        PRINT_ERR("'%s' is already defined\n", sym_str(name));
+        return 1;
+    }
+    return 0;
+}
+
+static int resolve_statements(struct Ast *ast, struct Scope *scope, NodeId first, int loops);
+
+// A nested block gets its own scope: what it declares ends with it.
+static int resolve_block(struct Ast *ast, struct Scope *parent, NodeId block, int loops) {
+    struct Scope scope;
+    scope_init(&scope, parent);
+    int errors = resolve_statements(ast, &scope, AST_NODE(ast, block)->lhs, loops);
+    scope_free(&scope);
+    return errors;
+}
+
+static int resolve_assign(struct Ast *ast, struct Scope *scope, NodeId id) {
+    NodeId target = AST_NODE(ast, id)->lhs;
+    int errors = resolve_value(ast, scope, AST_NODE(ast, id)->rhs);
+    // storing into an element or a field leaves the variable itself as it was
+    if (AST_NODE(ast, target)->kind != NODE_IDENT) {
+        errors += resolve_value(ast, scope, target);
+        NodeId var = target;
+        while (AST_NODE(ast, var)->kind != NODE_IDENT) var = AST_NODE(ast, var)->lhs;
+        if (!AST_NODE(ast, var)->rhs) {
+            PRINT_ERR("assignment to %s of undeclared variable '%s'\n",
+                      AST_NODE(ast, target)->kind == NODE_INDEX ? "an element" : "a field",
+                      sym_str(AST_NODE(ast, var)->name));
+            errors++;
+        }
+        return errors;
+    }
+    Sym name = AST_NODE(ast, target)->name;
+    struct Symbol *symbol = scope_lookup(scope, name);
+    if (!symbol) {
+        PRINT_ERR("assignment to undeclared variable '%s'\n", sym_str(name));
+        return errors + 1;
+    }
+    if (symbol->kind != SYMBOL_VARIABLE) {
+        PRINT_ERR("cannot assign to '%s', it is not a variable\n", sym_str(name));
+        return errors + 1;
+    }
+    AST_NODE(ast, target)->rhs = symbol->decl;
+    AST_NODE(ast, symbol->decl)->flags |= NODE_ASSIGNED;
+    return errors;
+}
+
+static int resolve_statements(struct Ast *ast, struct Scope *scope, NodeId first, int loops) {
+    int errors = 0;
+    for (NodeId stmt = first; stmt; stmt = AST_NODE(ast, stmt)->next) {
+        struct Node *node = AST_NODE(ast, stmt);
+        switch (node->kind) {
+            case NODE_VARIABLE:
+                // the initializer can't see the variable it initializes
+                if (node->lhs) errors += resolve_value(ast, scope, node->lhs);
+                errors += define(scope, ast, stmt, SYMBOL_VARIABLE);
+                break;
+            case NODE_RETURN:
+                if (node->lhs) errors += resolve_value(ast, scope, node->lhs);
+                break;
+            case NODE_CALL:
+                errors += resolve_call(ast, scope, stmt);
+                break;
+            case NODE_ASSIGN:
+                errors += resolve_assign(ast, scope, stmt);
+                break;
+            case NODE_IF:
+                errors += resolve_value(ast, scope, node->lhs);
+                errors += resolve_block(ast, scope, AST_NODE(ast, stmt)->rhs, loops);
+                if (AST_NODE(ast, stmt)->alt) {
+                    NodeId alt = AST_NODE(ast, stmt)->alt;
+                    // an 'elif' is an if statement alone in the else branch
+                    errors += AST_NODE(ast, alt)->kind == NODE_IF
+                              ? resolve_statements(ast, scope, alt, loops)
+                              : resolve_block(ast, scope, alt, loops);
+                }
+                break;
+            case NODE_WHILE:
+                errors += resolve_value(ast, scope, node->lhs);
+                errors += resolve_block(ast, scope, AST_NODE(ast, stmt)->rhs, loops + 1);
+                break;
+            case NODE_FOR: {
+                // the loop variable is scoped to the loop and stepped by it
+                NodeId var = node->lhs;
+                struct Scope loop;
+                scope_init(&loop, scope);
+                errors += resolve_value(ast, scope, AST_NODE(ast, var)->lhs);
+                for (NodeId bound = node->alt; bound; bound = AST_NODE(ast, bound)->next) {
+                    errors += resolve_value(ast, scope, bound);
+                }
+                errors += define(&loop, ast, var, SYMBOL_VARIABLE);
+                AST_NODE(ast, var)->flags |= NODE_ASSIGNED;
+                errors += resolve_block(ast, &loop, AST_NODE(ast, stmt)->rhs, loops + 1);
+                scope_free(&loop);
+                break;
+            }
+            case NODE_BREAK:
+            case NODE_CONTINUE:
+                if (loops == 0) {
+                    PRINT_ERR("'%s' outside of a loop\n", node->kind == NODE_BREAK ? "break" : "continue");
+                    errors++;
+                }
+                break;
+        }
+    }
+    return errors;
+}
+
+static int resolve_function(struct Ast *ast, NodeId func) {
+    int errors = 0;
+    struct Scope scope;
+    scope_init(&scope, &ast->globals);
+
+    for (NodeId param = AST_NODE(ast, func)->rhs; param; param = AST_NODE(ast, param)->next) {
+        errors += define(&scope, ast, param, SYMBOL_VARIABLE);
+    }
+    errors += resolve_statements(ast, &scope, AST_NODE(ast, func)->lhs, 0);
+
+    scope_free(&scope);
+    return errors;
+}
+
+int resolve_module(struct Ast *ast) {
+    int errors = 0;
+    scope_free(&ast->globals);
+    scope_init(&ast->globals, NULL);
+
+    // module-level names are visible everywhere in the module, so they
+    // are all declared before any body is looked at
+    for (NodeId decl = ast->first; decl; decl = AST_NODE(ast, decl)->next) {
+        struct Node *node = AST_NODE(ast, decl);
+        if (node->kind == NODE_STRUCT) {
+            errors += define(&ast->globals, ast, decl, SYMBOL_STRUCT);
+        } else if (node->kind == NODE_FUNCTION) {
+            errors += define(&ast->globals, ast, decl, SYMBOL_FUNCTION);
+        } else if (node->kind == NODE_VARIABLE) {
+            errors += define(&ast->globals, ast, decl, SYMBOL_VARIABLE);
+        }
+    }
+
+    for (NodeId decl = ast->first; decl; decl = AST_NODE(ast, decl)->next) {
+        struct Node *node = AST_NODE(ast, decl);
+        if (node->kind == NODE_FUNCTION) {
+            errors += resolve_function(ast, decl);
+        } else if (node->kind == NODE_VARIABLE && node->lhs) {
+            errors += resolve_value(ast, &ast->globals, node->lhs);
+        }
+    }
+
+    ast->error_count += errors;
+    return errors;
+}
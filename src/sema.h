@@ -0,0 +1,11 @@
+#ifndef SEMA_H
+#define SEMA_H
+
+#include "ast.h"
+
+// Builds the module's scopes and binds every call and variable reference
+// to its declaration. Names that don't resolve are left for C to find
+// (libc functions, other modules). Returns the number of errors.
+int resolve_module(struct Ast *ast);
+
+#endif // SEMA_H
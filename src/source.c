@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "source.h"
+
+#if defined(_WIN32)
+    #include <io.h>
+    #include <fcntl.h>
+    #define read _read
+    #define close _close
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+#if defined(_WIN32)
+// No mapping on Windows: read the whole file into the heap.
+static bool read_all(struct Source *src, int fd) {
+    size_t cap = 0x10000, len = 0;
+    char *buf = malloc(cap);
+    if (!buf) return false;
+
+    for (;;) {
+        if (len == cap) {
+            cap *= 2;
+            char *grown = realloc(buf, cap);
+            if (!grown) {
+                free(buf);
+                return false;
+            }
+            buf = grown;
+        }
+        long n = read(fd, buf + len, (unsigned)(cap - len));
+        if (n < 0) {
+            free(buf);
+            return false;
+        }
+        if (n == 0) break;
+        len += n;
+    }
+
+    src->data = buf;
+    src->len = len;
+    return true;
+}
+#endif
+
+bool source_open(struct Source *src, const char *path) {
+    memset(src, 0, sizeof(*src));
+    src->fd = -1;
+    if (strcmp(path, "-") == 0) {
+        src->fd = 0;
+        return true;
+    }
+
+#if defined(_WIN32)
+    int fd = _open(path, _O_RDONLY | _O_BINARY);
+    if (fd < 0) return false;
+    bool ok = read_all(src, fd);
+    close(fd);
+    return ok;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        // pipes, fifos, devices: streamed by the lexer
+        src->fd = fd;
+        return true;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        src->data = "";
+        return true;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    src->data = map;
+    src->len = st.st_size;
+    src->mapped = true;
+    return true;
+#endif
+}
+
+void source_close(struct Source *src) {
+    if (src->fd > 0) {
+        close(src->fd);
+    }
+#if !defined(_WIN32)
+    if (src->mapped) {
+        munmap((void *)src->data, src->len);
+    }
+#else
+    free((void *)src->data);
+#endif
+    memset(src, 0, sizeof(*src));
+    src->fd = -1;
+}
@@ -0,0 +1,21 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// A source file. Regular files are mapped read-only and used in place:
+// `data` is not 0-terminated, `data + len` is the end of input. Stdin and
+// pipes can't be mapped and are left to the lexer to stream from `fd`.
+struct Source {
+    const char *data;
+    size_t      len;
+    bool        mapped;
+    int         fd;     // >= 0 when the input must be streamed
+};
+
+// `path` of "-" reads standard input.
+bool source_open(struct Source *src, const char *path);
+void source_close(struct Source *src);
+
+#endif // SOURCE_H
@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "symtab.h"
+
+#define SCOPE_INIT_CAP 16
+
+static uint32_t sym_hash(Sym name) {
+    return (uint32_t)((name * 0x9e3779b97f4a7c15ULL) >> 32);
+}
+
+void scope_init(struct Scope *scope, struct Scope *parent) {
+    memset(scope, 0, sizeof(*scope));
+    scope->parent = parent;
+}
+
+void scope_free(struct Scope *scope) {
+    free(scope->slots);
+    scope->slots = NULL;
+    scope->mask = 0;
+    scope->count = 0;
+}
+
+static void scope_grow(struct Scope *scope) {
+    uint32_t cap = scope->slots ? (scope->mask + 1) * 2 : SCOPE_INIT_CAP;
+    struct Symbol *slots = calloc(cap, sizeof(struct Symbol));
+    if (!slots) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    if (scope->slots) {
+        for (uint32_t i = 0; i <= scope->mask; i++) {
+            if (!scope->slots[i].name) continue;
+            uint32_t pos = sym_hash(scope->slots[i].name) & (cap - 1);
+            while (slots[pos].name) pos = (pos + 1) & (cap - 1);
+            slots[pos] = scope->slots[i];
+        }
+    }
+    free(scope->slots);
+    scope->slots = slots;
+    scope->mask = cap - 1;
+}
+
+struct Symbol *scope_define(struct Scope *scope, Sym name, int kind, uint32_t decl) {
+    if (!scope->slots || (scope->count + 1) * 4 > (scope->mask + 1) * 3) {
+        scope_grow(scope);
+    }
+    uint32_t pos = sym_hash(name) & scope->mask;
+    while (scope->slots[pos].name) {
+        if (scope->slots[pos].name == name) return NULL;
+        pos = (pos + 1) & scope->mask;
+    }
+    struct Symbol *symbol = &scope->slots[pos];
+    symbol->name = name;
+    symbol->kind = kind;
+    symbol->decl = decl;
+    scope->count++;
+    return symbol;
+}
+
+struct Symbol *scope_lookup_local(const struct Scope *scope, Sym name) {
+    if (!scope->slots) return NULL;
+    uint32_t pos = sym_hash(name) & scope->mask;
+    while (scope->slots[pos].name) {
+        if (scope->slots[pos].name == name) return &scope->slots[pos];
+        pos = (pos + 1) & scope->mask;
+    }
+    return NULL;
+}
+
+struct Symbol *scope_lookup(const struct Scope *scope, Sym name) {
+    for (; scope; scope = scope->parent) {
+        struct Symbol *symbol = scope_lookup_local(scope, name);
+        if (symbol) return symbol;
+    }
+    return NULL;
+}
@@ -0,0 +1,38 @@
+#ifndef SYMTAB_H
+#define SYMTAB_H
+
+#include <stdint.h>
+
+#include "intern.h"
+
+enum SymbolKind {
+    SYMBOL_FUNCTION,
+    SYMBOL_VARIABLE,
+    SYMBOL_STRUCT,
+};
+
+struct Symbol {
+    Sym     name;   // 0 marks an empty slot
+    uint8_t kind;
+    uint32_t decl;  // declaring node
+};
+
+// One level of lexical scope (module, function, block), an open-addressed
+// table keyed by symbol. Lookups walk outwards through the parents.
+struct Scope {
+    struct Scope  *parent;
+    struct Symbol *slots;
+    uint32_t       mask;
+    uint32_t       count;
+};
+
+void scope_init(struct Scope *scope, struct Scope *parent);
+void scope_free(struct Scope *scope);
+
+// NULL when `name` is already declared in this very scope. The returned
+// pointer stays valid until the next define in the same scope.
+struct Symbol *scope_define(struct Scope *scope, Sym name, int kind, uint32_t decl);
+struct Symbol *scope_lookup_local(const struct Scope *scope, Sym name);
+struct Symbol *scope_lookup(const struct Scope *scope, Sym name);
+
+#endif // SYMTAB_H
@@ -0,0 +1,524 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "common.h"
+#include "types.h"
+#include "hash.h"
+
+// What the generated code's standard headers declare, as far as a gart
+// variable could hold the result. size_t and time_t are taken as int64.
+static const struct {
+    const char *name;
+    int         type;
+} libc_functions[] = {
+    { "printf",  TYPE_INT },     { "println", TYPE_INT },    { "puts",    TYPE_INT },
+    { "putchar", TYPE_INT },     { "getchar", TYPE_INT },    { "rand",    TYPE_INT },
+    { "abs",     TYPE_INT },     { "atoi",    TYPE_INT },    { "strcmp",  TYPE_INT },
+    { "strncmp", TYPE_INT },     { "memcmp",  TYPE_INT },    { "system",  TYPE_INT },
+    { "labs",    TYPE_INT64 },   { "atol",    TYPE_INT64 },  { "strtol",  TYPE_INT64 },
+    { "strlen",  TYPE_INT64 },   { "time",    TYPE_INT64 },  { "clock",   TYPE_INT64 },
+    { "atof",    TYPE_DOUBLE },  { "strtod",  TYPE_DOUBLE }, { "difftime", TYPE_DOUBLE },
+    { "getenv",  TYPE_STR },     { "strdup",  TYPE_STR },    { "strcpy",  TYPE_STR },
+    { "strcat",  TYPE_STR },     { "strchr",  TYPE_STR },    { "strstr",  TYPE_STR },
+    { "malloc",  TYPE_POINTER }, { "calloc",  TYPE_POINTER }, { "realloc", TYPE_POINTER },
+    { "memcpy",  TYPE_POINTER }, { "memset",  TYPE_POINTER }, { "fopen",  TYPE_POINTER },
+};
+
+// A signature packs the return type, the element type of a returned slice
+// and whether the function is C's rather than gart's.
+#define SIG(type, elem) ((uint32_t)(type) | (uint32_t)(elem) << 8)
+#define SIG_TYPE(sig)   ((sig) & 0xff)
+#define SIG_ELEM(sig)   (((sig) >> 8) & 0xff)
+#define SIG_FOREIGN     (1u << 16)
+
+void types_add_module(struct Scope *signatures, const struct Summary *summary) {
+    for (uint32_t f = 0; f < summary->fn_count; f++) {
+        const struct FnSummary *fn = &summary->fns[f];
+        scope_define(signatures, fn->name, SYMBOL_FUNCTION, SIG(fn->type, fn->elem));
+    }
+}
+
+// Program functions come first and win over a libc name they reuse.
+void types_add_libc(struct Scope *signatures) {
+    for (size_t i = 0; i < sizeof(libc_functions) / sizeof(libc_functions[0]); i++) {
+        scope_define(signatures, intern_cstr(libc_functions[i].name), SYMBOL_FUNCTION,
+                     SIG(libc_functions[i].type, TYPE_NONE) | SIG_FOREIGN);
+    }
+}
+
+static uint32_t call_signature(const struct Scope *signatures, Sym name) {
+    struct Symbol *symbol = scope_lookup(signatures, name);
+    return symbol ? symbol->decl : SIG(TYPE_INT, TYPE_NONE) | SIG_FOREIGN;
+}
+
+// Wraps `id` in a cast to `type`, in place.
+static void wrap_cast(struct Ast *ast, NodeId id, int type) {
+    NodeId operand = ast_new(ast, NODE_NONE);
+    struct Node *cast = AST_NODE(ast, id);
+    *AST_NODE(ast, operand) = *cast;
+    AST_NODE(ast, operand)->next = 0;
+    NodeId next = cast->next;
+    memset(cast, 0, sizeof(*cast));
+    cast->kind = NODE_CAST;
+    cast->type = type;
+    cast->lhs = operand;
+    cast->next = next;
+}
+
+// C's usual arithmetic conversions, on the types gart has.
+static int arithmetic_type(int a, int b) {
+    if (a == TYPE_STR || a == TYPE_POINTER) return a;
+    if (b == TYPE_STR || b == TYPE_POINTER) return b;
+    if (a == TYPE_DOUBLE || b == TYPE_DOUBLE) return TYPE_DOUBLE;
+    if (a == TYPE_FLOAT || b == TYPE_FLOAT) return TYPE_FLOAT;
+    if (a == TYPE_INT64 || b == TYPE_INT64) return TYPE_INT64;
+    return TYPE_INT;
+}
+
+static int infer_decl(struct Ast *ast, const struct Scope *signatures, NodeId decl);
+
+// Strings join with '+' and compare by their bytes; one may also be
+// compared with null, which C functions like getenv return.
+static int string_binary(struct Ast *ast, int op, int lhs, int rhs) {
+    bool null = lhs == TYPE_POINTER || rhs == TYPE_POINTER;
+    if (op == OP_ADD && lhs == rhs) return TYPE_STR;
+    if ((op == OP_EQ || op == OP_NE) && (lhs == rhs || null)) return TYPE_BOOL;
+    if (op >= OP_LT && op <= OP_GE && lhs == rhs) return TYPE_BOOL;
+    PRINT_ERR("strings only join with '+' and compare with another string\n");
+    ast->error_count++;
+    return lhs == TYPE_STR && op == OP_ADD ? TYPE_STR : TYPE_BOOL;
+}
+
+static bool is_number(int type) {
+    return type == TYPE_INT || type == TYPE_INT64 || type == TYPE_FLOAT || type == TYPE_DOUBLE;
+}
+
+static bool is_container(int type) {
+    return type == TYPE_VEC || type == TYPE_MAP;
+}
+
+// Whether a vec or map, or a slice, holds structs.
+static bool holds_struct(int type, int elem) {
+    return type == TYPE_MAP ? MAP_VALUE(elem) == TYPE_STRUCT : elem == TYPE_STRUCT;
+}
+
+// Whether what `id` evaluates to can go where a `want` is stored: numbers
+// and bools convert into each other as in C, the rest only match.
+static bool stores_as(struct Ast *ast, NodeId id, int want, int record) {
+    struct Node *node = AST_NODE(ast, id);
+    if ((is_number(want) || want == TYPE_BOOL) && (is_number(node->type) || node->type == TYPE_BOOL)) return true;
+    return node->type == want && (want != TYPE_STRUCT || node->record == record);
+}
+
+static const char *builtin_names[] = {
+    [BUILTIN_PUSH] = "push", [BUILTIN_POP] = "pop", [BUILTIN_HAS] = "has",
+    [BUILTIN_DEL] = "del", [BUILTIN_KEYS] = "keys", [BUILTIN_VALUES] = "values",
+};
+
+static const char *builtin_usage[] = {
+    [BUILTIN_PUSH] = "a vec and a value", [BUILTIN_POP] = "a vec", [BUILTIN_HAS] = "a map and a key",
+    [BUILTIN_DEL] = "a map and a key", [BUILTIN_KEYS] = "a map", [BUILTIN_VALUES] = "a map",
+};
+
+static int infer_expr(struct Ast *ast, const struct Scope *signatures, NodeId id);
+
+// The builtin a call to a function nobody declares stands for, when its
+// first argument is a vec or map; BUILTIN_NONE for any other call.
+static int builtin_of(struct Ast *ast, const struct Scope *signatures, NodeId id) {
+    struct Node *call = AST_NODE(ast, id);
+    if (call->op || call->rhs || !call->lhs || scope_lookup(signatures, call->name)) return call->op;
+    for (int builtin = BUILTIN_PUSH; builtin <= BUILTIN_VALUES; builtin++) {
+        if (strcmp(sym_str(call->name), builtin_names[builtin]) != 0) continue;
+        return is_container(infer_expr(ast, signatures, call->lhs)) ? builtin : BUILTIN_NONE;
+    }
+    return BUILTIN_NONE;
+}
+
+// Types a builtin call, in `*elem` and `*record` for what it returns, and
+// stores the builtin in the call's op for cgen.
+static int infer_builtin(struct Ast *ast, const struct Scope *signatures, NodeId id, int builtin,
+                         int *elem, int *record) {
+    AST_NODE(ast, id)->op = builtin;
+    NodeId first = AST_NODE(ast, id)->lhs;
+    infer_expr(ast, signatures, first);
+    NodeId second = AST_NODE(ast, first)->next;
+    if (second) infer_expr(ast, signatures, second);
+    struct Node *container = AST_NODE(ast, first);
+    bool on_vec = builtin == BUILTIN_PUSH || builtin == BUILTIN_POP;
+    bool two = builtin == BUILTIN_PUSH || builtin == BUILTIN_HAS || builtin == BUILTIN_DEL;
+    if ((container->type == TYPE_VEC) != on_vec || !second != !two || (second && AST_NODE(ast, second)->next)) {
+        PRINT_ERR("'%s' takes %s\n", builtin_names[builtin], builtin_usage[builtin]);
+        ast->error_count++;
+        return TYPE_INT;
+    }
+    int key = MAP_KEY(container->elem), value = MAP_VALUE(container->elem);
+    *record = container->record;
+    switch (builtin) {
+        case BUILTIN_PUSH:
+            if (!stores_as(ast, second, container->elem, container->record)) {
+                PRINT_ERR("'push' of a value that is not of the vec's element type\n");
+                ast->error_count++;
+            }
+            return TYPE_INT;
+        case BUILTIN_POP:
+            return container->elem;
+        case BUILTIN_HAS:
+        case BUILTIN_DEL:
+            if (!stores_as(ast, second, key, 0)) {
+                PRINT_ERR("'%s' with a key that is not of the map's key type\n", builtin_names[builtin]);
+                ast->error_count++;
+            }
+            return TYPE_BOOL;
+        case BUILTIN_KEYS:
+            *elem = key;
+            *record = 0;
+            return TYPE_SLICE;
+        default:
+            *elem = value;
+            return TYPE_SLICE;
+    }
+}
+
+// Sets the node's type, its elem for a slice and its record for a struct,
+// and returns the type. Mistakes only the types show count as errors of
+// the module.
+static int infer_expr(struct Ast *ast, const struct Scope *signatures, NodeId id) {
+    struct Node *node = AST_NODE(ast, id);
+    int type = TYPE_INT, elem = TYPE_NONE, record = 0;
+    switch (node->kind) {
+        case NODE_INT:
+            type = node->int_value >= INT_MIN && node->int_value <= INT_MAX ? TYPE_INT : TYPE_INT64;
+            break;
+        case NODE_FLOAT:  type = TYPE_DOUBLE; break;
+        case NODE_STRING: type = TYPE_STR; break;
+        case NODE_BOOL:   type = TYPE_BOOL; break;
+        case NODE_NULL:   type = TYPE_POINTER; break;
+        case NODE_IDENT:
+            if (node->rhs) {
+                type = infer_decl(ast, signatures, node->rhs);
+                elem = AST_NODE(ast, AST_NODE(ast, id)->rhs)->elem;
+                record = AST_NODE(ast, AST_NODE(ast, id)->rhs)->record;
+            } else if (scope_lookup(signatures, node->name)) {
+                // a function of another module, or of libc, passed by name
+                node->kind = NODE_FUNC_REF;
+                type = TYPE_POINTER;
+            }
+            break;
+        case NODE_FUNC_REF:
+            type = TYPE_POINTER;
+            break;
+        case NODE_CALL: {
+            NodeId func = node->rhs;
+            int builtin = builtin_of(ast, signatures, id);
+            if (builtin) {
+                type = infer_builtin(ast, signatures, id, builtin, &elem, &record);
+                break;
+            }
+            uint32_t sig = func ? SIG(AST_NODE(ast, func)->type, AST_NODE(ast, func)->elem)
+                                : call_signature(signatures, node->name);
+            // C functions see a slice as a pointer to its elements, the way a
+            // C array decays, and a string as a NUL-terminated char *
+            for (NodeId arg = node->lhs; arg; arg = AST_NODE(ast, arg)->next) {
+                int t = infer_expr(ast, signatures, arg);
+                if ((t == TYPE_SLICE || t == TYPE_STR || is_container(t)) && (sig & SIG_FOREIGN)) {
+                    wrap_cast(ast, arg, TYPE_POINTER);
+                }
+            }
+            type = SIG_TYPE(sig);
+            elem = SIG_ELEM(sig);
+            if (type == TYPE_STR && (sig & SIG_FOREIGN)) {
+                // and return char *, measured once to become a string
+                bool wrapped = AST_NODE(ast, id)->type == TYPE_POINTER;
+                AST_NODE(ast, id)->type = TYPE_POINTER;
+                if (wrapped) return TYPE_POINTER;
+                wrap_cast(ast, id, TYPE_STR);
+                return TYPE_STR;
+            }
+            if (func) {
+                record = AST_NODE(ast, func)->record;
+            } else if (type == TYPE_STRUCT || holds_struct(type, elem)) {
+                // struct declarations are private to their module
+                PRINT_ERR("'%s' returns a struct of another module\n", sym_str(AST_NODE(ast, id)->name));
+                ast->error_count++;
+                type = TYPE_INT;
+                elem = TYPE_NONE;
+            }
+            break;
+        }
+        case NODE_CAST:
+            infer_expr(ast, signatures, node->lhs);
+            return AST_NODE(ast, id)->type;
+        case NODE_UNARY: {
+            int operand = infer_expr(ast, signatures, node->lhs);
+            type = AST_NODE(ast, id)->op == OP_NOT ? TYPE_BOOL : arithmetic_type(operand, TYPE_INT);
+            if (operand == TYPE_STR) {
+                PRINT_ERR("'%s' of a string\n", AST_NODE(ast, id)->op == OP_NOT ? "!" : "-");
+                ast->error_count++;
+            } else if (is_container(operand)) {
+                PRINT_ERR("operators don't apply to a vec or map\n");
+                ast->error_count++;
+            }
+            break;
+        }
+        case NODE_BINARY: {
+            int lhs = infer_expr(ast, signatures, node->lhs);
+            int rhs = infer_expr(ast, signatures, AST_NODE(ast, id)->rhs);
+            if (is_container(lhs) || is_container(rhs)) {
+                PRINT_ERR("operators don't apply to a vec or map\n");
+                ast->error_count++;
+                break;
+            }
+            if (lhs == TYPE_STR || rhs == TYPE_STR) {
+                type = string_binary(ast, AST_NODE(ast, id)->op, lhs, rhs);
+                break;
+            }
+            switch (AST_NODE(ast, id)->op) {
+                case OP_LT: case OP_LE: case OP_GT: case OP_GE:
+                case OP_EQ: case OP_NE: case OP_AND: case OP_OR:
+                    type = TYPE_BOOL;
+                    break;
+                case OP_SHL: case OP_SHR:
+                    type = arithmetic_type(lhs, TYPE_INT);
+                    break;
+                default:
+                    type = arithmetic_type(lhs, rhs);
+            }
+            break;
+        }
+        case NODE_ARRAY: {
+            // elements of mixed types meet as in arithmetic
+            type = TYPE_SLICE;
+            for (NodeId element = node->lhs; element; element = AST_NODE(ast, element)->next) {
+                int t = infer_expr(ast, signatures, element);
+                elem = elem == TYPE_NONE || elem == t ? t : arithmetic_type(elem, t);
+                if (!record) record = AST_NODE(ast, element)->record;
+            }
+            if (elem == TYPE_STRUCT && (AST_NODE(ast, ast->records[record])->flags & NODE_SOA)) {
+                PRINT_ERR("arrays of soa struct '%s' are made with '[n]%s', not from elements\n",
+                          sym_str(AST_NODE(ast, ast->records[record])->name),
+                          sym_str(AST_NODE(ast, ast->records[record])->name));
+                ast->error_count++;
+            }
+            if (is_container(elem)) {
+                PRINT_ERR("arrays of vecs or maps are not supported\n");
+                ast->error_count++;
+            }
+            break;
+        }
+        case NODE_ARRAY_NEW:
+            if (!is_number(infer_expr(ast, signatures, node->lhs))) {
+                PRINT_ERR("%s is a number\n", is_container(AST_NODE(ast, id)->type) ? "the reserve of a vec or map"
+                                                                                   : "the length of an array");
+                ast->error_count++;
+            }
+            type = is_container(AST_NODE(ast, id)->type) ? AST_NODE(ast, id)->type : TYPE_SLICE;
+            elem = AST_NODE(ast, id)->elem;
+            record = AST_NODE(ast, id)->record;
+            break;
+        case NODE_INDEX: {
+            int of = infer_expr(ast, signatures, node->lhs);
+            if (of == TYPE_STR) {
+                infer_expr(ast, signatures, AST_NODE(ast, id)->rhs);
+                break;  // a byte, as an int
+            }
+            infer_expr(ast, signatures, AST_NODE(ast, id)->rhs);
+            type = AST_NODE(ast, AST_NODE(ast, id)->lhs)->elem;
+            record = AST_NODE(ast, AST_NODE(ast, id)->lhs)->record;
+            if (of == TYPE_MAP) {
+                // m[k], with a key of the map's key type
+                if (!stores_as(ast, AST_NODE(ast, id)->rhs, MAP_KEY(type), 0)) {
+                    PRINT_ERR("map key of the wrong type\n");
+                    ast->error_count++;
+                }
+                type = MAP_VALUE(type);
+            }
+            if (type == TYPE_NONE) type = TYPE_INT;     // not an array; C reports it
+            break;
+        }
+        case NODE_SLICE: {
+            type = infer_expr(ast, signatures, node->lhs);
+            elem = AST_NODE(ast, AST_NODE(ast, id)->lhs)->elem;
+            record = AST_NODE(ast, AST_NODE(ast, id)->lhs)->record;
+            // a view of a vec's elements as they are now
+            if (type == TYPE_VEC) type = TYPE_SLICE;
+            if (type == TYPE_MAP) {
+                PRINT_ERR("a map can't be sliced, slice its keys() or values()\n");
+                ast->error_count++;
+            }
+            infer_expr(ast, signatures, AST_NODE(ast, id)->rhs);
+            if (AST_NODE(ast, id)->alt) infer_expr(ast, signatures, AST_NODE(ast, id)->alt);
+            break;
+        }
+        case NODE_LEN:
+            infer_expr(ast, signatures, node->lhs);
+            type = TYPE_INT64;
+            break;
+        case NODE_CONSTRUCT:
+            for (NodeId value = node->lhs; value; value = AST_NODE(ast, value)->next) {
+                infer_expr(ast, signatures, value);
+            }
+            type = TYPE_STRUCT;
+            record = AST_NODE(ast, id)->record;
+            break;
+        case NODE_MEMBER: {
+            if (infer_expr(ast, signatures, node->lhs) != TYPE_STRUCT) {
+                PRINT_ERR("'.%s' of a value that is not a struct\n", sym_str(AST_NODE(ast, id)->name));
+                ast->error_count++;
+                break;
+            }
+            struct Node *of = AST_NODE(ast, AST_NODE(ast, id)->lhs);
+            NodeId field = ast_find_field(ast, of->record, AST_NODE(ast, id)->name);
+            if (!field) {
+                PRINT_ERR("struct '%s' has no field '%s'\n", sym_str(AST_NODE(ast, ast->records[of->record])->name),
+                          sym_str(AST_NODE(ast, id)->name));
+                ast->error_count++;
+                break;
+            }
+            AST_NODE(ast, id)->rhs = field;
+            type = AST_NODE(ast, field)->type;
+            elem = AST_NODE(ast, field)->elem;
+            record = AST_NODE(ast, field)->record;
+            break;
+        }
+    }
+    AST_NODE(ast, id)->type = type;
+    AST_NODE(ast, id)->elem = elem;
+    AST_NODE(ast, id)->record = record;
+    return type;
+}
+
+// Variables take the type of their initializer, parameters are declared.
+static int infer_decl(struct Ast *ast, const struct Scope *signatures, NodeId decl) {
+    struct Node *node = AST_NODE(ast, decl);
+    if (node->type != TYPE_NONE) return node->type;
+    if (node->kind != NODE_VARIABLE || !node->lhs) {
+        node->type = TYPE_INT;
+        return TYPE_INT;
+    }
+    node->type = TYPE_INT;  // settles a cycle through initializers; C rejects it anyway
+    int type = infer_expr(ast, signatures, node->lhs);
+    AST_NODE(ast, decl)->type = type;
+    AST_NODE(ast, decl)->elem = AST_NODE(ast, AST_NODE(ast, decl)->lhs)->elem;
+    AST_NODE(ast, decl)->record = AST_NODE(ast, AST_NODE(ast, decl)->lhs)->record;
+    return type;
+}
+
+// `func` is the function the statements are in.
+static void infer_statements(struct Ast *ast, const struct Scope *signatures, NodeId func, NodeId first) {
+    for (NodeId stmt = first; stmt; stmt = AST_NODE(ast, stmt)->next) {
+        struct Node *s = AST_NODE(ast, stmt);
+        NodeId body = s->rhs;
+        switch (s->kind) {
+            case NODE_VARIABLE: {
+                // on a later pass the initializer may have widened
+                int type = infer_decl(ast, signatures, stmt);
+                int value = s->lhs ? infer_expr(ast, signatures, s->lhs) : TYPE_NONE;
+                if (is_number(type) && is_number(value)) AST_NODE(ast, stmt)->type = arithmetic_type(type, value);
+                break;
+            }
+            case NODE_CALL:
+                infer_expr(ast, signatures, stmt);
+                break;
+            case NODE_RETURN:
+                if (s->lhs) {
+                    infer_expr(ast, signatures, s->lhs);
+                } else {
+                    // a bare 'return' returns zero of the function's type
+                    s->type = AST_NODE(ast, func)->type;
+                    s->elem = AST_NODE(ast, func)->elem;
+                    s->record = AST_NODE(ast, func)->record;
+                }
+                break;
+            case NODE_ASSIGN: {
+                NodeId target = s->lhs;
+                if (AST_NODE(ast, target)->kind != NODE_IDENT) infer_expr(ast, signatures, target);
+                int value = infer_expr(ast, signatures, AST_NODE(ast, stmt)->rhs);
+                if (value == TYPE_STRUCT && AST_NODE(ast, stmt)->op != OP_NONE) {
+                    PRINT_ERR("a struct can only be assigned with '='\n");
+                    ast->error_count++;
+                }
+                // a number variable widens to hold whatever is stored in it
+                NodeId decl = AST_NODE(ast, target)->kind == NODE_IDENT ? AST_NODE(ast, target)->rhs : 0;
+                int type = decl ? infer_decl(ast, signatures, decl) : AST_NODE(ast, target)->type;
+                struct Node *to = AST_NODE(ast, decl ? decl : target), *from = AST_NODE(ast, AST_NODE(ast, stmt)->rhs);
+                if ((is_container(type) || is_container(value))
+                    && (AST_NODE(ast, stmt)->op != OP_NONE || type != value || to->elem != from->elem
+                        || to->record != from->record)) {
+                    PRINT_ERR("a vec or map can only be assigned with '=' another of its type\n");
+                    ast->error_count++;
+                }
+                if (decl && AST_NODE(ast, decl)->kind == NODE_VARIABLE) {
+                    if (is_number(type) && is_number(value)) AST_NODE(ast, decl)->type = arithmetic_type(type, value);
+                }
+                int op = AST_NODE(ast, stmt)->op;
+                if ((type == TYPE_STR || value == TYPE_STR) && op != OP_NONE && (op != OP_ADD || type != value)) {
+                    PRINT_ERR("a string can only be appended to with '+='\n");
+                    ast->error_count++;
+                }
+                break;
+            }
+            case NODE_BLOCK:
+                infer_statements(ast, signatures, func, s->lhs);
+                break;
+            case NODE_IF:
+            case NODE_WHILE: {
+                NodeId alt = s->kind == NODE_IF ? s->alt : 0;
+                infer_expr(ast, signatures, s->lhs);
+                infer_statements(ast, signatures, func, body);
+                if (alt) infer_statements(ast, signatures, func, alt);
+                break;
+            }
+            case NODE_FOR: {
+                // the counter is wide enough for the start, the end and the step
+                NodeId var = s->lhs, end = s->alt;
+                int type = infer_decl(ast, signatures, var);
+                for (NodeId bound = end; bound; bound = AST_NODE(ast, bound)->next) {
+                    type = arithmetic_type(type, infer_expr(ast, signatures, bound));
+                }
+                AST_NODE(ast, var)->type = type;
+                infer_statements(ast, signatures, func, body);
+                break;
+            }
+        }
+    }
+}
+
+// Grows whenever a pass widens a variable: number types only widen to
+// later ones in enum VarType.
+static uint64_t variable_types(const struct Ast *ast) {
+    uint64_t sum = 0;
+    for (NodeId id = 1; id < ast->node_count; id++) {
+        if (ast->nodes[id].kind == NODE_VARIABLE) sum += ast->nodes[id].type;
+    }
+    return sum;
+}
+
+// A variable widened by a later assignment changes the type of what uses
+// it earlier, so the functions are typed again until no variable widens.
+// Widening only goes from one number type to another, which no mistake
+// reported here depends on, so a later pass reports nothing new.
+int infer_types(struct Ast *ast, const struct Scope *signatures) {
+    int errors = ast->error_count;
+    for (NodeId decl = ast->first; decl; decl = AST_NODE(ast, decl)->next) {
+        if (AST_NODE(ast, decl)->kind == NODE_VARIABLE) infer_decl(ast, signatures, decl);
+    }
+    uint64_t before;
+    do {
+        before = variable_types(ast);
+        for (NodeId decl = ast->first; decl; decl = AST_NODE(ast, decl)->next) {
+            struct Node *node = AST_NODE(ast, decl);
+            if (node->kind == NODE_FUNCTION) infer_statements(ast, signatures, decl, node->lhs);
+        }
+    } while (ast->error_count == errors && variable_types(ast) != before);
+    return ast->error_count - errors;
+}
+
+uint64_t types_callee_hash(const struct Summary *summary, const struct Scope *signatures) {
+    uint64_t hash = 0;
+    for (uint32_t c = 0; c < summary->call_count; c++) {
+        hash = hash_combine(hash, call_signature(signatures, summary->calls[c]));
+    }
+    return hash;
+}
@@ -0,0 +1,26 @@
+#ifndef TYPES_H
+#define TYPES_H
+
+#include <stdint.h>
+
+#include "ast.h"
+#include "dce.h"
+
+// Return types of the functions a module can call without defining them,
+// by name: other modules' from their summaries, libc's from a table. The
+// symbol's decl field holds the VarType.
+void types_add_module(struct Scope *signatures, const struct Summary *summary);
+void types_add_libc(struct Scope *signatures);
+
+// Gives every expression and variable of the module its C type: the
+// narrowest one that holds an initializer exactly, widened by the numbers
+// later assigned to it, calls typed by their signature (int when unknown,
+// as in C). Slices passed to C functions decay to pointers. Returns the
+// number of errors, such as a field a struct doesn't have.
+int infer_types(struct Ast *ast, const struct Scope *signatures);
+
+// Identifies the return types of everything the module calls, since its
+// C changes with them.
+uint64_t types_callee_hash(const struct Summary *summary, const struct Scope *signatures);
+
+#endif // TYPES_H